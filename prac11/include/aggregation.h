@@ -0,0 +1,81 @@
+#pragma once
+#include "json.hpp"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+using namespace std;
+using json = nlohmann::json;
+
+// Конвейер агрегации ($match, $group, $sort, $limit).
+// Документы подаются по одному, коллекция обходится за один проход:
+// $group считается хэш-агрегацией, $sort + $limit хранит только top-k.
+class Aggregator {
+public:
+    using Matcher = function<bool(const json& document, const json& query)>;
+
+    Aggregator(const json& pipeline, Matcher matcher);
+
+    void consume(const json& document);
+    vector<json> finish();
+
+    // true, если дальнейшие документы уже не повлияют на результат
+    bool done() const { return done_; }
+
+private:
+    enum class StageType { Match, Group, Sort, Limit };
+    enum class AccumulatorType { Sum, Count, Min, Max, Avg };
+
+    struct Accumulator {
+        string name;
+        AccumulatorType type;
+        json::json_pointer field;
+        double constant = 0;
+        bool useConstant = false;
+    };
+
+    struct Stage {
+        StageType type;
+        json spec;
+        json groupKey;
+        vector<Accumulator> accumulators;
+        vector<pair<json::json_pointer, int>> sortKeys;
+        size_t limit = 0;
+    };
+
+    struct AccumulatorState {
+        double sum = 0;
+        size_t count = 0;
+        bool allIntegers = true;
+        json extreme;
+    };
+
+    struct GroupState {
+        json key;
+        vector<AccumulatorState> states;
+    };
+
+    Aggregator(vector<Stage> stages, Matcher matcher);
+
+    static vector<Stage> parsePipeline(const json& pipeline);
+    static Stage parseStage(const json& stage);
+    static Accumulator parseAccumulator(const string& name, const json& spec);
+    static json::json_pointer fieldPointer(const string& path);
+    static json evaluateExpression(const json& document, const json& expression);
+    static int compareDocuments(const json& a, const json& b,
+                                const vector<pair<json::json_pointer, int>>& sortKeys);
+
+    void accumulate(GroupState& group, const Stage& stage, const json& document);
+    vector<json> materializeGroups(const Stage& stage);
+    void trimSortBuffer(const Stage& sortStage, size_t limit);
+
+    vector<Stage> stages_;
+    Matcher matcher_;
+    size_t blockingStage_;
+    vector<size_t> limitCounters_;
+    bool done_ = false;
+
+    unordered_map<string, GroupState> groups_;
+    vector<string> groupOrder_;
+    vector<json> buffer_;
+};
@@ -0,0 +1,27 @@
+#pragma once
+#include "collection.h"
+#include <iostream>
+#include <string>
+using namespace std;
+
+// Форматы массового импорта и экспорта
+enum class BulkFormat {
+    Auto,       // по первому символу: '[' - JSON-массив, иначе NDJSON
+    NdJson,     // по документу в строке
+    JsonArray   // один JSON-массив документов
+};
+
+BulkFormat parseBulkFormat(const string& name);
+
+struct ImportResult {
+    size_t imported = 0;
+    size_t skipped = 0;   // строки/элементы, не являющиеся JSON-объектом
+};
+
+// Потоковый импорт: входные данные читаются блоками, записи блока
+// разбираются параллельно в threads потоках и добавляются в коллекцию
+// без записи на диск. Коллекция сохраняется один раз вызывающим кодом.
+ImportResult importDocuments(Collection& collection, istream& in, BulkFormat format, unsigned threads);
+
+// Потоковый экспорт: документы пишутся по одному, без сборки общего массива
+size_t exportDocuments(const Collection& collection, ostream& out, BulkFormat format);
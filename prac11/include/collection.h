@@ -1,8 +1,13 @@
 #pragma once
 #include "hashmap.h"
+#include "compact_document.h"
+#include "numeric_columns.h"
+#include "text_index.h"
+#include "trigram_index.h"
 #include "json.hpp"
 #include <string>
 #include <vector>
+#include <memory>
 using namespace std;
 using json = nlohmann::json;
 
@@ -15,15 +20,56 @@ public:
     void save();
 
     string insert(const json& document);
+    // Вставка пачки документов без записи на диск; строковый _id
+    // сохраняется, остальным назначается новый. Сохранение - save().
+    size_t insertBatch(vector<json>&& documents);
     vector<json> find(const json& query);
     int remove(const json& query);
+    vector<json> aggregate(const json& pipeline);
 
     void createIndex(const string& field);
+    // Полнотекстовый индекс по полю для условий $text и индекс триграмм
+    // для $like; списки полей хранятся рядом с файлом коллекции
+    void createTextIndex(const string& field);
+    void createTrigramIndex(const string& field);
+
+    // Обход всех документов без сборки общего массива
+    template<typename Func>
+    void forEachDocument(Func func) const {
+        store_.forEach([&](CompactStore::Slot, const json& document) { return func(document); });
+    }
+
+    size_t size() const { return store_.size(); }
+    // Память под документы в компактном представлении, байт
+    size_t memoryUsage() const { return store_.memoryUsage(); }
 
 private:
     string filePath_;                 
-    HashMap<string, json> map_;     
+    // _id -> запись в компактном хранилище; json строится только на выдаче
+    HashMap<string, CompactStore::Slot> ids_;
+    CompactStore store_;
+    NumericColumns columns_;
+    vector<string> textFields_;
+    unique_ptr<TextIndex> text_;      // строится при первом запросе $text
+    vector<string> trigramFields_;
+    unique_ptr<TrigramIndex> trigrams_;  // строится при первом подходящем $like
+    bool dirty_ = false;              // есть изменения, не записанные в файл
+
+    void put(const string& id, const json& document);
+
+    // Отбор записей по числовым условиям запроса через колонки; false,
+    // если ни одно условие нельзя посчитать по колонкам
+    bool prefilter(const json& query, vector<uint64_t>& selection);
+    // Записи-кандидаты из индексов для $text и $like верхнего уровня
+    // запроса; false, если индексы его не сужают. В rest - условия,
+    // которые проверяются на кандидатах.
+    bool indexCandidates(const json& query, vector<CompactStore::Slot>& slots, json& rest);
+    // Вызов func(slot, document) для документов, подходящих под запрос
+    template<typename Func>
+    void scan(const json& query, Func func);
 
+    string textIndexPath() const { return filePath_ + ".text"; }
+    string trigramIndexPath() const { return filePath_ + ".trigram"; }
     string generateId();
     bool matchesQuery(const json& document, const json& query);
     bool matchesCondition(const json& document, const string& field, const json& condition);
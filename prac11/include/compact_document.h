@@ -0,0 +1,81 @@
+#pragma once
+#include "json.hpp"
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <cstdint>
+using namespace std;
+using json = nlohmann::json;
+
+// Словарь имен полей и форм документов, общий для коллекции.
+// Форма - упорядоченный список полей верхнего уровня; у однотипных
+// событий она одна, поэтому имена полей хранятся один раз на коллекцию.
+class FieldDictionary {
+public:
+    uint32_t fieldId(const string& name);
+    const string& fieldName(uint32_t id) const { return names_[id]; }
+
+    uint32_t shapeId(const vector<uint32_t>& fields);
+    const vector<uint32_t>& shape(uint32_t id) const { return shapes_[id]; }
+
+    size_t memoryUsage() const;
+    void clear();
+
+private:
+    vector<string> names_;
+    unordered_map<string, uint32_t> nameIds_;
+    vector<vector<uint32_t>> shapes_;
+    map<vector<uint32_t>, uint32_t> shapeIds_;
+};
+
+// Хранилище документов в компактном виде. Значения полей верхнего уровня
+// записываются в порядке формы в общий непрерывный буфер: байт типа и
+// varint/сырые байты значения, без имен полей и без отдельных выделений
+// памяти на документ. json собирается только при чтении документа.
+class CompactStore {
+public:
+    using Slot = uint32_t;
+
+    // Документ должен быть объектом; возвращает номер записи
+    Slot add(const json& document);
+    json get(Slot slot) const;
+    void remove(Slot slot);
+    void clear();
+
+    size_t size() const { return live_; }
+    // Число номеров записей, включая освободившиеся
+    size_t slotCount() const { return records_.size(); }
+
+    // Обход живых документов; останавливается, если func вернула false
+    template<typename Func>
+    void forEach(Func func) const {
+        for (Slot slot = 0; slot < records_.size(); ++slot) {
+            if (records_[slot].shape == FREE) continue;
+            if (!func(slot, get(slot))) return;
+        }
+    }
+
+    // Байты, занятые буфером значений, таблицей записей и словарем
+    size_t memoryUsage() const;
+
+private:
+    static constexpr uint32_t FREE = UINT32_MAX;
+
+    struct Record {
+        uint64_t offset;
+        uint32_t length;
+        uint32_t shape;  // FREE - запись удалена
+    };
+
+    void encodeValue(const json& value, vector<uint8_t>& out);
+    json decodeValue(const uint8_t*& pos) const;
+    void compact();
+
+    FieldDictionary dictionary_;
+    vector<uint8_t> arena_;
+    vector<Record> records_;
+    vector<Slot> freeSlots_;
+    size_t live_ = 0;
+    size_t garbage_ = 0;  // байты удаленных документов в arena_
+};
@@ -22,12 +22,32 @@ private:
         return std::hash<K>{}(key) % data_.size();
     }
 
+    // Перенос всех элементов в таблицу нового размера
+    void rehash(size_t newSize) {
+        std::vector<Node> old = std::move(data_);
+        data_ = std::vector<Node>(newSize);
+        for (auto& node : old) {
+            if (!node.occupied) continue;
+            size_t idx = hashKey(node.key);
+            while (data_[idx].occupied) {
+                idx = (idx + 1) % data_.size();
+            }
+            data_[idx] = std::move(node);
+        }
+    }
+
 public:
     HashMap(size_t initialSize = 32, double loadFactor = 0.75)
-        : data_(initialSize), loadFactor_(loadFactor) {}
+        : data_(initialSize > 0 ? initialSize : 1), loadFactor_(loadFactor) {}
 
     // Вставка или обновление элемента
     void put(const K& key, const V& value) {
+        // Таблица растет заранее: при линейном пробировании в заполненной
+        // таблице поиск свободной ячейки не завершился бы
+        if (static_cast<double>(count_ + 1) > data_.size() * loadFactor_) {
+            rehash(data_.size() * 2);
+        }
+
         size_t idx = hashKey(key);
 
         while (data_[idx].occupied && data_[idx].key != key) {
@@ -57,17 +77,34 @@ public:
         return std::nullopt;
     }
 
-    // Удаление элемента
+    // Удаление элемента. Следующие за ним элементы цепочки сдвигаются
+    // назад, чтобы поиск по ним не останавливался на образовавшейся дыре.
     void remove(const K& key) {
         size_t idx = hashKey(key);
 
         while (data_[idx].occupied) {
-            if (data_[idx].key == key) {
-                data_[idx].occupied = false;
-                return;
-            }
+            if (data_[idx].key == key) break;
             idx = (idx + 1) % data_.size();
         }
+        if (!data_[idx].occupied) return;
+
+        size_t hole = idx;
+        size_t next = (hole + 1) % data_.size();
+        while (data_[next].occupied) {
+            size_t home = hashKey(data_[next].key);
+            // Элемент можно сдвинуть в дыру, если его исходная ячейка
+            // не лежит (циклически) между дырой и его текущей позицией
+            bool between = hole <= next ? (home > hole && home <= next)
+                                        : (home > hole || home <= next);
+            if (!between) {
+                data_[hole] = std::move(data_[next]);
+                hole = next;
+            }
+            next = (next + 1) % data_.size();
+        }
+
+        data_[hole] = Node();
+        count_--;
     }
 
     // Получение всех элементов в виде вектора пар
@@ -84,6 +121,16 @@ public:
         return out;
     }
 
+    // Обход элементов без копирования; останавливается, если func вернула false
+    template<typename Func>
+    void forEach(Func func) const {
+        for (const auto& node : data_) {
+            if (node.occupied && !func(node.key, node.value)) {
+                return;
+            }
+        }
+    }
+
     // Дополнительно можно добавить метод size()
     size_t size() const {
         return count_;
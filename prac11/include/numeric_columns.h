@@ -0,0 +1,51 @@
+#pragma once
+#include "compact_document.h"
+#include "json.hpp"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+using namespace std;
+using json = nlohmann::json;
+
+// Колонки значений числовых полей, по которым фильтруют запросы.
+// Колонка - непрерывный массив double по номерам записей CompactStore и
+// битовая маска записей, где поле есть и является числом. Условия $gt,
+// $lt, $eq и $in с числовыми операндами считаются по колонке векторными
+// ядрами, документ декодируется только для отобранных записей.
+class NumericColumns {
+public:
+    static constexpr size_t MAX_COLUMNS = 16;
+    static constexpr size_t MAX_IN_SET = 16;
+
+    // Условие на поле целиком выражается через колонку
+    static bool eligible(const json& condition);
+
+    bool contains(const string& field) const { return columns_.count(field) > 0; }
+    bool full() const { return columns_.size() >= MAX_COLUMNS; }
+
+    // Новая пустая колонка; заполняется через fill() по всем документам
+    void add(const string& field);
+    void fill(const string& field, CompactStore::Slot slot, const json& document);
+
+    // Поддержка колонок при вставке и удалении документов
+    void set(CompactStore::Slot slot, const json& document);
+    void erase(CompactStore::Slot slot);
+    void clear() { columns_.clear(); }
+
+    // selection &= записи, удовлетворяющие условию; false - колонка не может
+    // ответить точно (тогда selection не меняется)
+    bool select(const string& field, const json& condition, size_t slotCount,
+                vector<uint64_t>& selection) const;
+
+private:
+    struct Column {
+        vector<double> values;
+        vector<uint64_t> valid;
+        bool exact = true;  // все целые представимы в double без потерь
+    };
+
+    static void assign(Column& column, CompactStore::Slot slot, const json& document, const string& field);
+
+    unordered_map<string, Column> columns_;
+};
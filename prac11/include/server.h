@@ -46,6 +46,7 @@ private:
     json executeInsert(const string& dbName, const string& collectionName, const json& data);
     json executeFind(const string& dbName, const string& collectionName, const json& query);
     json executeDelete(const string& dbName, const string& collectionName, const json& query);
+    json executeAggregate(const string& dbName, const string& collectionName, const json& pipeline);
     
     // Вспомогательные функции для работы с сетью
     string readMessage(int socket);
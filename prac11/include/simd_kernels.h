@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Векторные ядра сравнения над непрерывными массивами double.
+// Результат - битовая маска выборки: бит i слова i / 64 установлен, если
+// values[i] удовлетворяет условию. Реализация выбирается один раз при
+// первом вызове: AVX2, SSE2 или скалярная.
+namespace simd {
+
+enum class CompareOp { Greater, Less, Equal };
+
+// selection должен вмещать (count + 63) / 64 слов; лишние биты обнуляются
+void compare(const double* values, size_t count, CompareOp op, double operand, uint64_t* selection);
+
+// Принадлежность небольшому множеству (операция $in)
+void inSet(const double* values, size_t count, const double* set, size_t setSize, uint64_t* selection);
+
+// Имя выбранной реализации: "avx2", "sse2" или "scalar"
+const char* activeKernel();
+
+}  // namespace simd
@@ -0,0 +1,71 @@
+#pragma once
+#include "compact_document.h"
+#include "json.hpp"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+using namespace std;
+using json = nlohmann::json;
+
+// Полнотекстовый поиск: условие {"$text": {"$search": "failed \"sudo su\""}}
+// выполняется, если в документе есть все слова, а слова в кавычках идут
+// подряд в одном поле. Слово - буквы, цифры, '_' и байты UTF-8 вне ASCII;
+// регистр ASCII не учитывается.
+namespace fulltext {
+
+struct Query {
+    vector<vector<string>> phrases;  // отдельное слово - фраза из одного слова
+
+    bool empty() const { return phrases.empty(); }
+};
+
+void tokenize(const string& text, vector<string>& tokens);
+
+// Разбор условия $text; false, если условие некорректно
+bool parseQuery(const json& condition, Query& query);
+
+// Проверка без индекса по всем строковым полям верхнего уровня
+bool matches(const json& document, const Query& query);
+
+}  // namespace fulltext
+
+// Инвертированный индекс по заданным строковым полям. Для слова хранится
+// список вхождений (номер документа в индексе, поле и позиция слова),
+// упорядоченный по номеру документа: пересечение списков дает документы
+// со всеми словами, позиции - проверку фраз без декодирования документов.
+// Номера документов не совпадают с номерами записей CompactStore, чтобы
+// повторно занятая запись не унаследовала вхождения удаленной.
+class TextIndex {
+public:
+    explicit TextIndex(vector<string> fields);
+
+    // Поддержка индекса при вставке и удалении документов
+    void add(CompactStore::Slot slot, const json& document);
+    void erase(CompactStore::Slot slot);
+
+    // Записи с найденными документами в порядке возрастания номера
+    vector<CompactStore::Slot> search(const fulltext::Query& query) const;
+
+    const vector<string>& fields() const { return fields_; }
+
+private:
+    struct Posting {
+        uint32_t doc;
+        uint32_t position;  // номер поля в старших 8 битах, номер слова - в младших 24
+    };
+    using Postings = vector<Posting>;
+
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    // Вхождения в документ doc идут в списке подряд
+    static pair<Postings::const_iterator, Postings::const_iterator> occurrences(const Postings& list, uint32_t doc);
+    bool hasPhrase(uint32_t doc, const vector<const Postings*>& lists) const;
+    void compact();
+
+    vector<string> fields_;
+    unordered_map<string, Postings> postings_;
+    vector<CompactStore::Slot> slots_;  // номер документа -> запись; NONE - удален
+    vector<uint32_t> numbers_;          // запись -> номер документа или NONE
+    size_t live_ = 0;
+};
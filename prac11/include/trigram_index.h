@@ -0,0 +1,48 @@
+#pragma once
+#include "compact_document.h"
+#include "json.hpp"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+using namespace std;
+using json = nlohmann::json;
+
+// Сравнение с шаблоном LIKE: '%' - любая последовательность символов,
+// '_' - один любой байт; регистр ASCII не учитывается
+bool matchesLike(const string& text, const string& pattern);
+
+// Индекс триграмм для условий $like. Для каждой тройки подряд идущих
+// байтов значения поля (в нижнем регистре, с маркерами начала и конца
+// строки) хранится упорядоченный список документов. Шаблон '%sudo%' или
+// 'sudo%' сужается до документов, содержащих все его триграммы, и
+// проверяется только на них.
+class TrigramIndex {
+public:
+    explicit TrigramIndex(vector<string> fields);
+
+    // В шаблоне есть хотя бы одна триграмма
+    static bool selective(const string& pattern);
+
+    bool indexes(const string& field) const;
+
+    // Поддержка индекса при вставке и удалении документов
+    void add(CompactStore::Slot slot, const json& document);
+    void erase(CompactStore::Slot slot);
+
+    // Записи-кандидаты в порядке возрастания; пусто, если поле не
+    // индексировано или шаблон не сужает поиск (см. selective)
+    vector<CompactStore::Slot> candidates(const string& field, const string& pattern) const;
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    int fieldNumber(const string& field) const;
+    void compact();
+
+    vector<string> fields_;
+    unordered_map<uint32_t, vector<uint32_t>> postings_;  // поле и триграмма -> номера документов
+    vector<CompactStore::Slot> slots_;  // номер документа -> запись; NONE - удален
+    vector<uint32_t> numbers_;          // запись -> номер документа или NONE
+    size_t live_ = 0;
+};
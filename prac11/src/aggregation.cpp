@@ -0,0 +1,301 @@
+#include "aggregation.h"
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+using namespace std;
+
+Aggregator::Aggregator(const json& pipeline, Matcher matcher)
+    : Aggregator(parsePipeline(pipeline), move(matcher))
+{
+}
+
+Aggregator::Aggregator(vector<Stage> stages, Matcher matcher)
+    : stages_(move(stages)), matcher_(move(matcher))
+{
+    blockingStage_ = stages_.size();
+    for (size_t i = 0; i < stages_.size(); ++i) {
+        if (stages_[i].type == StageType::Group || stages_[i].type == StageType::Sort) {
+            blockingStage_ = i;
+            break;
+        }
+    }
+    limitCounters_.assign(stages_.size(), 0);
+}
+
+vector<Aggregator::Stage> Aggregator::parsePipeline(const json& pipeline) {
+    if (!pipeline.is_array()) {
+        throw runtime_error("Pipeline must be an array of stages");
+    }
+
+    vector<Stage> stages;
+    for (const auto& stage : pipeline) {
+        stages.push_back(parseStage(stage));
+    }
+    return stages;
+}
+
+json::json_pointer Aggregator::fieldPointer(const string& path) {
+    string pointer = "/" + path;
+    replace(pointer.begin(), pointer.end(), '.', '/');
+    return json::json_pointer(pointer);
+}
+
+Aggregator::Stage Aggregator::parseStage(const json& stageJson) {
+    if (!stageJson.is_object() || stageJson.size() != 1) {
+        throw runtime_error("Each pipeline stage must be an object with one operator");
+    }
+
+    string op = stageJson.begin().key();
+    const json& spec = stageJson.begin().value();
+
+    Stage stage;
+    stage.spec = spec;
+
+    if (op == "$match") {
+        if (!spec.is_object()) throw runtime_error("$match requires an object");
+        stage.type = StageType::Match;
+
+    } else if (op == "$group") {
+        if (!spec.is_object() || !spec.contains("_id")) {
+            throw runtime_error("$group requires an object with '_id'");
+        }
+        stage.type = StageType::Group;
+        stage.groupKey = spec["_id"];
+        for (auto it = spec.begin(); it != spec.end(); ++it) {
+            if (it.key() == "_id") continue;
+            stage.accumulators.push_back(parseAccumulator(it.key(), it.value()));
+        }
+
+    } else if (op == "$sort") {
+        if (!spec.is_object() || spec.empty()) throw runtime_error("$sort requires a non-empty object");
+        stage.type = StageType::Sort;
+        for (auto it = spec.begin(); it != spec.end(); ++it) {
+            if (!it.value().is_number()) throw runtime_error("$sort direction must be 1 or -1");
+            stage.sortKeys.emplace_back(fieldPointer(it.key()), it.value().get<double>() < 0 ? -1 : 1);
+        }
+
+    } else if (op == "$limit") {
+        if (!spec.is_number_integer() || spec.get<long long>() <= 0) {
+            throw runtime_error("$limit requires a positive integer");
+        }
+        stage.type = StageType::Limit;
+        stage.limit = spec.get<size_t>();
+
+    } else {
+        throw runtime_error("Unsupported pipeline stage: " + op);
+    }
+
+    return stage;
+}
+
+Aggregator::Accumulator Aggregator::parseAccumulator(const string& name, const json& spec) {
+    if (!spec.is_object() || spec.size() != 1) {
+        throw runtime_error("Accumulator '" + name + "' must be an object with one operator");
+    }
+
+    string op = spec.begin().key();
+    const json& arg = spec.begin().value();
+
+    Accumulator acc;
+    acc.name = name;
+
+    if (op == "$sum") acc.type = AccumulatorType::Sum;
+    else if (op == "$count") acc.type = AccumulatorType::Count;
+    else if (op == "$min") acc.type = AccumulatorType::Min;
+    else if (op == "$max") acc.type = AccumulatorType::Max;
+    else if (op == "$avg") acc.type = AccumulatorType::Avg;
+    else throw runtime_error("Unsupported accumulator: " + op);
+
+    if (acc.type == AccumulatorType::Count) return acc;
+
+    if (arg.is_string() && !arg.get<string>().empty() && arg.get<string>()[0] == '$') {
+        acc.field = fieldPointer(arg.get<string>().substr(1));
+    } else if (arg.is_number() && acc.type == AccumulatorType::Sum) {
+        acc.useConstant = true;
+        acc.constant = arg.get<double>();
+    } else {
+        throw runtime_error("Accumulator '" + name + "' requires a \"$field\" argument");
+    }
+
+    return acc;
+}
+
+json Aggregator::evaluateExpression(const json& document, const json& expression) {
+    if (expression.is_string()) {
+        const string& str = expression.get_ref<const string&>();
+        if (!str.empty() && str[0] == '$') {
+            auto pointer = fieldPointer(str.substr(1));
+            return document.contains(pointer) ? document[pointer] : json(nullptr);
+        }
+    }
+
+    if (expression.is_object()) {
+        json result = json::object();
+        for (auto it = expression.begin(); it != expression.end(); ++it) {
+            result[it.key()] = evaluateExpression(document, it.value());
+        }
+        return result;
+    }
+
+    return expression;
+}
+
+int Aggregator::compareDocuments(const json& a, const json& b,
+                                 const vector<pair<json::json_pointer, int>>& sortKeys) {
+    static const json nullValue;
+    for (const auto& [pointer, direction] : sortKeys) {
+        const json& va = a.contains(pointer) ? a[pointer] : nullValue;
+        const json& vb = b.contains(pointer) ? b[pointer] : nullValue;
+        if (va < vb) return -direction;
+        if (vb < va) return direction;
+    }
+    return 0;
+}
+
+void Aggregator::accumulate(GroupState& group, const Stage& stage, const json& document) {
+    for (size_t i = 0; i < stage.accumulators.size(); ++i) {
+        const Accumulator& acc = stage.accumulators[i];
+        AccumulatorState& state = group.states[i];
+
+        if (acc.type == AccumulatorType::Count) {
+            state.count++;
+            continue;
+        }
+
+        if (acc.useConstant) {
+            state.sum += acc.constant;
+            state.count++;
+            if (acc.constant != floor(acc.constant)) state.allIntegers = false;
+            continue;
+        }
+
+        if (!document.contains(acc.field)) continue;
+        const json& value = document[acc.field];
+        if (value.is_null()) continue;
+
+        if (acc.type == AccumulatorType::Min) {
+            if (state.extreme.is_null() || value < state.extreme) state.extreme = value;
+        } else if (acc.type == AccumulatorType::Max) {
+            if (state.extreme.is_null() || state.extreme < value) state.extreme = value;
+        } else if (value.is_number()) {
+            state.sum += value.get<double>();
+            state.count++;
+            if (!value.is_number_integer()) state.allIntegers = false;
+        }
+    }
+}
+
+vector<json> Aggregator::materializeGroups(const Stage& stage) {
+    vector<json> result;
+    result.reserve(groupOrder_.size());
+
+    for (const string& hashKey : groupOrder_) {
+        GroupState& group = groups_[hashKey];
+        json out;
+        out["_id"] = group.key;
+
+        for (size_t i = 0; i < stage.accumulators.size(); ++i) {
+            const Accumulator& acc = stage.accumulators[i];
+            const AccumulatorState& state = group.states[i];
+
+            switch (acc.type) {
+                case AccumulatorType::Count:
+                    out[acc.name] = state.count;
+                    break;
+                case AccumulatorType::Sum:
+                    if (state.allIntegers) out[acc.name] = static_cast<long long>(state.sum);
+                    else out[acc.name] = state.sum;
+                    break;
+                case AccumulatorType::Avg:
+                    out[acc.name] = state.count > 0 ? json(state.sum / state.count) : json(nullptr);
+                    break;
+                case AccumulatorType::Min:
+                case AccumulatorType::Max:
+                    out[acc.name] = state.extreme;
+                    break;
+            }
+        }
+
+        result.push_back(move(out));
+    }
+
+    return result;
+}
+
+void Aggregator::trimSortBuffer(const Stage& sortStage, size_t limit) {
+    if (buffer_.size() < 2 * limit) return;
+
+    nth_element(buffer_.begin(), buffer_.begin() + (limit - 1), buffer_.end(),
+        [&](const json& a, const json& b) { return compareDocuments(a, b, sortStage.sortKeys) < 0; });
+    buffer_.resize(limit);
+}
+
+void Aggregator::consume(const json& document) {
+    if (done_) return;
+
+    for (size_t i = 0; i < blockingStage_; ++i) {
+        const Stage& stage = stages_[i];
+        if (stage.type == StageType::Match) {
+            if (!matcher_(document, stage.spec)) return;
+        } else if (stage.type == StageType::Limit) {
+            if (++limitCounters_[i] >= stage.limit) done_ = true;
+            if (limitCounters_[i] > stage.limit) return;
+        }
+    }
+
+    if (blockingStage_ == stages_.size()) {
+        buffer_.push_back(document);
+        return;
+    }
+
+    const Stage& stage = stages_[blockingStage_];
+    if (stage.type == StageType::Group) {
+        json key = evaluateExpression(document, stage.groupKey);
+        string hashKey = key.dump();
+
+        auto it = groups_.find(hashKey);
+        if (it == groups_.end()) {
+            GroupState group;
+            group.key = key;
+            group.states.resize(stage.accumulators.size());
+            it = groups_.emplace(hashKey, move(group)).first;
+            groupOrder_.push_back(hashKey);
+        }
+        accumulate(it->second, stage, document);
+    } else {
+        buffer_.push_back(document);
+        size_t next = blockingStage_ + 1;
+        if (next < stages_.size() && stages_[next].type == StageType::Limit) {
+            trimSortBuffer(stage, stages_[next].limit);
+        }
+    }
+}
+
+vector<json> Aggregator::finish() {
+    if (blockingStage_ == stages_.size()) {
+        return move(buffer_);
+    }
+
+    const Stage& stage = stages_[blockingStage_];
+    vector<json> output;
+    if (stage.type == StageType::Group) {
+        output = materializeGroups(stage);
+    } else {
+        output = move(buffer_);
+        stable_sort(output.begin(), output.end(),
+            [&](const json& a, const json& b) { return compareDocuments(a, b, stage.sortKeys) < 0; });
+    }
+
+    // Оставшиеся стадии применяются к уже агрегированному результату
+    if (blockingStage_ + 1 == stages_.size()) {
+        return output;
+    }
+
+    Aggregator tail(vector<Stage>(stages_.begin() + blockingStage_ + 1, stages_.end()), matcher_);
+    for (const auto& document : output) {
+        if (tail.done()) break;
+        tail.consume(document);
+    }
+    return tail.finish();
+}
@@ -0,0 +1,200 @@
+#include "bulk_io.h"
+#include <thread>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <cctype>
+
+using namespace std;
+
+namespace {
+
+constexpr size_t READ_BLOCK = 16 * 1024 * 1024;
+constexpr size_t MIN_RECORDS_PER_THREAD = 256;
+
+using Range = pair<size_t, size_t>;  // начало и длина записи в буфере
+
+bool isBlank(const string& buffer, const Range& range) {
+    for (size_t i = range.first; i < range.first + range.second; ++i) {
+        if (!isspace(static_cast<unsigned char>(buffer[i]))) return false;
+    }
+    return true;
+}
+
+// Записи NDJSON - строки. Возвращает начало неполной последней строки.
+size_t splitLines(const string& buffer, bool last, vector<Range>& records) {
+    size_t start = 0;
+    while (true) {
+        size_t newline = buffer.find('\n', start);
+        if (newline == string::npos) {
+            if (!last) return start;
+            records.emplace_back(start, buffer.size() - start);
+            return buffer.size();
+        }
+        records.emplace_back(start, newline - start);
+        start = newline + 1;
+    }
+}
+
+// Нарезка JSON-массива на элементы верхнего уровня без разбора значений.
+// Между вызовами сохраняется только то, открыт ли массив: продолжение
+// всегда начинается с начала элемента, вне строк и вложенных скобок.
+class ArraySplitter {
+public:
+    size_t split(const string& buffer, bool last, vector<Range>& records) {
+        size_t pos = 0;
+        if (closed_) return buffer.size();
+
+        if (!opened_) {
+            while (pos < buffer.size() && isspace(static_cast<unsigned char>(buffer[pos]))) pos++;
+            if (pos == buffer.size()) {
+                if (last) throw runtime_error("Input is empty, expected a JSON array");
+                return pos;
+            }
+            if (buffer[pos] != '[') throw runtime_error("Expected a JSON array");
+            opened_ = true;
+            pos++;
+        }
+
+        size_t elementStart = pos;
+        int depth = 0;
+        bool inString = false;
+        bool escape = false;
+
+        for (size_t i = pos; i < buffer.size(); ++i) {
+            char c = buffer[i];
+            if (inString) {
+                if (escape) escape = false;
+                else if (c == '\\') escape = true;
+                else if (c == '"') inString = false;
+                continue;
+            }
+
+            if (c == '"') {
+                inString = true;
+            } else if (c == '{' || c == '[') {
+                depth++;
+            } else if (c == '}' || c == ']') {
+                if (depth == 0 && c == ']') {
+                    records.emplace_back(elementStart, i - elementStart);
+                    closed_ = true;
+                    return buffer.size();
+                }
+                depth--;
+            } else if (c == ',' && depth == 0) {
+                records.emplace_back(elementStart, i - elementStart);
+                elementStart = i + 1;
+            }
+        }
+
+        if (last) throw runtime_error("Unterminated JSON array");
+        return elementStart;
+    }
+
+private:
+    bool opened_ = false;
+    bool closed_ = false;
+};
+
+// Параллельный разбор записей; неразобранные и не-объекты остаются null
+vector<json> parseRecords(const string& buffer, const vector<Range>& records, unsigned threads) {
+    vector<json> documents(records.size());
+
+    auto parseRange = [&](size_t from, size_t to) {
+        for (size_t i = from; i < to; ++i) {
+            if (isBlank(buffer, records[i])) continue;
+            const char* begin = buffer.data() + records[i].first;
+            json document = json::parse(begin, begin + records[i].second, nullptr, false);
+            if (!document.is_discarded() && document.is_object()) {
+                documents[i] = move(document);
+            }
+        }
+    };
+
+    size_t workers = min<size_t>(max(1u, threads), records.size() / MIN_RECORDS_PER_THREAD + 1);
+    if (workers == 1) {
+        parseRange(0, records.size());
+        return documents;
+    }
+
+    vector<thread> pool;
+    size_t perWorker = (records.size() + workers - 1) / workers;
+    for (size_t w = 0; w < workers; ++w) {
+        size_t from = w * perWorker;
+        size_t to = min(records.size(), from + perWorker);
+        if (from >= to) break;
+        pool.emplace_back(parseRange, from, to);
+    }
+    for (auto& worker : pool) {
+        worker.join();
+    }
+    return documents;
+}
+
+}  // namespace
+
+BulkFormat parseBulkFormat(const string& name) {
+    if (name == "ndjson" || name == "jsonl") return BulkFormat::NdJson;
+    if (name == "json") return BulkFormat::JsonArray;
+    if (name == "auto") return BulkFormat::Auto;
+    throw runtime_error("Unknown format: " + name + " (expected ndjson or json)");
+}
+
+ImportResult importDocuments(Collection& collection, istream& in, BulkFormat format, unsigned threads) {
+    ImportResult result;
+    ArraySplitter arraySplitter;
+    string buffer;
+    vector<char> block(READ_BLOCK);
+    vector<Range> records;
+
+    bool last = false;
+    while (!last) {
+        in.read(block.data(), block.size());
+        size_t readBytes = static_cast<size_t>(in.gcount());
+        last = readBytes < block.size();
+        buffer.append(block.data(), readBytes);
+
+        if (format == BulkFormat::Auto) {
+            size_t first = buffer.find_first_not_of(" \t\r\n");
+            if (first == string::npos && !last) continue;
+            format = first != string::npos && buffer[first] == '[' ? BulkFormat::JsonArray : BulkFormat::NdJson;
+        }
+
+        records.clear();
+        size_t consumed = format == BulkFormat::JsonArray
+            ? arraySplitter.split(buffer, last, records)
+            : splitLines(buffer, last, records);
+
+        vector<json> documents = parseRecords(buffer, records, threads);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            if (documents[i].is_null() && !isBlank(buffer, records[i])) {
+                result.skipped++;
+            }
+        }
+        documents.erase(remove_if(documents.begin(), documents.end(),
+                                  [](const json& document) { return document.is_null(); }),
+                        documents.end());
+        result.imported += collection.insertBatch(move(documents));
+
+        buffer.erase(0, consumed);
+    }
+
+    return result;
+}
+
+size_t exportDocuments(const Collection& collection, ostream& out, BulkFormat format) {
+    bool array = format == BulkFormat::JsonArray;
+    size_t count = 0;
+
+    if (array) out << "[\n";
+    collection.forEachDocument([&](const json& document) {
+        if (array && count > 0) out << ",\n";
+        out << document.dump();
+        if (!array) out << "\n";
+        count++;
+        return static_cast<bool>(out);
+    });
+    if (array) out << (count > 0 ? "\n]\n" : "]\n");
+
+    return count;
+}
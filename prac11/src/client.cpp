@@ -152,7 +152,7 @@ private:
         operation = trimmed.substr(0, spacePos);
         string rest = trimmed.substr(spacePos + 1);
         
-        size_t bracePos = rest.find('{');
+        size_t bracePos = rest.find_first_of("{[");
         if (bracePos == string::npos) return false;
         
         collection = rest.substr(0, bracePos);
@@ -195,6 +195,7 @@ public:
             cerr << "  INSERT users{'name': 'Alice', 'age': 25}\n";
             cerr << "  FIND users{'age': {'$gt': 20}}\n";
             cerr << "  DELETE users{'name': 'Alice'}\n";
+            cerr << "  AGGREGATE users[{'$group': {'_id': '$city', 'n': {'$sum': 1}}}]\n";
             return false;
         }
         
@@ -215,9 +216,11 @@ public:
             }
         } else if (operation == "FIND" || operation == "DELETE") {
             request["query"] = data;
+        } else if (operation == "AGGREGATE") {
+            request["pipeline"] = data;
         } else {
             cerr << "Error: Unknown operation '" << operation << "'\n";
-            cerr << "Supported operations: INSERT, FIND, DELETE\n";
+            cerr << "Supported operations: INSERT, FIND, DELETE, AGGREGATE\n";
             return false;
         }
         
@@ -1,48 +1,92 @@
 #include "collection.h"
+#include "aggregation.h"
 #include <fstream>
 #include <sstream>
 #include <random>
 #include <algorithm>
 #include <iostream>
+#include <cstdio>
+#include <stdexcept>
+#include <iterator>
 
 using namespace std;
 
+// Список полей индекса: JSON-массив строк в файле рядом с коллекцией
+static vector<string> loadIndexFields(const string& path) {
+    vector<string> fields;
+    ifstream in(path);
+    if (!in.good()) return fields;
+
+    json config = json::parse(in, nullptr, false);
+    if (config.is_array()) {
+        for (const auto& field : config) {
+            if (field.is_string()) fields.push_back(field.get<string>());
+        }
+    }
+    return fields;
+}
+
+static void saveIndexFields(const string& path, const vector<string>& fields) {
+    ofstream out(path);
+    out << json(fields).dump() << "\n";
+    if (!out.good()) throw runtime_error("Cannot write index config: " + path);
+}
+
 Collection::Collection(const string& filePath)
-    : filePath_(filePath), map_(32)
+    : filePath_(filePath), ids_(32)
 {
     load();
+    textFields_ = loadIndexFields(textIndexPath());
+    trigramFields_ = loadIndexFields(trigramIndexPath());
 }
 
 Collection::~Collection() {
-    save();
+    if (dirty_) save();
 }
 
 void Collection::load() {
     ifstream in(filePath_);
     if (!in.good()) return;
 
-    try {
-        json jsonArray;
-        in >> jsonArray;
-        if (!jsonArray.is_array()) return;
-
-        for (const auto& document : jsonArray) {
-            if (document.contains("_id")) {
-                map_.put(document["_id"].get<string>(), document);
+    // Элементы массива переносятся в хранилище по мере разбора и сразу
+    // отбрасываются парсером: общий json-массив в памяти не собирается
+    json::parser_callback_t callback = [this](int depth, json::parse_event_t event, json& parsed) {
+        if (depth == 1 && event == json::parse_event_t::object_end) {
+            auto it = parsed.find("_id");
+            if (it != parsed.end() && it->is_string()) {
+                put(it->get<string>(), parsed);
             }
+            return false;
         }
+        return true;
+    };
+
+    try {
+        // Остается пустой массив: все элементы уже в хранилище
+        json jsonArray = json::parse(in, callback);
     } catch (...) {}
 }
 
 void Collection::save() {
-    auto items = map_.items();
-    json jsonArray = json::array();
-    for (auto& item : items) {
-        jsonArray.push_back(item.second);
+    // Документы пишутся по одному во временный файл, который затем
+    // заменяет основной: общий json-массив в памяти не строится
+    string tempPath = filePath_ + ".tmp";
+    {
+        ofstream out(tempPath);
+        out << "[";
+        bool first = true;
+        store_.forEach([&](CompactStore::Slot, const json& document) {
+            out << (first ? "\n    " : ",\n    ") << document.dump();
+            first = false;
+            return true;
+        });
+        out << (first ? "]" : "\n]");
+        if (!out.good()) return;
     }
 
-    ofstream out(filePath_);
-    out << jsonArray.dump(4);
+    if (rename(tempPath.c_str(), filePath_.c_str()) == 0) {
+        dirty_ = false;
+    }
 }
 
 static string randomHex(size_t length = 16) {
@@ -58,6 +102,21 @@ static string randomHex(size_t length = 16) {
     return result;
 }
 
+void Collection::put(const string& id, const json& document) {
+    auto existing = ids_.get(id);
+    if (existing) {
+        columns_.erase(*existing);
+        if (text_) text_->erase(*existing);
+        if (trigrams_) trigrams_->erase(*existing);
+        store_.remove(*existing);
+    }
+    CompactStore::Slot slot = store_.add(document);
+    columns_.set(slot, document);
+    if (text_) text_->add(slot, document);
+    if (trigrams_) trigrams_->add(slot, document);
+    ids_.put(id, slot);
+}
+
 string Collection::generateId() {
     return randomHex(16);
 }
@@ -66,11 +125,32 @@ string Collection::insert(const json& document) {
     json copy = document;
     string id = generateId();
     copy["_id"] = id;
-    map_.put(id, copy);
+    put(id, copy);
+    dirty_ = true;
     save();
     return id;
 }
 
+size_t Collection::insertBatch(vector<json>&& documents) {
+    size_t inserted = 0;
+    for (auto& document : documents) {
+        if (!document.is_object()) continue;
+
+        auto it = document.find("_id");
+        string id;
+        if (it != document.end() && it->is_string() && !it->get_ref<const string&>().empty()) {
+            id = it->get<string>();
+        } else {
+            id = generateId();
+            document["_id"] = id;
+        }
+        put(id, document);
+        inserted++;
+    }
+    if (inserted > 0) dirty_ = true;
+    return inserted;
+}
+
 bool Collection::matchesCondition(const json& document, const string& field, const json& condition) {
     if (!document.contains(field)) return false;
 
@@ -102,7 +182,7 @@ bool Collection::matchesCondition(const json& document, const string& field, con
 
             } else if (op == "$like") {
                 if (!value.is_string() || !rhs.is_string()) return false;
-                if (value.get<string>() != rhs.get<string>()) return false;
+                if (!matchesLike(value.get_ref<const string&>(), rhs.get_ref<const string&>())) return false;
 
             } else {
                 return false; 
@@ -135,40 +215,203 @@ bool Collection::matchesQuery(const json& document, const json& query) {
         const json& condition = it.value();
         if (key == "$and" || key == "$or") continue;
 
+        // Полнотекстовое условие без индекса - по всем строковым полям
+        if (key == "$text") {
+            fulltext::Query text;
+            if (!fulltext::parseQuery(condition, text) || !fulltext::matches(document, text)) return false;
+            continue;
+        }
+
         if (!matchesCondition(document, key, condition)) return false;
     }
 
     return true;
 }
 
-vector<json> Collection::find(const json& query) {
-    vector<json> result;
-     auto allItems = map_.items();
+bool Collection::prefilter(const json& query, vector<uint64_t>& selection) {
+    // При $or верхнего уровня остальные поля запроса не проверяются
+    if (!query.is_object() || query.contains("$or")) return false;
 
-    for (auto& item : allItems) {
-        if (matchesQuery(item.second, query)) {
-            result.push_back(item.second);
+    size_t slots = store_.slotCount();
+    selection.assign((slots + 63) / 64, ~0ULL);
+
+    bool used = false;
+    for (auto it = query.begin(); it != query.end(); ++it) {
+        const string& field = it.key();
+        if (field.empty() || field[0] == '$' || !NumericColumns::eligible(it.value())) continue;
+
+        // Колонка строится при первом запросе по полю и дальше поддерживается
+        if (!columns_.contains(field)) {
+            if (columns_.full()) continue;
+            columns_.add(field);
+            store_.forEach([&](CompactStore::Slot slot, const json& document) {
+                columns_.fill(field, slot, document);
+                return true;
+            });
+        }
+        used = columns_.select(field, it.value(), slots, selection) || used;
+    }
+    return used;
+}
+
+bool Collection::indexCandidates(const json& query, vector<CompactStore::Slot>& slots, json& rest) {
+    // При $or верхнего уровня остальные поля запроса не проверяются
+    if (!query.is_object() || query.contains("$or")) return false;
+
+    bool narrowed = false;
+    auto narrow = [&](vector<CompactStore::Slot> found) {
+        if (narrowed) {
+            vector<CompactStore::Slot> both;
+            set_intersection(slots.begin(), slots.end(), found.begin(), found.end(), back_inserter(both));
+            found = move(both);
+        }
+        slots = move(found);
+        narrowed = true;
+    };
+
+    rest = query;
+    auto it = query.find("$text");
+    fulltext::Query text;
+    if (!textFields_.empty() && it != query.end() && fulltext::parseQuery(*it, text)) {
+        if (!text_) {
+            text_ = make_unique<TextIndex>(textFields_);
+            store_.forEach([&](CompactStore::Slot slot, const json& document) {
+                text_->add(slot, document);
+                return true;
+            });
         }
+        narrow(text_->search(text));
+        rest.erase("$text");
     }
 
+    // Условия $like остаются в rest: триграммы дают только кандидатов
+    for (auto field = query.begin(); field != query.end() && !trigramFields_.empty(); ++field) {
+        const json& condition = field.value();
+        if (!condition.is_object()) continue;
+        auto like = condition.find("$like");
+        if (like == condition.end() || !like->is_string() ||
+            std::find(trigramFields_.begin(), trigramFields_.end(), field.key()) == trigramFields_.end() ||
+            !TrigramIndex::selective(like->get_ref<const string&>())) {
+            continue;
+        }
+
+        if (!trigrams_) {
+            trigrams_ = make_unique<TrigramIndex>(trigramFields_);
+            store_.forEach([&](CompactStore::Slot slot, const json& document) {
+                trigrams_->add(slot, document);
+                return true;
+            });
+        }
+        narrow(trigrams_->candidates(field.key(), like->get_ref<const string&>()));
+    }
+    return narrowed;
+}
+
+template<typename Func>
+void Collection::scan(const json& query, Func func) {
+    // Условия $text и $like сужают просмотр до документов из индексов
+    vector<CompactStore::Slot> candidates;
+    json rest;
+    if (indexCandidates(query, candidates, rest)) {
+        for (CompactStore::Slot slot : candidates) {
+            json document = store_.get(slot);
+            if (matchesQuery(document, rest) && !func(slot, move(document))) return;
+        }
+        return;
+    }
+
+    vector<uint64_t> selection;
+    if (!prefilter(query, selection)) {
+        store_.forEach([&](CompactStore::Slot slot, json document) {
+            if (!matchesQuery(document, query)) return true;
+            return func(slot, move(document));
+        });
+        return;
+    }
+
+    // Остальные условия запроса проверяются только у отобранных записей
+    for (size_t word = 0; word < selection.size(); ++word) {
+        uint64_t bits = selection[word];
+        while (bits != 0) {
+            CompactStore::Slot slot = static_cast<CompactStore::Slot>(word * 64 + __builtin_ctzll(bits));
+            bits &= bits - 1;
+
+            json document = store_.get(slot);
+            if (matchesQuery(document, query) && !func(slot, move(document))) return;
+        }
+    }
+}
+
+vector<json> Collection::find(const json& query) {
+    vector<json> result;
+
+    scan(query, [&](CompactStore::Slot, json document) {
+        result.push_back(move(document));
+        return true;
+    });
+
     return result;
 }
 
 int Collection::remove(const json& query) {
-    int removedCount = 0;
-    auto allItems = map_.items();
+    vector<pair<string, CompactStore::Slot>> matched;
 
-    for (auto& item : allItems) {
-        if (matchesQuery(item.second, query)) {
-            map_.remove(item.first);
-            ++removedCount;
-        }
+    scan(query, [&](CompactStore::Slot slot, const json& document) {
+        matched.emplace_back(document["_id"].get<string>(), slot);
+        return true;
+    });
+
+    for (const auto& [id, slot] : matched) {
+        ids_.remove(id);
+        columns_.erase(slot);
+        if (text_) text_->erase(slot);
+        if (trigrams_) trigrams_->erase(slot);
+        store_.remove(slot);
     }
+    int removedCount = static_cast<int>(matched.size());
 
-    if (removedCount > 0) save();
+    if (removedCount > 0) {
+        dirty_ = true;
+        save();
+    }
     return removedCount;
 }
 
+vector<json> Collection::aggregate(const json& pipeline) {
+    Aggregator aggregator(pipeline, [this](const json& document, const json& query) {
+        return matchesQuery(document, query);
+    });
+
+    auto consume = [&](CompactStore::Slot, const json& document) {
+        aggregator.consume(document);
+        return !aggregator.done();
+    };
+
+    // Первый $match конвейера отбирает записи через колонки
+    if (pipeline.is_array() && !pipeline.empty() && pipeline[0].is_object() &&
+        pipeline[0].size() == 1 && pipeline[0].contains("$match")) {
+        scan(pipeline[0]["$match"], consume);
+    } else {
+        store_.forEach(consume);
+    }
+
+    return aggregator.finish();
+}
+
 void Collection::createIndex(const string& field) {
     cout << "Index created on field '" << field << "' (stub implementation)\n";
 }
+
+void Collection::createTextIndex(const string& field) {
+    if (std::find(textFields_.begin(), textFields_.end(), field) != textFields_.end()) return;
+    textFields_.push_back(field);
+    text_.reset();
+    saveIndexFields(textIndexPath(), textFields_);
+}
+
+void Collection::createTrigramIndex(const string& field) {
+    if (std::find(trigramFields_.begin(), trigramFields_.end(), field) != trigramFields_.end()) return;
+    trigramFields_.push_back(field);
+    trigrams_.reset();
+    saveIndexFields(trigramIndexPath(), trigramFields_);
+}
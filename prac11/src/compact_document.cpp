@@ -0,0 +1,274 @@
+#include "compact_document.h"
+#include <stdexcept>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+enum Tag : uint8_t {
+    TagNull = 0,
+    TagFalse,
+    TagTrue,
+    TagInteger,   // zigzag varint
+    TagUnsigned,  // varint
+    TagDouble,    // 8 байт
+    TagString,    // varint длины + байты
+    TagArray,     // varint количества + значения
+    TagObject     // varint количества + (varint поля + значение)
+};
+
+void writeVarint(uint64_t value, vector<uint8_t>& out) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+uint64_t readVarint(const uint8_t*& pos) {
+    uint64_t value = 0;
+    int shift = 0;
+    while (*pos & 0x80) {
+        value |= static_cast<uint64_t>(*pos++ & 0x7f) << shift;
+        shift += 7;
+    }
+    value |= static_cast<uint64_t>(*pos++) << shift;
+    return value;
+}
+
+}  // namespace
+
+uint32_t FieldDictionary::fieldId(const string& name) {
+    auto it = nameIds_.find(name);
+    if (it != nameIds_.end()) return it->second;
+
+    uint32_t id = static_cast<uint32_t>(names_.size());
+    names_.push_back(name);
+    nameIds_.emplace(name, id);
+    return id;
+}
+
+uint32_t FieldDictionary::shapeId(const vector<uint32_t>& fields) {
+    auto it = shapeIds_.find(fields);
+    if (it != shapeIds_.end()) return it->second;
+
+    uint32_t id = static_cast<uint32_t>(shapes_.size());
+    shapes_.push_back(fields);
+    shapeIds_.emplace(fields, id);
+    return id;
+}
+
+size_t FieldDictionary::memoryUsage() const {
+    size_t bytes = 0;
+    for (const auto& name : names_) {
+        bytes += sizeof(string) + name.capacity() + sizeof(uint32_t);
+    }
+    for (const auto& shape : shapes_) {
+        bytes += 2 * (sizeof(shape) + shape.capacity() * sizeof(uint32_t));
+    }
+    return bytes;
+}
+
+void FieldDictionary::clear() {
+    names_.clear();
+    nameIds_.clear();
+    shapes_.clear();
+    shapeIds_.clear();
+}
+
+void CompactStore::encodeValue(const json& value, vector<uint8_t>& out) {
+    switch (value.type()) {
+        case json::value_t::null:
+            out.push_back(TagNull);
+            break;
+        case json::value_t::boolean:
+            out.push_back(value.get<bool>() ? TagTrue : TagFalse);
+            break;
+        case json::value_t::number_integer: {
+            int64_t number = value.get<int64_t>();
+            out.push_back(TagInteger);
+            writeVarint((static_cast<uint64_t>(number) << 1) ^ static_cast<uint64_t>(number >> 63), out);
+            break;
+        }
+        case json::value_t::number_unsigned:
+            out.push_back(TagUnsigned);
+            writeVarint(value.get<uint64_t>(), out);
+            break;
+        case json::value_t::number_float: {
+            double number = value.get<double>();
+            uint8_t bytes[sizeof(double)];
+            memcpy(bytes, &number, sizeof(double));
+            out.push_back(TagDouble);
+            out.insert(out.end(), bytes, bytes + sizeof(double));
+            break;
+        }
+        case json::value_t::string: {
+            const string& str = value.get_ref<const string&>();
+            out.push_back(TagString);
+            writeVarint(str.size(), out);
+            out.insert(out.end(), str.begin(), str.end());
+            break;
+        }
+        case json::value_t::array:
+            out.push_back(TagArray);
+            writeVarint(value.size(), out);
+            for (const auto& item : value) {
+                encodeValue(item, out);
+            }
+            break;
+        case json::value_t::object:
+            // Вложенные объекты редки: имена их полей тоже интернируются,
+            // но номер поля пишется рядом со значением
+            out.push_back(TagObject);
+            writeVarint(value.size(), out);
+            for (auto it = value.begin(); it != value.end(); ++it) {
+                writeVarint(dictionary_.fieldId(it.key()), out);
+                encodeValue(it.value(), out);
+            }
+            break;
+        default:
+            throw runtime_error("Unsupported value type in document");
+    }
+}
+
+json CompactStore::decodeValue(const uint8_t*& pos) const {
+    uint8_t tag = *pos++;
+    switch (tag) {
+        case TagNull:
+            return nullptr;
+        case TagFalse:
+            return false;
+        case TagTrue:
+            return true;
+        case TagInteger: {
+            uint64_t zigzag = readVarint(pos);
+            return static_cast<int64_t>((zigzag >> 1) ^ (~(zigzag & 1) + 1));
+        }
+        case TagUnsigned:
+            return readVarint(pos);
+        case TagDouble: {
+            double number;
+            memcpy(&number, pos, sizeof(double));
+            pos += sizeof(double);
+            return number;
+        }
+        case TagString: {
+            size_t length = readVarint(pos);
+            json str = string(reinterpret_cast<const char*>(pos), length);
+            pos += length;
+            return str;
+        }
+        case TagArray: {
+            size_t count = readVarint(pos);
+            json array = json::array();
+            array.get_ref<json::array_t&>().reserve(count);
+            for (size_t i = 0; i < count; ++i) {
+                array.push_back(decodeValue(pos));
+            }
+            return array;
+        }
+        case TagObject: {
+            size_t count = readVarint(pos);
+            json object = json::object();
+            for (size_t i = 0; i < count; ++i) {
+                const string& name = dictionary_.fieldName(static_cast<uint32_t>(readVarint(pos)));
+                object[name] = decodeValue(pos);
+            }
+            return object;
+        }
+        default:
+            throw runtime_error("Corrupted compact document");
+    }
+}
+
+CompactStore::Slot CompactStore::add(const json& document) {
+    if (!document.is_object()) {
+        throw runtime_error("Document must be a JSON object");
+    }
+
+    vector<uint32_t> fields;
+    fields.reserve(document.size());
+    for (auto it = document.begin(); it != document.end(); ++it) {
+        fields.push_back(dictionary_.fieldId(it.key()));
+    }
+
+    Record record;
+    record.shape = dictionary_.shapeId(fields);
+    record.offset = arena_.size();
+    for (auto it = document.begin(); it != document.end(); ++it) {
+        encodeValue(it.value(), arena_);
+    }
+    record.length = static_cast<uint32_t>(arena_.size() - record.offset);
+
+    Slot slot;
+    if (!freeSlots_.empty()) {
+        slot = freeSlots_.back();
+        freeSlots_.pop_back();
+        records_[slot] = record;
+    } else {
+        slot = static_cast<Slot>(records_.size());
+        records_.push_back(record);
+    }
+    live_++;
+    return slot;
+}
+
+json CompactStore::get(Slot slot) const {
+    const Record& record = records_.at(slot);
+    if (record.shape == FREE) {
+        throw runtime_error("Document slot is empty");
+    }
+
+    json document = json::object();
+    auto& object = document.get_ref<json::object_t&>();
+    const uint8_t* pos = arena_.data() + record.offset;
+    // Поля формы уже упорядочены так же, как ключи json-объекта
+    for (uint32_t field : dictionary_.shape(record.shape)) {
+        object.emplace_hint(object.end(), dictionary_.fieldName(field), decodeValue(pos));
+    }
+    return document;
+}
+
+void CompactStore::remove(Slot slot) {
+    Record& record = records_.at(slot);
+    if (record.shape == FREE) return;
+
+    garbage_ += record.length;
+    record.shape = FREE;
+    freeSlots_.push_back(slot);
+    live_--;
+
+    // Буфер уплотняется, когда удаленные документы занимают больше половины
+    if (garbage_ > 64 * 1024 && garbage_ * 2 > arena_.size()) {
+        compact();
+    }
+}
+
+void CompactStore::compact() {
+    vector<uint8_t> arena;
+    arena.reserve(arena_.size() - garbage_);
+    for (Record& record : records_) {
+        if (record.shape == FREE) continue;
+        uint64_t offset = arena.size();
+        arena.insert(arena.end(), arena_.begin() + record.offset,
+                     arena_.begin() + record.offset + record.length);
+        record.offset = offset;
+    }
+    arena_ = move(arena);
+    garbage_ = 0;
+}
+
+void CompactStore::clear() {
+    dictionary_.clear();
+    arena_.clear();
+    records_.clear();
+    freeSlots_.clear();
+    live_ = 0;
+    garbage_ = 0;
+}
+
+size_t CompactStore::memoryUsage() const {
+    return arena_.capacity() + records_.capacity() * sizeof(Record) +
+           freeSlots_.capacity() * sizeof(Slot) + dictionary_.memoryUsage();
+}
@@ -1,9 +1,11 @@
 #include "db.h"
+#include "bulk_io.h"
 #include "json.hpp"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <thread>
 using namespace std;
 using json = nlohmann::json;
 
@@ -12,13 +14,24 @@ static string readJsonArgFromArgv(int argc, char** argv, int index) {
     return string(argv[index]);
 }
 
+// Опции вида --name value после позиционных аргументов
+static string optionValue(int argc, char** argv, int from, const string& name, const string& fallback) {
+    for (int i = from; i + 1 < argc; ++i) {
+        if (argv[i] == name) return argv[i + 1];
+    }
+    return fallback;
+}
+
 int main(int argc, char** argv) {
     if (argc < 3) {
         cout << "Usage:\n"
                   << "  " << argv[0] << " <db_dir> insert '<json_doc>'\n"
                   << "  " << argv[0] << " <db_dir> find '<json_query>'\n"
                   << "  " << argv[0] << " <db_dir> delete '<json_query>'\n"
-                  << "  " << argv[0] << " <db_dir> createIndex <field>\n";
+                  << "  " << argv[0] << " <db_dir> createIndex <field> [text|trigram]\n"
+                  << "  " << argv[0] << " <db_dir> stats\n"
+                  << "  " << argv[0] << " <db_dir> import <file|-> [--format ndjson|json] [--threads N]\n"
+                  << "  " << argv[0] << " <db_dir> export <file|-> [--format ndjson|json]\n";
         return 1;
     }
 
@@ -104,7 +117,82 @@ int main(int argc, char** argv) {
             }
 
             string fieldName = argv[3];
-            collection->createIndex(fieldName);
+            string type = argc > 4 ? argv[4] : "";
+            if (type == "text") {
+                collection->createTextIndex(fieldName);
+                cout << "Text index created on field '" << fieldName << "'\n";
+            } else if (type == "trigram") {
+                collection->createTrigramIndex(fieldName);
+                cout << "Trigram index created on field '" << fieldName << "'\n";
+            } else {
+                collection->createIndex(fieldName);
+            }
+            return 0;
+
+        } else if (command == "stats") {
+            cout << "Documents: " << collection->size() << "\n"
+                 << "Memory: " << collection->memoryUsage() << " bytes\n";
+            return 0;
+
+        } else if (command == "import") {
+            if (argc < 4) {
+                cout << "Missing input file\n";
+                return 1;
+            }
+
+            string path = argv[3];
+            BulkFormat format = parseBulkFormat(optionValue(argc, argv, 4, "--format", "auto"));
+            unsigned threads = max(1u, thread::hardware_concurrency());
+            threads = static_cast<unsigned>(stoul(optionValue(argc, argv, 4, "--threads", to_string(threads))));
+
+            ifstream file;
+            if (path != "-") {
+                file.open(path, ios::binary);
+                if (!file.good()) {
+                    cout << "Cannot open " << path << "\n";
+                    return 1;
+                }
+            }
+            istream& in = path == "-" ? cin : file;
+
+            ImportResult result = importDocuments(*collection, in, format, threads);
+            collection->save();
+
+            cout << "Imported " << result.imported << " document(s)\n";
+            if (result.skipped > 0) {
+                cout << "Skipped " << result.skipped << " invalid record(s)\n";
+            }
+            return 0;
+
+        } else if (command == "export") {
+            if (argc < 4) {
+                cout << "Missing output file\n";
+                return 1;
+            }
+
+            string path = argv[3];
+            BulkFormat format = parseBulkFormat(optionValue(argc, argv, 4, "--format", "ndjson"));
+            if (format == BulkFormat::Auto) format = BulkFormat::NdJson;
+
+            if (path == "-") {
+                size_t count = exportDocuments(*collection, cout, format);
+                cout.flush();
+                cerr << "Exported " << count << " document(s)\n";
+                return 0;
+            }
+
+            ofstream out(path, ios::binary);
+            if (!out.good()) {
+                cout << "Cannot open " << path << "\n";
+                return 1;
+            }
+            size_t count = exportDocuments(*collection, out, format);
+            out.close();
+            if (!out) {
+                cout << "Write to " << path << " failed\n";
+                return 1;
+            }
+            cout << "Exported " << count << " document(s)\n";
             return 0;
 
         } else {
@@ -0,0 +1,133 @@
+#include "numeric_columns.h"
+#include "simd_kernels.h"
+#include <cmath>
+
+using namespace std;
+
+namespace {
+
+// Целые больше 2^53 теряют точность в double
+constexpr double EXACT_LIMIT = 9007199254740992.0;
+
+bool isNumericSet(const json& set) {
+    if (!set.is_array() || set.empty() || set.size() > NumericColumns::MAX_IN_SET) return false;
+    for (const auto& item : set) {
+        if (!item.is_number()) return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+bool NumericColumns::eligible(const json& condition) {
+    if (condition.is_number()) return true;
+    if (!condition.is_object() || condition.empty()) return false;
+
+    for (auto it = condition.begin(); it != condition.end(); ++it) {
+        const string& op = it.key();
+        if (op == "$gt" || op == "$lt" || op == "$eq") {
+            if (!it.value().is_number()) return false;
+        } else if (op == "$in") {
+            if (!isNumericSet(it.value())) return false;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+void NumericColumns::add(const string& field) {
+    columns_.emplace(field, Column());
+}
+
+void NumericColumns::assign(Column& column, CompactStore::Slot slot, const json& document, const string& field) {
+    if (column.values.size() <= slot) {
+        column.values.resize(slot + 1, 0.0);
+        column.valid.resize(slot / 64 + 1, 0);
+    }
+
+    uint64_t bit = 1ULL << (slot % 64);
+    auto it = document.find(field);
+    if (it == document.end() || !it->is_number()) {
+        column.values[slot] = 0.0;
+        column.valid[slot / 64] &= ~bit;
+        return;
+    }
+
+    double value = it->get<double>();
+    if (!it->is_number_float() && fabs(value) > EXACT_LIMIT) {
+        column.exact = false;
+    }
+    column.values[slot] = value;
+    column.valid[slot / 64] |= bit;
+}
+
+void NumericColumns::fill(const string& field, CompactStore::Slot slot, const json& document) {
+    auto it = columns_.find(field);
+    if (it != columns_.end()) {
+        assign(it->second, slot, document, field);
+    }
+}
+
+void NumericColumns::set(CompactStore::Slot slot, const json& document) {
+    for (auto& [field, column] : columns_) {
+        assign(column, slot, document, field);
+    }
+}
+
+void NumericColumns::erase(CompactStore::Slot slot) {
+    for (auto& [field, column] : columns_) {
+        if (slot < column.values.size()) {
+            column.valid[slot / 64] &= ~(1ULL << (slot % 64));
+        }
+    }
+}
+
+bool NumericColumns::select(const string& field, const json& condition, size_t slotCount,
+                            vector<uint64_t>& selection) const {
+    auto found = columns_.find(field);
+    if (found == columns_.end() || !eligible(condition)) return false;
+    const Column& column = found->second;
+
+    // Простое равенство и $eq/$in требуют точного представления целых
+    bool needsEquality = condition.is_number() || condition.contains("$eq") || condition.contains("$in");
+    if (needsEquality && !column.exact) return false;
+
+    size_t count = min(column.values.size(), slotCount);
+    size_t words = (count + 63) / 64;
+    vector<uint64_t> matched(words);
+
+    auto apply = [&]() {
+        for (size_t w = 0; w < words; ++w) {
+            selection[w] &= matched[w] & column.valid[w];
+        }
+    };
+
+    if (condition.is_number()) {
+        simd::compare(column.values.data(), count, simd::CompareOp::Equal, condition.get<double>(), matched.data());
+        apply();
+    } else {
+        for (auto it = condition.begin(); it != condition.end(); ++it) {
+            const string& op = it.key();
+            if (op == "$in") {
+                vector<double> set;
+                for (const auto& item : it.value()) {
+                    set.push_back(item.get<double>());
+                }
+                simd::inSet(column.values.data(), count, set.data(), set.size(), matched.data());
+            } else {
+                simd::CompareOp compareOp = op == "$gt" ? simd::CompareOp::Greater
+                                          : op == "$lt" ? simd::CompareOp::Less
+                                          : simd::CompareOp::Equal;
+                simd::compare(column.values.data(), count, compareOp, it.value().get<double>(), matched.data());
+            }
+            apply();
+        }
+    }
+
+    // Записи за концом колонки не содержат числового значения поля
+    for (size_t w = words; w < selection.size(); ++w) {
+        selection[w] = 0;
+    }
+    return true;
+}
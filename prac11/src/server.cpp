@@ -150,6 +150,30 @@ json DatabaseServer::executeDelete(const string& dbName, const string& collectio
     return response;
 }
 
+json DatabaseServer::executeAggregate(const string& dbName, const string& collectionName, const json& pipeline) {
+    json response;
+    
+    try {
+        Database db(dbDir_ + "/" + dbName);
+        auto collection = db.openCollection(collectionName);
+        
+        auto results = collection->aggregate(pipeline);
+        
+        response["status"] = "success";
+        response["message"] = "Aggregated " + to_string(results.size()) + " result(s) from " + dbName;
+        response["data"] = results;
+        response["count"] = results.size();
+        
+    } catch (const exception& e) {
+        response["status"] = "error";
+        response["message"] = string("Aggregate failed: ") + e.what();
+        response["count"] = 0;
+        response["data"] = json::array();
+    }
+    
+    return response;
+}
+
 json DatabaseServer::processRequest(const json& request) {
     json response;
     
@@ -205,9 +229,19 @@ json DatabaseServer::processRequest(const json& request) {
                 response = executeDelete(dbName, collectionName, request["query"]);
             }
             
+        } else if (operationLower == "aggregate") {
+            if (!request.contains("pipeline") || !request["pipeline"].is_array()) {
+                response["status"] = "error";
+                response["message"] = "Aggregate operation requires 'pipeline' array";
+                response["count"] = 0;
+                response["data"] = json::array();
+            } else {
+                response = executeAggregate(dbName, collectionName, request["pipeline"]);
+            }
+            
         } else {
             response["status"] = "error";
-            response["message"] = "Unknown operation: " + operation + " (supported: insert, find, delete)";
+            response["message"] = "Unknown operation: " + operation + " (supported: insert, find, delete, aggregate)";
             response["count"] = 0;
             response["data"] = json::array();
         }
@@ -0,0 +1,200 @@
+#include "simd_kernels.h"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_X86 1
+#endif
+
+namespace simd {
+namespace {
+
+enum class Kernel { Scalar, Sse2, Avx2 };
+
+constexpr size_t MAX_VECTOR_SET = 16;
+
+template<CompareOp Op>
+inline bool test(double value, double operand) {
+    if constexpr (Op == CompareOp::Greater) return value > operand;
+    else if constexpr (Op == CompareOp::Less) return value < operand;
+    else return value == operand;
+}
+
+template<CompareOp Op>
+void compareScalar(const double* values, size_t count, double operand, uint64_t* selection) {
+    for (size_t base = 0; base < count; base += 64) {
+        size_t end = std::min(count, base + 64);
+        uint64_t bits = 0;
+        for (size_t i = base; i < end; ++i) {
+            bits |= static_cast<uint64_t>(test<Op>(values[i], operand)) << (i - base);
+        }
+        selection[base / 64] = bits;
+    }
+}
+
+void inSetScalar(const double* values, size_t count, const double* set, size_t setSize, uint64_t* selection) {
+    for (size_t base = 0; base < count; base += 64) {
+        size_t end = std::min(count, base + 64);
+        uint64_t bits = 0;
+        for (size_t i = base; i < end; ++i) {
+            bool found = false;
+            for (size_t k = 0; k < setSize && !found; ++k) {
+                found = values[i] == set[k];
+            }
+            bits |= static_cast<uint64_t>(found) << (i - base);
+        }
+        selection[base / 64] = bits;
+    }
+}
+
+#ifdef SIMD_X86
+
+// Полные слова по 64 значения считаются векторно, хвост - скалярно
+template<CompareOp Op>
+__attribute__((target("sse2")))
+void compareSse2(const double* values, size_t count, double operand, uint64_t* selection) {
+    const size_t fullWords = count / 64;
+    const __m128d rhs = _mm_set1_pd(operand);
+    for (size_t w = 0; w < fullWords; ++w) {
+        const double* block = values + w * 64;
+        uint64_t bits = 0;
+        for (size_t j = 0; j < 32; ++j) {
+            __m128d v = _mm_loadu_pd(block + j * 2);
+            __m128d mask;
+            if constexpr (Op == CompareOp::Greater) mask = _mm_cmpgt_pd(v, rhs);
+            else if constexpr (Op == CompareOp::Less) mask = _mm_cmplt_pd(v, rhs);
+            else mask = _mm_cmpeq_pd(v, rhs);
+            bits |= static_cast<uint64_t>(_mm_movemask_pd(mask)) << (j * 2);
+        }
+        selection[w] = bits;
+    }
+    compareScalar<Op>(values + fullWords * 64, count - fullWords * 64, operand, selection + fullWords);
+}
+
+template<CompareOp Op>
+__attribute__((target("avx2")))
+void compareAvx2(const double* values, size_t count, double operand, uint64_t* selection) {
+    const size_t fullWords = count / 64;
+    const __m256d rhs = _mm256_set1_pd(operand);
+    for (size_t w = 0; w < fullWords; ++w) {
+        const double* block = values + w * 64;
+        uint64_t bits = 0;
+        for (size_t j = 0; j < 16; ++j) {
+            __m256d v = _mm256_loadu_pd(block + j * 4);
+            __m256d mask;
+            if constexpr (Op == CompareOp::Greater) mask = _mm256_cmp_pd(v, rhs, _CMP_GT_OQ);
+            else if constexpr (Op == CompareOp::Less) mask = _mm256_cmp_pd(v, rhs, _CMP_LT_OQ);
+            else mask = _mm256_cmp_pd(v, rhs, _CMP_EQ_OQ);
+            bits |= static_cast<uint64_t>(_mm256_movemask_pd(mask)) << (j * 4);
+        }
+        selection[w] = bits;
+    }
+    compareScalar<Op>(values + fullWords * 64, count - fullWords * 64, operand, selection + fullWords);
+}
+
+__attribute__((target("sse2")))
+void inSetSse2(const double* values, size_t count, const double* set, size_t setSize, uint64_t* selection) {
+    const size_t fullWords = count / 64;
+    __m128d broadcast[MAX_VECTOR_SET];
+    for (size_t k = 0; k < setSize; ++k) {
+        broadcast[k] = _mm_set1_pd(set[k]);
+    }
+    for (size_t w = 0; w < fullWords; ++w) {
+        const double* block = values + w * 64;
+        uint64_t bits = 0;
+        for (size_t j = 0; j < 32; ++j) {
+            __m128d v = _mm_loadu_pd(block + j * 2);
+            __m128d mask = _mm_setzero_pd();
+            for (size_t k = 0; k < setSize; ++k) {
+                mask = _mm_or_pd(mask, _mm_cmpeq_pd(v, broadcast[k]));
+            }
+            bits |= static_cast<uint64_t>(_mm_movemask_pd(mask)) << (j * 2);
+        }
+        selection[w] = bits;
+    }
+    inSetScalar(values + fullWords * 64, count - fullWords * 64, set, setSize, selection + fullWords);
+}
+
+__attribute__((target("avx2")))
+void inSetAvx2(const double* values, size_t count, const double* set, size_t setSize, uint64_t* selection) {
+    const size_t fullWords = count / 64;
+    __m256d broadcast[MAX_VECTOR_SET];
+    for (size_t k = 0; k < setSize; ++k) {
+        broadcast[k] = _mm256_set1_pd(set[k]);
+    }
+    for (size_t w = 0; w < fullWords; ++w) {
+        const double* block = values + w * 64;
+        uint64_t bits = 0;
+        for (size_t j = 0; j < 16; ++j) {
+            __m256d v = _mm256_loadu_pd(block + j * 4);
+            __m256d mask = _mm256_setzero_pd();
+            for (size_t k = 0; k < setSize; ++k) {
+                mask = _mm256_or_pd(mask, _mm256_cmp_pd(v, broadcast[k], _CMP_EQ_OQ));
+            }
+            bits |= static_cast<uint64_t>(_mm256_movemask_pd(mask)) << (j * 4);
+        }
+        selection[w] = bits;
+    }
+    inSetScalar(values + fullWords * 64, count - fullWords * 64, set, setSize, selection + fullWords);
+}
+
+#endif  // SIMD_X86
+
+Kernel detectKernel() {
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return Kernel::Avx2;
+    if (__builtin_cpu_supports("sse2")) return Kernel::Sse2;
+#endif
+    return Kernel::Scalar;
+}
+
+Kernel activeKernelType() {
+    static const Kernel kernel = detectKernel();
+    return kernel;
+}
+
+template<CompareOp Op>
+void compareDispatch(const double* values, size_t count, double operand, uint64_t* selection) {
+#ifdef SIMD_X86
+    switch (activeKernelType()) {
+        case Kernel::Avx2: return compareAvx2<Op>(values, count, operand, selection);
+        case Kernel::Sse2: return compareSse2<Op>(values, count, operand, selection);
+        case Kernel::Scalar: break;
+    }
+#endif
+    compareScalar<Op>(values, count, operand, selection);
+}
+
+}  // namespace
+
+void compare(const double* values, size_t count, CompareOp op, double operand, uint64_t* selection) {
+    switch (op) {
+        case CompareOp::Greater: return compareDispatch<CompareOp::Greater>(values, count, operand, selection);
+        case CompareOp::Less: return compareDispatch<CompareOp::Less>(values, count, operand, selection);
+        case CompareOp::Equal: return compareDispatch<CompareOp::Equal>(values, count, operand, selection);
+    }
+}
+
+void inSet(const double* values, size_t count, const double* set, size_t setSize, uint64_t* selection) {
+#ifdef SIMD_X86
+    if (setSize <= MAX_VECTOR_SET) {
+        switch (activeKernelType()) {
+            case Kernel::Avx2: return inSetAvx2(values, count, set, setSize, selection);
+            case Kernel::Sse2: return inSetSse2(values, count, set, setSize, selection);
+            case Kernel::Scalar: break;
+        }
+    }
+#endif
+    inSetScalar(values, count, set, setSize, selection);
+}
+
+const char* activeKernel() {
+    switch (activeKernelType()) {
+        case Kernel::Avx2: return "avx2";
+        case Kernel::Sse2: return "sse2";
+        default: return "scalar";
+    }
+}
+
+}  // namespace simd
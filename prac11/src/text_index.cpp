@@ -0,0 +1,213 @@
+#include "text_index.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+constexpr uint32_t MAX_POSITION = (1u << 24) - 1;
+constexpr size_t MAX_FIELDS = 256;
+
+bool isWordByte(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c >= 0x80;
+}
+
+bool containsPhrase(const vector<string>& tokens, const vector<string>& phrase) {
+    if (phrase.size() > tokens.size()) return false;
+    for (size_t i = 0; i + phrase.size() <= tokens.size(); ++i) {
+        if (equal(phrase.begin(), phrase.end(), tokens.begin() + i)) return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+namespace fulltext {
+
+void tokenize(const string& text, vector<string>& tokens) {
+    string current;
+    for (unsigned char c : text) {
+        if (isWordByte(c)) {
+            current.push_back(c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : static_cast<char>(c));
+        } else if (!current.empty()) {
+            tokens.push_back(move(current));
+            current.clear();
+        }
+    }
+    if (!current.empty()) tokens.push_back(move(current));
+}
+
+bool parseQuery(const json& condition, Query& query) {
+    if (!condition.is_object()) return false;
+    auto it = condition.find("$search");
+    if (it == condition.end() || !it->is_string()) return false;
+
+    const string& search = it->get_ref<const string&>();
+    size_t pos = 0;
+    while (pos < search.size()) {
+        size_t quote = search.find('"', pos);
+        vector<string> words;
+        tokenize(search.substr(pos, quote == string::npos ? string::npos : quote - pos), words);
+        for (auto& word : words) {
+            query.phrases.push_back({move(word)});
+        }
+        if (quote == string::npos) break;
+
+        size_t close = search.find('"', quote + 1);
+        vector<string> phrase;
+        tokenize(search.substr(quote + 1, close == string::npos ? string::npos : close - quote - 1), phrase);
+        if (!phrase.empty()) query.phrases.push_back(move(phrase));
+        pos = close == string::npos ? search.size() : close + 1;
+    }
+    return true;
+}
+
+bool matches(const json& document, const Query& query) {
+    if (query.empty() || !document.is_object()) return false;
+
+    vector<vector<string>> fieldTokens;
+    for (const auto& value : document) {
+        if (!value.is_string()) continue;
+        fieldTokens.emplace_back();
+        tokenize(value.get_ref<const string&>(), fieldTokens.back());
+    }
+
+    for (const auto& phrase : query.phrases) {
+        bool found = any_of(fieldTokens.begin(), fieldTokens.end(),
+                            [&](const vector<string>& tokens) { return containsPhrase(tokens, phrase); });
+        if (!found) return false;
+    }
+    return true;
+}
+
+}  // namespace fulltext
+
+TextIndex::TextIndex(vector<string> fields) : fields_(move(fields)) {
+    if (fields_.size() > MAX_FIELDS) fields_.resize(MAX_FIELDS);
+}
+
+void TextIndex::add(CompactStore::Slot slot, const json& document) {
+    erase(slot);
+
+    uint32_t doc = static_cast<uint32_t>(slots_.size());
+    slots_.push_back(slot);
+    if (numbers_.size() <= slot) numbers_.resize(slot + 1, NONE);
+    numbers_[slot] = doc;
+    live_++;
+
+    vector<string> tokens;
+    for (size_t field = 0; field < fields_.size(); ++field) {
+        auto it = document.find(fields_[field]);
+        if (it == document.end() || !it->is_string()) continue;
+
+        tokens.clear();
+        fulltext::tokenize(it->get_ref<const string&>(), tokens);
+        for (size_t i = 0; i < tokens.size() && i <= MAX_POSITION; ++i) {
+            uint32_t position = static_cast<uint32_t>(field << 24) | static_cast<uint32_t>(i);
+            postings_[tokens[i]].push_back({doc, position});
+        }
+    }
+}
+
+void TextIndex::erase(CompactStore::Slot slot) {
+    if (slot >= numbers_.size() || numbers_[slot] == NONE) return;
+    slots_[numbers_[slot]] = NONE;
+    numbers_[slot] = NONE;
+    live_--;
+
+    // Вхождения удаленных документов вычищаются, когда их больше живых
+    size_t dead = slots_.size() - live_;
+    if (dead > 1024 && dead > live_) compact();
+}
+
+void TextIndex::compact() {
+    vector<uint32_t> renumber(slots_.size(), NONE);
+    vector<CompactStore::Slot> slots;
+    slots.reserve(live_);
+    for (uint32_t doc = 0; doc < slots_.size(); ++doc) {
+        if (slots_[doc] == NONE) continue;
+        renumber[doc] = static_cast<uint32_t>(slots.size());
+        numbers_[slots_[doc]] = renumber[doc];
+        slots.push_back(slots_[doc]);
+    }
+
+    for (auto it = postings_.begin(); it != postings_.end();) {
+        Postings kept;
+        for (const auto& posting : it->second) {
+            if (renumber[posting.doc] != NONE) kept.push_back({renumber[posting.doc], posting.position});
+        }
+        if (kept.empty()) {
+            it = postings_.erase(it);
+        } else {
+            it->second = move(kept);
+            ++it;
+        }
+    }
+    slots_ = move(slots);
+}
+
+pair<TextIndex::Postings::const_iterator, TextIndex::Postings::const_iterator>
+TextIndex::occurrences(const Postings& list, uint32_t doc) {
+    auto first = lower_bound(list.begin(), list.end(), doc,
+                             [](const Posting& posting, uint32_t value) { return posting.doc < value; });
+    auto last = first;
+    while (last != list.end() && last->doc == doc) ++last;
+    return {first, last};
+}
+
+bool TextIndex::hasPhrase(uint32_t doc, const vector<const Postings*>& lists) const {
+    auto [begin, end] = occurrences(*lists[0], doc);
+    for (auto it = begin; it != end; ++it) {
+        bool all = true;
+        for (size_t i = 1; i < lists.size() && all; ++i) {
+            auto [first, last] = occurrences(*lists[i], doc);
+            uint32_t expected = it->position + static_cast<uint32_t>(i);
+            all = any_of(first, last, [&](const Posting& posting) { return posting.position == expected; });
+        }
+        if (all) return true;
+    }
+    return false;
+}
+
+vector<CompactStore::Slot> TextIndex::search(const fulltext::Query& query) const {
+    vector<CompactStore::Slot> result;
+    if (query.empty()) return result;
+
+    // Слово без вхождений - пустой результат
+    vector<vector<const Postings*>> phraseLists;
+    const Postings* shortest = nullptr;
+    for (const auto& phrase : query.phrases) {
+        vector<const Postings*> lists;
+        for (const auto& word : phrase) {
+            auto found = postings_.find(word);
+            if (found == postings_.end()) return result;
+            lists.push_back(&found->second);
+            if (!shortest || found->second.size() < shortest->size()) shortest = &found->second;
+        }
+        phraseLists.push_back(move(lists));
+    }
+
+    // Кандидаты - документы самого редкого слова, остальные слова и фразы
+    // проверяются двоичным поиском по своим спискам
+    uint32_t previous = NONE;
+    for (const auto& posting : *shortest) {
+        uint32_t doc = posting.doc;
+        if (doc == previous || slots_[doc] == NONE) continue;
+        previous = doc;
+
+        bool all = true;
+        for (const auto& lists : phraseLists) {
+            if (lists.size() == 1) {
+                auto [first, last] = occurrences(*lists[0], doc);
+                all = first != last;
+            } else {
+                all = hasPhrase(doc, lists);
+            }
+            if (!all) break;
+        }
+        if (all) result.push_back(slots_[doc]);
+    }
+
+    sort(result.begin(), result.end());
+    return result;
+}
@@ -0,0 +1,181 @@
+#include "trigram_index.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+constexpr char BEGIN = '\x01';
+constexpr char END = '\x02';
+constexpr size_t MAX_FIELDS = 256;
+
+char lower(char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// Ключ: номер поля в старшем байте, три байта триграммы - в младших
+uint32_t trigramKey(size_t field, const string& text, size_t pos) {
+    return static_cast<uint32_t>(field) << 24 |
+           static_cast<uint32_t>(static_cast<unsigned char>(text[pos])) << 16 |
+           static_cast<uint32_t>(static_cast<unsigned char>(text[pos + 1])) << 8 |
+           static_cast<uint32_t>(static_cast<unsigned char>(text[pos + 2]));
+}
+
+// Куски шаблона без '%' и '_' в нижнем регистре; кусок на краю шаблона
+// получает маркер начала или конца строки
+vector<string> patternRuns(const string& pattern) {
+    vector<string> runs;
+    string run;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        char c = pattern[i];
+        if (c == '%' || c == '_') {
+            if (!run.empty()) runs.push_back(move(run));
+            run.clear();
+            continue;
+        }
+        if (i == 0) run.push_back(BEGIN);
+        run.push_back(lower(c));
+    }
+    if (!run.empty()) {
+        run.push_back(END);
+        runs.push_back(move(run));
+    }
+    return runs;
+}
+
+}  // namespace
+
+bool matchesLike(const string& text, const string& pattern) {
+    // Жадное сопоставление с возвратом к последнему '%'
+    size_t t = 0, p = 0;
+    size_t starP = string::npos, starT = 0;
+    while (t < text.size()) {
+        if (p < pattern.size() && (pattern[p] == '_' || (pattern[p] != '%' && lower(pattern[p]) == lower(text[t])))) {
+            t++;
+            p++;
+        } else if (p < pattern.size() && pattern[p] == '%') {
+            starP = p++;
+            starT = t;
+        } else if (starP != string::npos) {
+            p = starP + 1;
+            t = ++starT;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '%') p++;
+    return p == pattern.size();
+}
+
+TrigramIndex::TrigramIndex(vector<string> fields) : fields_(move(fields)) {
+    if (fields_.size() > MAX_FIELDS) fields_.resize(MAX_FIELDS);
+}
+
+bool TrigramIndex::selective(const string& pattern) {
+    for (const auto& run : patternRuns(pattern)) {
+        if (run.size() >= 3) return true;
+    }
+    return false;
+}
+
+int TrigramIndex::fieldNumber(const string& field) const {
+    auto it = find(fields_.begin(), fields_.end(), field);
+    return it == fields_.end() ? -1 : static_cast<int>(it - fields_.begin());
+}
+
+bool TrigramIndex::indexes(const string& field) const {
+    return fieldNumber(field) >= 0;
+}
+
+void TrigramIndex::add(CompactStore::Slot slot, const json& document) {
+    erase(slot);
+
+    uint32_t doc = static_cast<uint32_t>(slots_.size());
+    slots_.push_back(slot);
+    if (numbers_.size() <= slot) numbers_.resize(slot + 1, NONE);
+    numbers_[slot] = doc;
+    live_++;
+
+    string text;
+    for (size_t field = 0; field < fields_.size(); ++field) {
+        auto it = document.find(fields_[field]);
+        if (it == document.end() || !it->is_string()) continue;
+
+        const string& value = it->get_ref<const string&>();
+        text.assign(1, BEGIN);
+        for (char c : value) text.push_back(lower(c));
+        text.push_back(END);
+
+        for (size_t i = 0; i + 3 <= text.size(); ++i) {
+            vector<uint32_t>& list = postings_[trigramKey(field, text, i)];
+            if (list.empty() || list.back() != doc) list.push_back(doc);
+        }
+    }
+}
+
+void TrigramIndex::erase(CompactStore::Slot slot) {
+    if (slot >= numbers_.size() || numbers_[slot] == NONE) return;
+    slots_[numbers_[slot]] = NONE;
+    numbers_[slot] = NONE;
+    live_--;
+
+    // Номера удаленных документов вычищаются, когда их больше живых
+    size_t dead = slots_.size() - live_;
+    if (dead > 1024 && dead > live_) compact();
+}
+
+void TrigramIndex::compact() {
+    vector<uint32_t> renumber(slots_.size(), NONE);
+    vector<CompactStore::Slot> slots;
+    slots.reserve(live_);
+    for (uint32_t doc = 0; doc < slots_.size(); ++doc) {
+        if (slots_[doc] == NONE) continue;
+        renumber[doc] = static_cast<uint32_t>(slots.size());
+        numbers_[slots_[doc]] = renumber[doc];
+        slots.push_back(slots_[doc]);
+    }
+
+    for (auto it = postings_.begin(); it != postings_.end();) {
+        vector<uint32_t> kept;
+        for (uint32_t doc : it->second) {
+            if (renumber[doc] != NONE) kept.push_back(renumber[doc]);
+        }
+        if (kept.empty()) {
+            it = postings_.erase(it);
+        } else {
+            it->second = move(kept);
+            ++it;
+        }
+    }
+    slots_ = move(slots);
+}
+
+vector<CompactStore::Slot> TrigramIndex::candidates(const string& field, const string& pattern) const {
+    vector<CompactStore::Slot> result;
+    int number = fieldNumber(field);
+    if (number < 0) return result;
+
+    vector<const vector<uint32_t>*> lists;
+    for (const auto& run : patternRuns(pattern)) {
+        for (size_t i = 0; i + 3 <= run.size(); ++i) {
+            auto found = postings_.find(trigramKey(static_cast<size_t>(number), run, i));
+            if (found == postings_.end()) return result;
+            lists.push_back(&found->second);
+        }
+    }
+    if (lists.empty()) return result;
+
+    // Пересечение от самого короткого списка двоичным поиском в остальных
+    sort(lists.begin(), lists.end(), [](const auto* a, const auto* b) { return a->size() < b->size(); });
+    for (uint32_t doc : *lists[0]) {
+        if (slots_[doc] == NONE) continue;
+        bool all = true;
+        for (size_t i = 1; i < lists.size() && all; ++i) {
+            all = binary_search(lists[i]->begin(), lists[i]->end(), doc);
+        }
+        if (all) result.push_back(slots_[doc]);
+    }
+
+    sort(result.begin(), result.end());
+    return result;
+}
@@ -0,0 +1,445 @@
+#ifndef AGGREGATOR_H
+#define AGGREGATOR_H
+
+#include "json_parser.h"
+#include "query_evaluator.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <stdexcept>
+
+// Конвейер агрегации: $match, $group, $sort, $limit.
+// Документы подаются по одному через consume(), поэтому коллекция
+// обходится за один проход без копирования; $group считается
+// хэш-агрегацией, $sort + $limit держит только top-k документов.
+class Aggregator {
+public:
+    // Поля сортировки с направлением (1 - по возрастанию, -1 - по убыванию)
+    using SortKeys = std::vector<std::pair<std::string, int>>;
+
+private:
+    enum class StageType { Match, Group, Sort, Limit };
+    enum class AccumulatorType { Sum, Count, Min, Max, Avg };
+
+    struct Accumulator {
+        std::string name;
+        AccumulatorType type;
+        std::string field;    // "$field" без знака доллара
+        double constant = 0;  // для {"$sum": 1}
+        bool useConstant = false;
+    };
+
+    struct Stage {
+        StageType type;
+        JsonValue spec;
+        JsonValue groupKey;
+        std::vector<Accumulator> accumulators;
+        SortKeys sortKeys;
+        size_t limit = 0;
+    };
+
+    struct AccumulatorState {
+        double sum = 0;
+        int count = 0;
+        bool allInts = true;
+        bool hasValue = false;
+        JsonValue extreme;
+    };
+
+    struct GroupState {
+        JsonValue key;
+        std::vector<AccumulatorState> states;
+    };
+
+    std::vector<Stage> stages_;
+    size_t blockingStage_;             // индекс первой блокирующей стадии
+    std::vector<size_t> limitCounters_;
+    bool done_;
+
+    std::unordered_map<std::string, GroupState> groups_;
+    std::vector<std::string> groupOrder_;  // порядок появления групп
+    std::vector<JsonValue> buffer_;
+
+    static Stage parseStage(const JsonValue& stageValue) {
+        if (!stageValue.isObject() || stageValue.asObject().size() != 1) {
+            throw std::runtime_error("Each pipeline stage must be an object with one operator");
+        }
+
+        const auto& stageObj = stageValue.asObject();
+        const auto& [op, spec] = *stageObj.begin();
+        Stage stage;
+        stage.spec = spec;
+
+        if (op == "$match") {
+            if (!spec.isObject()) {
+                throw std::runtime_error("$match requires an object");
+            }
+            stage.type = StageType::Match;
+        } else if (op == "$group") {
+            if (!spec.isObject() || !spec.hasKey("_id")) {
+                throw std::runtime_error("$group requires an object with '_id'");
+            }
+            stage.type = StageType::Group;
+            stage.groupKey = spec["_id"];
+            for (const auto& [name, accSpec] : spec.asObject()) {
+                if (name == "_id") continue;
+                stage.accumulators.push_back(parseAccumulator(name, accSpec));
+            }
+        } else if (op == "$sort") {
+            stage.type = StageType::Sort;
+            stage.sortKeys = parseSortKeys(spec);
+        } else if (op == "$limit") {
+            if (!spec.isInt() || spec.asInt() <= 0) {
+                throw std::runtime_error("$limit requires a positive integer");
+            }
+            stage.type = StageType::Limit;
+            stage.limit = static_cast<size_t>(spec.asInt());
+        } else {
+            throw std::runtime_error("Unsupported pipeline stage: " + op);
+        }
+
+        return stage;
+    }
+
+    static Accumulator parseAccumulator(const std::string& name, const JsonValue& accSpec) {
+        if (!accSpec.isObject() || accSpec.asObject().size() != 1) {
+            throw std::runtime_error("Accumulator '" + name + "' must be an object with one operator");
+        }
+
+        const auto& accObj = accSpec.asObject();
+        const auto& [op, arg] = *accObj.begin();
+        Accumulator acc;
+        acc.name = name;
+
+        if (op == "$sum") acc.type = AccumulatorType::Sum;
+        else if (op == "$count") acc.type = AccumulatorType::Count;
+        else if (op == "$min") acc.type = AccumulatorType::Min;
+        else if (op == "$max") acc.type = AccumulatorType::Max;
+        else if (op == "$avg") acc.type = AccumulatorType::Avg;
+        else throw std::runtime_error("Unsupported accumulator: " + op);
+
+        if (acc.type == AccumulatorType::Count) {
+            return acc;
+        }
+
+        if (arg.isString() && !arg.asString().empty() && arg.asString()[0] == '$') {
+            acc.field = arg.asString().substr(1);
+        } else if (arg.isInt() && acc.type == AccumulatorType::Sum) {
+            acc.useConstant = true;
+            acc.constant = arg.asDouble();
+        } else {
+            throw std::runtime_error("Accumulator '" + name + "' requires a \"$field\" argument");
+        }
+        return acc;
+    }
+
+    static bool isBlocking(StageType type) {
+        return type == StageType::Group || type == StageType::Sort;
+    }
+
+    // Вычисляет выражение ключа группы: "$field", объект из выражений или константа
+    static JsonValue evaluateExpression(const JsonValue& doc, const JsonValue& expr) {
+        if (expr.isString() && !expr.asString().empty() && expr.asString()[0] == '$') {
+            const JsonValue* value = resolveField(doc, expr.asString().substr(1));
+            return value ? *value : JsonValue(nullptr);
+        }
+        if (expr.isObject()) {
+            JsonValue result;
+            for (const auto& [name, subExpr] : expr.asObject()) {
+                result[name] = evaluateExpression(doc, subExpr);
+            }
+            return result;
+        }
+        return expr;
+    }
+
+    void accumulate(GroupState& group, const Stage& stage, const JsonValue& doc) {
+        for (size_t i = 0; i < stage.accumulators.size(); ++i) {
+            const Accumulator& acc = stage.accumulators[i];
+            AccumulatorState& state = group.states[i];
+
+            if (acc.type == AccumulatorType::Count) {
+                state.count++;
+                continue;
+            }
+            if (acc.useConstant) {
+                state.sum += acc.constant;
+                state.count++;
+                if (acc.constant != static_cast<int>(acc.constant)) state.allInts = false;
+                continue;
+            }
+
+            const JsonValue* value = resolveField(doc, acc.field);
+            if (!value || value->isNull()) continue;
+
+            if (acc.type == AccumulatorType::Min || acc.type == AccumulatorType::Max) {
+                int cmp = state.hasValue ? compareValues(*value, state.extreme) : 0;
+                if (!state.hasValue ||
+                    (acc.type == AccumulatorType::Min && cmp < 0) ||
+                    (acc.type == AccumulatorType::Max && cmp > 0)) {
+                    state.extreme = *value;
+                    state.hasValue = true;
+                }
+            } else if (value->isInt()) {
+                state.sum += value->asDouble();
+                state.count++;
+                if (value->isDouble()) state.allInts = false;
+            }
+        }
+    }
+
+    std::vector<JsonValue> materializeGroups(const Stage& stage) {
+        std::vector<JsonValue> result;
+        result.reserve(groupOrder_.size());
+
+        for (const std::string& hashKey : groupOrder_) {
+            GroupState& group = groups_[hashKey];
+            JsonValue out;
+            out["_id"] = group.key;
+
+            for (size_t i = 0; i < stage.accumulators.size(); ++i) {
+                const Accumulator& acc = stage.accumulators[i];
+                const AccumulatorState& state = group.states[i];
+
+                switch (acc.type) {
+                    case AccumulatorType::Count:
+                        out[acc.name] = JsonValue(state.count);
+                        break;
+                    case AccumulatorType::Sum:
+                        if (state.allInts && state.sum >= -2147483648.0 && state.sum <= 2147483647.0) {
+                            out[acc.name] = JsonValue(static_cast<int>(state.sum));
+                        } else {
+                            out[acc.name] = JsonValue(state.sum);
+                        }
+                        break;
+                    case AccumulatorType::Avg:
+                        out[acc.name] = state.count > 0 ? JsonValue(state.sum / state.count) : JsonValue(nullptr);
+                        break;
+                    case AccumulatorType::Min:
+                    case AccumulatorType::Max:
+                        out[acc.name] = state.hasValue ? state.extreme : JsonValue(nullptr);
+                        break;
+                }
+            }
+            result.push_back(out);
+        }
+        return result;
+    }
+
+    // Сохраняет в буфере только первые limit документов по порядку сортировки
+    void trimSortBuffer(const SortKeys& sortKeys, size_t limit) {
+        if (buffer_.size() < 2 * limit) return;
+        std::nth_element(buffer_.begin(), buffer_.begin() + limit - 1, buffer_.end(),
+            [&](const JsonValue& a, const JsonValue& b) { return compareDocuments(a, b, sortKeys) < 0; });
+        buffer_.resize(limit);
+    }
+
+    explicit Aggregator(std::vector<Stage> stages) : stages_(std::move(stages)), done_(false) {
+        blockingStage_ = stages_.size();
+        for (size_t i = 0; i < stages_.size(); ++i) {
+            if (isBlocking(stages_[i].type)) {
+                blockingStage_ = i;
+                break;
+            }
+        }
+        limitCounters_.assign(stages_.size(), 0);
+    }
+
+    static std::vector<Stage> parsePipeline(const JsonValue& pipeline) {
+        if (!pipeline.isArray()) {
+            throw std::runtime_error("Pipeline must be an array of stages");
+        }
+        std::vector<Stage> stages;
+        for (const auto& stageValue : pipeline.asArray()) {
+            stages.push_back(parseStage(stageValue));
+        }
+        return stages;
+    }
+
+public:
+    explicit Aggregator(const JsonValue& pipeline) : Aggregator(parsePipeline(pipeline)) {}
+
+    // Возвращает указатель на значение поля (поддерживаются пути через точку)
+    static const JsonValue* resolveField(const JsonValue& doc, const std::string& path) {
+        const JsonValue* current = &doc;
+        size_t start = 0;
+        while (true) {
+            size_t dot = path.find('.', start);
+            std::string part = path.substr(start, dot == std::string::npos ? std::string::npos : dot - start);
+            if (!current->hasKey(part)) {
+                return nullptr;
+            }
+            current = &(*current)[part];
+            if (dot == std::string::npos) {
+                return current;
+            }
+            start = dot + 1;
+        }
+    }
+
+    // Порядок значений: null < числа < строки < bool < массивы/объекты
+    static int compareValues(const JsonValue& a, const JsonValue& b) {
+        auto rank = [](const JsonValue& v) {
+            if (v.isNull()) return 0;
+            if (v.isInt()) return 1;
+            if (v.isString()) return 2;
+            if (v.isBool()) return 3;
+            return 4;
+        };
+
+        int ra = rank(a), rb = rank(b);
+        if (ra != rb) return ra < rb ? -1 : 1;
+
+        switch (ra) {
+            case 1: {
+                double da = a.asDouble(), db = b.asDouble();
+                return da < db ? -1 : (da > db ? 1 : 0);
+            }
+            case 2: {
+                int cmp = a.asString().compare(b.asString());
+                return cmp < 0 ? -1 : (cmp > 0 ? 1 : 0);
+            }
+            case 3:
+                return a.asBool() == b.asBool() ? 0 : (a.asBool() ? 1 : -1);
+            case 4: {
+                std::string sa = a.toString(), sb = b.toString();
+                return sa < sb ? -1 : (sa > sb ? 1 : 0);
+            }
+            default:
+                return 0;
+        }
+    }
+
+    static int compareDocuments(const JsonValue& a, const JsonValue& b, const SortKeys& sortKeys) {
+        static const JsonValue nullValue;
+        for (const auto& [field, direction] : sortKeys) {
+            const JsonValue* va = resolveField(a, field);
+            const JsonValue* vb = resolveField(b, field);
+            int cmp = compareValues(va ? *va : nullValue, vb ? *vb : nullValue);
+            if (cmp != 0) return cmp * direction;
+        }
+        return 0;
+    }
+
+    // Спецификация $sort: один ключ {"field": 1 | -1} или несколько ключей
+    // по убыванию важности массивом [["field", 1 | -1], ...]. Поля объекта
+    // хранятся упорядоченными по имени, порядок клиента в нем теряется,
+    // поэтому объект с несколькими ключами отклоняется.
+    static SortKeys parseSortKeys(const JsonValue& spec) {
+        SortKeys keys;
+        auto add = [&keys](const std::string& field, const JsonValue& direction) {
+            if (!direction.isInt()) {
+                throw std::runtime_error("$sort direction must be 1 or -1");
+            }
+            keys.push_back({field, direction.asInt() < 0 ? -1 : 1});
+        };
+        
+        if (spec.isObject()) {
+            if (spec.asObject().size() > 1) {
+                throw std::runtime_error("$sort by several fields must be an array [[\"field\", 1 | -1], ...]");
+            }
+            for (const auto& [field, direction] : spec.asObject()) {
+                add(field, direction);
+            }
+        } else if (spec.isArray()) {
+            for (const auto& key : spec.asArray()) {
+                if (!key.isArray() || key.asArray().size() != 2 || !key.asArray()[0].isString()) {
+                    throw std::runtime_error("$sort array items must be [\"field\", 1 | -1]");
+                }
+                add(key.asArray()[0].asString(), key.asArray()[1]);
+            }
+        }
+        if (keys.empty()) {
+            throw std::runtime_error("$sort requires a field and direction");
+        }
+        return keys;
+    }
+
+    // Оставляет в docs первые limit документов по порядку sortKeys
+    static void sortTop(std::vector<JsonValue>& docs, const SortKeys& sortKeys, size_t limit) {
+        auto less = [&](const JsonValue& a, const JsonValue& b) { return compareDocuments(a, b, sortKeys) < 0; };
+        if (docs.size() > limit) {
+            std::nth_element(docs.begin(), docs.begin() + static_cast<std::ptrdiff_t>(limit), docs.end(), less);
+            docs.resize(limit);
+        }
+        std::sort(docs.begin(), docs.end(), less);
+    }
+
+    // Дальнейшие документы не изменят результат (сработал $limit)
+    bool done() const {
+        return done_;
+    }
+
+    void consume(const JsonValue& doc) {
+        if (done_) return;
+
+        for (size_t i = 0; i < blockingStage_; ++i) {
+            Stage& stage = stages_[i];
+            if (stage.type == StageType::Match) {
+                if (!QueryEvaluator::matches(doc, stage.spec)) return;
+            } else if (stage.type == StageType::Limit) {
+                if (++limitCounters_[i] >= stage.limit) {
+                    done_ = true;
+                }
+                if (limitCounters_[i] > stage.limit) return;
+            }
+        }
+
+        if (blockingStage_ == stages_.size()) {
+            buffer_.push_back(doc);
+            return;
+        }
+
+        Stage& stage = stages_[blockingStage_];
+        if (stage.type == StageType::Group) {
+            JsonValue key = evaluateExpression(doc, stage.groupKey);
+            std::string hashKey = key.toString();
+            auto it = groups_.find(hashKey);
+            if (it == groups_.end()) {
+                GroupState group;
+                group.key = key;
+                group.states.resize(stage.accumulators.size());
+                it = groups_.emplace(hashKey, std::move(group)).first;
+                groupOrder_.push_back(hashKey);
+            }
+            accumulate(it->second, stage, doc);
+        } else {
+            buffer_.push_back(doc);
+            size_t next = blockingStage_ + 1;
+            if (next < stages_.size() && stages_[next].type == StageType::Limit) {
+                trimSortBuffer(stage.sortKeys, stages_[next].limit);
+            }
+        }
+    }
+
+    std::vector<JsonValue> finish() {
+        if (blockingStage_ == stages_.size()) {
+            return std::move(buffer_);
+        }
+
+        const Stage& stage = stages_[blockingStage_];
+        std::vector<JsonValue> output;
+        if (stage.type == StageType::Group) {
+            output = materializeGroups(stage);
+        } else {
+            output = std::move(buffer_);
+            std::stable_sort(output.begin(), output.end(),
+                [&](const JsonValue& a, const JsonValue& b) { return compareDocuments(a, b, stage.sortKeys) < 0; });
+        }
+
+        // Оставшиеся стадии применяются к уже агрегированному результату
+        if (blockingStage_ + 1 == stages_.size()) {
+            return output;
+        }
+
+        Aggregator tail(std::vector<Stage>(stages_.begin() + blockingStage_ + 1, stages_.end()));
+        for (const auto& doc : output) {
+            if (tail.done()) break;
+            tail.consume(doc);
+        }
+        return tail.finish();
+    }
+};
+
+#endif // AGGREGATOR_H
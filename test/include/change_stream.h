@@ -0,0 +1,105 @@
+#ifndef CHANGE_STREAM_H
+#define CHANGE_STREAM_H
+
+#include "json_parser.h"
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <ctime>
+#include <random>
+#include <sstream>
+
+// Журнал изменений сервера. Каждая успешная запись (insert/delete)
+// получает последовательный номер, который служит токеном возобновления.
+// Подписчики ждут новых записей на условной переменной и читают только
+// их, поэтому доставка стоит O(новых событий), а не O(коллекции).
+class ChangeStream {
+public:
+    struct ChangeEvent {
+        uint64_t sequence;
+        std::string operation;   // "insert" | "delete"
+        std::string database;
+        std::string collection;
+        JsonValue document;
+        std::time_t time;
+    };
+
+private:
+    std::deque<ChangeEvent> events_;
+    std::string logId_;      // меняется при каждом запуске: токены разных запусков несравнимы
+    uint64_t lastSequence_;
+    size_t capacity_;
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;
+
+public:
+    explicit ChangeStream(size_t capacity = 100000) : lastSequence_(0), capacity_(capacity) {
+        std::random_device rd;
+        std::ostringstream oss;
+        oss << std::hex << rd() << rd();
+        logId_ = oss.str();
+    }
+
+    const std::string& logId() const {
+        return logId_;
+    }
+
+    uint64_t record(const std::string& operation, const std::string& database,
+                    const std::string& collection, const JsonValue& document) {
+        uint64_t sequence;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            sequence = ++lastSequence_;
+            events_.push_back({sequence, operation, database, collection, document, std::time(nullptr)});
+            if (events_.size() > capacity_) {
+                events_.pop_front();
+            }
+        }
+        changed_.notify_all();
+        return sequence;
+    }
+
+    uint64_t lastSequence() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return lastSequence_;
+    }
+
+    // Можно ли продолжить чтение после токена: все более новые события еще в журнале
+    bool canResumeAfter(uint64_t sequence) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (sequence > lastSequence_) return false;
+        uint64_t oldestKept = events_.empty() ? lastSequence_ + 1 : events_.front().sequence;
+        return sequence + 1 >= oldestKept;
+    }
+
+    // Ждет событий новее after не дольше timeout и возвращает не более maxEvents из них
+    std::vector<ChangeEvent> waitAfter(uint64_t after, std::chrono::milliseconds timeout,
+                                       size_t maxEvents = 1000) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait_for(lock, timeout, [&] { return lastSequence_ > after; });
+
+        std::vector<ChangeEvent> result;
+        if (lastSequence_ <= after || events_.empty()) {
+            return result;
+        }
+
+        // Номера в журнале идут подряд, поэтому позиция вычисляется без поиска
+        uint64_t first = events_.front().sequence;
+        size_t index = after + 1 > first ? static_cast<size_t>(after + 1 - first) : 0;
+        for (; index < events_.size() && result.size() < maxEvents; ++index) {
+            result.push_back(events_[index]);
+        }
+        return result;
+    }
+
+    // Будит всех ожидающих подписчиков (при остановке сервера)
+    void notifyAll() {
+        changed_.notify_all();
+    }
+};
+
+#endif // CHANGE_STREAM_H
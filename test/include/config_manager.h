@@ -68,7 +68,7 @@ private:
         
         // Sources
         if (config.hasKey("sources") && config["sources"].isArray()) {
-            auto sources = config["sources"].asArray();
+            const auto& sources = config["sources"].asArray();
             config_.sources.clear();
             for (const auto& source : sources) {
                 if (source.isString()) {
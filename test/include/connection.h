@@ -0,0 +1,179 @@
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#include "json_parser.h"
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <unistd.h>
+
+// Исходящее соединение сервер-сервер с тем же форматом кадров, что и у
+// клиента: 4 байта длины (network byte order) + JSON.
+class Connection {
+private:
+    std::string host_;
+    int port_;
+    int socket_;
+
+    void sendFrame(std::string& frame) {
+        if (socket_ < 0) {
+            throw std::runtime_error("Not connected to " + address());
+        }
+        if (!sendFrame(socket_, frame)) {
+            close();
+            throw std::runtime_error("Failed to send message to " + address());
+        }
+    }
+
+public:
+    Connection(const std::string& host, int port) : host_(host), port_(port), socket_(-1) {}
+    
+    // Разбор адреса вида "host:port"
+    static bool splitAddress(const std::string& address, std::string& host, int& port) {
+        size_t colon = address.rfind(':');
+        if (colon == std::string::npos || colon == 0 || colon + 1 == address.size()) {
+            return false;
+        }
+        try {
+            size_t parsed = 0;
+            port = std::stoi(address.substr(colon + 1), &parsed);
+            if (parsed != address.size() - colon - 1 || port <= 0 || port > 65535) {
+                return false;
+            }
+        } catch (...) {
+            return false;
+        }
+        host = address.substr(0, colon);
+        return true;
+    }
+
+    ~Connection() {
+        close();
+    }
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    const std::string& host() const { return host_; }
+    int port() const { return port_; }
+    std::string address() const { return host_ + ":" + std::to_string(port_); }
+    bool isOpen() const { return socket_ >= 0; }
+
+    bool open() {
+        close();
+
+        struct addrinfo hints, *result, *rp;
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+
+        std::string portStr = std::to_string(port_);
+        if (getaddrinfo(host_.c_str(), portStr.c_str(), &hints, &result) != 0) {
+            return false;
+        }
+
+        for (rp = result; rp != nullptr; rp = rp->ai_next) {
+            socket_ = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+            if (socket_ < 0) {
+                continue;
+            }
+            if (::connect(socket_, rp->ai_addr, rp->ai_addrlen) == 0) {
+                setNoDelay(socket_);
+                break;
+            }
+            ::close(socket_);
+            socket_ = -1;
+        }
+
+        freeaddrinfo(result);
+        return socket_ >= 0;
+    }
+
+    void close() {
+        if (socket_ >= 0) {
+            ::close(socket_);
+            socket_ = -1;
+        }
+    }
+
+    // Ограничение ожидания ответа; 0 - ждать без ограничения
+    void setReceiveTimeout(int seconds) {
+        if (socket_ < 0) return;
+        timeval tv{};
+        tv.tv_sec = seconds;
+        setsockopt(socket_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    }
+
+    // Запросы - короткие сообщения в ожидании ответа: без TCP_NODELAY
+    // алгоритм Нейгла придерживает их до ACK от собеседника
+    static void setNoDelay(int socket) {
+        int flag = 1;
+        setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    }
+
+    // Отправка кадра: первые 4 байта frame отведены под длину, которая
+    // дописывается здесь. Длина и сообщение уходят одним буфером - при
+    // двух вызовах send второй сегмент ждет ACK на первый (~40 мс)
+    static bool sendFrame(int socket, std::string& frame) {
+        uint32_t length = htonl(static_cast<uint32_t>(frame.size() - sizeof(uint32_t)));
+        std::memcpy(&frame[0], &length, sizeof(length));
+
+        size_t sent = 0;
+        while (sent < frame.size()) {
+            ssize_t bytesSent = ::send(socket, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+            if (bytesSent <= 0) {
+                return false;
+            }
+            sent += static_cast<size_t>(bytesSent);
+        }
+        return true;
+    }
+
+    void send(const JsonValue& message) {
+        std::string frame(sizeof(uint32_t), '\0');
+        message.appendTo(frame);
+        sendFrame(frame);
+    }
+
+    std::string receive() {
+        if (socket_ < 0) {
+            throw std::runtime_error("Not connected to " + address());
+        }
+
+        uint32_t length;
+        if (recv(socket_, &length, sizeof(length), MSG_WAITALL) != sizeof(length)) {
+            close();
+            throw std::runtime_error("Connection to " + address() + " lost");
+        }
+
+        length = ntohl(length);
+        if (length == 0 || length > 10 * 1024 * 1024) { // Максимум 10MB
+            close();
+            throw std::runtime_error("Invalid message length from " + address());
+        }
+
+        std::vector<char> buffer(length);
+        if (recv(socket_, buffer.data(), length, MSG_WAITALL) != static_cast<ssize_t>(length)) {
+            close();
+            throw std::runtime_error("Connection to " + address() + " lost");
+        }
+
+        return std::string(buffer.data(), length);
+    }
+
+    // Запрос-ответ
+    JsonValue request(const JsonValue& message) {
+        send(message);
+        JsonParser parser;
+        return parser.parse(receive());
+    }
+};
+
+#endif // CONNECTION_H
@@ -0,0 +1,210 @@
+#ifndef CURSOR_MANAGER_H
+#define CURSOR_MANAGER_H
+
+#include "json_parser.h"
+#include "aggregator.h"
+#include <map>
+#include <mutex>
+#include <vector>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+
+// Серверные курсоры для постраничной выдачи результатов find.
+// Курсор хранит не результат, а позицию: запрос, порядок сортировки и
+// последний отданный документ. getMore заново выбирает следующую порцию -
+// документы строго после позиции (порядок полный: последний ключ - _id),
+// поэтому память курсора не зависит от размера результата, а вставки и
+// удаления не сдвигают уже пройденную часть. Неиспользуемые курсоры
+// удаляются по таймауту.
+class CursorManager {
+public:
+    struct Batch {
+        std::vector<JsonValue> documents;
+        int cursorId;        // 0 - курсор исчерпан и закрыт
+        size_t total;        // всего документов в результате
+    };
+
+    // Итог getMore
+    enum class Fetch { Fetched, NotFound, Busy };
+
+    struct Position {
+        std::string database;
+        std::string collection;
+        JsonValue query;
+        JsonValue sort;         // sort запроса или null
+        Aggregator::SortKeys order;
+        JsonValue after;        // последний отданный документ
+        size_t remaining = 0;   // сколько документов еще отдать (с учетом limit)
+        size_t total = 0;
+        size_t batchSize = 0;
+    };
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Cursor {
+        Position position;
+        bool busy = false;      // порция выбирается вне блокировки
+        Clock::time_point lastAccess;
+    };
+
+    std::map<int, Cursor> cursors_;
+    std::mutex mutex_;
+    int nextId_;
+    std::chrono::seconds idleTimeout_;
+    size_t maxCursors_;
+
+    void expireIdle(Clock::time_point now) {
+        for (auto it = cursors_.begin(); it != cursors_.end();) {
+            if (!it->second.busy && now - it->second.lastAccess > idleTimeout_) {
+                it = cursors_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    int allocateId() {
+        do {
+            nextId_ = nextId_ == std::numeric_limits<int>::max() ? 1 : nextId_ + 1;
+        } while (cursors_.count(nextId_) > 0);
+        return nextId_;
+    }
+
+    // Сдвиг позиции за отданную порцию; count - сколько документов просили
+    static void advance(Position& position, const std::vector<JsonValue>& documents, size_t count) {
+        position.remaining = documents.size() < count ? 0 : position.remaining - documents.size();
+        if (!documents.empty()) {
+            position.after = documents.back();
+        }
+    }
+
+public:
+    explicit CursorManager(std::chrono::seconds idleTimeout = std::chrono::seconds(600),
+                           size_t maxCursors = 1000)
+        : nextId_(0), idleTimeout_(idleTimeout), maxCursors_(maxCursors) {}
+
+    // Порядок страниц курсора: ключи sort (nullptr - без сортировки) и
+    // _id последним, чтобы позиция "после документа" была однозначной
+    static Aggregator::SortKeys pageOrder(const JsonValue* sort) {
+        Aggregator::SortKeys order;
+        if (sort) {
+            order = Aggregator::parseSortKeys(*sort);
+        }
+        bool hasId = false;
+        for (const auto& key : order) {
+            if (key.first == "_id") hasId = true;
+        }
+        if (!hasId) {
+            order.push_back({"_id", 1});
+        }
+        return order;
+    }
+
+    // Возвращает первую порцию first, выбранную вызывающим с начала
+    // результата; position.remaining - сколько документов осталось после
+    // нее. Курсор сохраняется, только если они есть.
+    Batch open(Position position, std::vector<JsonValue> first) {
+        if (position.batchSize == 0) position.batchSize = 1;
+
+        Batch batch;
+        batch.total = position.total;
+        batch.cursorId = 0;
+        if (first.empty() || position.remaining == 0) {
+            batch.documents = std::move(first);
+            return batch;
+        }
+        position.after = first.back();
+        batch.documents = std::move(first);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto now = Clock::now();
+        expireIdle(now);
+        if (cursors_.size() >= maxCursors_) {
+            // Вытесняем курсор, к которому дольше всего не обращались
+            auto oldest = cursors_.end();
+            for (auto it = cursors_.begin(); it != cursors_.end(); ++it) {
+                if (it->second.busy) continue;
+                if (oldest == cursors_.end() || it->second.lastAccess < oldest->second.lastAccess) oldest = it;
+            }
+            if (oldest != cursors_.end()) cursors_.erase(oldest);
+        }
+
+        Cursor cursor;
+        cursor.position = std::move(position);
+        cursor.lastAccess = now;
+        batch.cursorId = allocateId();
+        cursors_.emplace(batch.cursorId, std::move(cursor));
+        return batch;
+    }
+
+    // Следующая порция: fetch(position, count) выбирает до count документов
+    // после position.after. Выборка идет без блокировки курсоров; курсор на
+    // это время помечен занятым. NotFound - курсора нет или он истек,
+    // Busy - курсор занят параллельным getMore (повтор позже вернет порцию).
+    template<typename FetchFunc>
+    Fetch getMore(int cursorId, size_t batchSize, Batch& batch, FetchFunc fetch) {
+        Position position;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            expireIdle(Clock::now());
+            auto it = cursors_.find(cursorId);
+            if (it == cursors_.end()) {
+                return Fetch::NotFound;
+            }
+            if (it->second.busy) {
+                return Fetch::Busy;
+            }
+            it->second.busy = true;
+            position = it->second.position;
+        }
+
+        size_t count = std::min(batchSize > 0 ? batchSize : position.batchSize, position.remaining);
+        std::vector<JsonValue> documents;
+        try {
+            documents = fetch(static_cast<const Position&>(position), count);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = cursors_.find(cursorId);
+            if (it != cursors_.end()) {
+                it->second.busy = false;
+                it->second.lastAccess = Clock::now();
+            }
+            throw;
+        }
+        advance(position, documents, count);
+
+        batch.documents = std::move(documents);
+        batch.total = position.total;
+        batch.cursorId = 0;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = cursors_.find(cursorId);
+        if (it == cursors_.end()) {
+            return Fetch::Fetched;  // закрыт killCursors во время выборки
+        }
+        if (position.remaining == 0) {
+            cursors_.erase(it);
+        } else {
+            it->second.position = std::move(position);
+            it->second.busy = false;
+            it->second.lastAccess = Clock::now();
+            batch.cursorId = cursorId;
+        }
+        return Fetch::Fetched;
+    }
+
+    bool kill(int cursorId) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return cursors_.erase(cursorId) > 0;
+    }
+
+    size_t openCursors() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        expireIdle(Clock::now());
+        return cursors_.size();
+    }
+};
+
+#endif // CURSOR_MANAGER_H
@@ -2,20 +2,152 @@
 #define DATABASE_H
 
 #include "hashmap.h"
+#include "flat_hashmap.h"
 #include "json_parser.h"
 #include "query_evaluator.h"
+#include "aggregator.h"
+#include "time_utils.h"
+#include "time_partition.h"
+#include "text_index.h"
+#include "trigram_index.h"
+#include "field_index.h"
 #include <filesystem>
 #include <fstream>
 #include <sstream>
 #include <random>
 #include <iomanip>
 #include <ctime>
+#include <map>
+#include <set>
+#include <limits>
+#include <memory>
+#include <unordered_set>
+#include <mutex>
+#include <chrono>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Таблица документов сегмента. По умолчанию - FlatHashMap; сборка с
+// -DDB_CHAINED_HASHMAP возвращает HashMap с цепочками.
+#ifdef DB_CHAINED_HASHMAP
+using DocumentMap = HashMap<std::string, JsonValue>;
+#else
+using DocumentMap = FlatHashMap<std::string, JsonValue>;
+#endif
 
 class Database {
 private:
+    // Файл с документами коллекции. У обычной коллекции он один
+    // (<collection>.json), у коллекции с разбиением по времени - по файлу
+    // на час или сутки в каталоге <collection>/. Сегмент читается с диска
+    // при первом обращении, поэтому запрос за последние сутки не загружает
+    // всю историю.
+    // Индексы сегмента (полнотекстовый и триграмм) строятся при первом
+    // запросе, который может их использовать, и дальше поддерживаются
+    // вставками и удалениями. Индексы полей (FieldIndex) открываются вместе
+    // с сегментом из своих файлов и записываются вместе со снимком.
+    // Вставки и удаления копятся в journal записями журнала (по строке
+    // JSON: {"put": документ} или {"del": "_id"}), flush() дописывает их
+    // в <сегмент>.log. Снимок <сегмент>.json переписывается целиком, только
+    // когда журнал перерастает его, или если сегмент помечен dirty
+    // (изменение, которое журнал не описывает).
+    struct Segment {
+        std::string path;
+        DocumentMap documents;
+        bool loaded = false;
+        bool dirty = false;
+        std::string journal;      // записи, еще не дописанные в журнал
+        size_t logBytes = 0;      // размер журнала на диске
+        size_t snapshotBytes = 0; // размер снимка на диске
+        std::unique_ptr<TextIndex> text;
+        std::unique_ptr<TrigramIndex> trigrams;
+        std::vector<std::unique_ptr<FieldIndex>> fields;  // по fieldIndexes_ коллекции
+        bool fieldsWritten = false;  // файлы индексов полей записаны по снимку snapshot
+        FieldIndex::Stamp snapshot;
+        std::chrono::steady_clock::time_point lastUse;  // последнее обращение через segment()
+        
+        std::string logPath() const {
+            return path + ".log";
+        }
+        
+        void put(const std::string& id, const JsonValue& doc) {
+            reopenFields();
+            documents.put(id, doc);
+            if (text) text->add(id, doc);
+            if (trigrams) trigrams->add(id, doc);
+            for (auto& index : fields) index->add(id, doc);
+            journal += "{\"put\": ";
+            doc.appendTo(journal);
+            journal += "}\n";
+        }
+        
+        void erase(const std::string& id) {
+            reopenFields();
+            if (!documents.remove(id)) return;
+            if (text) text->remove(id);
+            if (trigrams) trigrams->remove(id);
+            for (auto& index : fields) index->remove(id);
+            journal += "{\"del\": ";
+            JsonFormat::appendString(journal, id);
+            journal += "}\n";
+        }
+        
+        // До первого изменения после записи снимка файлы индексов полей
+        // совпадают с документами: индексы переоткрываются по ним, и
+        // изменения в памяти сбрасываются. Сам flush() индексы в памяти не
+        // трогает - он идет параллельно с запросами на чтение.
+        void reopenFields() {
+            if (!fieldsWritten) return;
+            fieldsWritten = false;
+            for (auto& index : fields) {
+                auto reopened = std::make_unique<FieldIndex>(index->path(), index->field(), index->type());
+                if (reopened->open(snapshot, documents.size())) {
+                    index = std::move(reopened);
+                }
+            }
+        }
+        
+        void resetIndexes() {
+            text.reset();
+            trigrams.reset();
+        }
+    };
+    
+    // Индекс значений поля: тип "hash" или "ordered"
+    struct FieldIndexSpec {
+        std::string field;
+        FieldIndex::Type type;
+    };
+    
+    // Условия запроса, которые можно ответить по индексам сегмента
+    struct IndexPlan {
+        bool useText = false;
+        TextSearch::Query text;
+        std::vector<std::pair<std::string, std::string>> likes;  // поле, шаблон $like
+        std::vector<std::pair<size_t, FieldIndex::Lookup>> fields;  // номер индекса поля, ключи
+        JsonValue rest;  // условия, которые проверяются на кандидатах
+        
+        bool empty() const { return !useText && likes.empty() && fields.empty(); }
+    };
+    
+    // Журнал сжимается в снимок, когда он больше снимка и этого размера
+    static constexpr size_t COMPACT_MIN_LOG_BYTES = 1 << 20;
+    
     std::string dbPath_;
     std::string collectionName_;
-    HashMap<std::string, JsonValue> documents_;
+    bool appendLog_;  // false - каждый flush() переписывает снимок
+    TimePartition::Spec partition_;
+    std::map<int64_t, Segment> segments_;  // начало интервала -> сегмент
+    std::vector<std::string> textFields_;     // поля полнотекстового индекса
+    std::vector<std::string> trigramFields_;  // поля индекса триграмм для $like
+    std::vector<FieldIndexSpec> fieldIndexes_;
+    
+    // Запросы на чтение выполняются параллельно под общей блокировкой
+    // коллекции (DatabaseManager), но могут загрузить сегмент или построить индекс:
+    // такие ленивые изменения выполняются под lazyMutex_.
+    std::mutex lazyMutex_;
+    std::mutex flushMutex_;
     
     std::string generateId() {
         static std::random_device rd;
@@ -30,135 +162,1097 @@ private:
         return oss.str();
     }
     
+    bool partitioned() const {
+        return partition_.width > 0;
+    }
+    
+    std::filesystem::path partitionDir() const {
+        return std::filesystem::path(dbPath_) / collectionName_;
+    }
+    
     std::string getCollectionPath() const {
         std::filesystem::path path(dbPath_);
         path /= collectionName_ + ".json";
         return path.string();
     }
     
-    void saveCollection() {
-        std::string filePath = getCollectionPath();
-        std::ofstream file(filePath);
+    std::string segmentPath(int64_t key) const {
+        if (!partitioned()) {
+            return getCollectionPath();
+        }
+        return (partitionDir() / (TimePartition::segmentName(key, partition_.width) + ".json")).string();
+    }
+    
+    // Список сегментов по именам файлов, без чтения содержимого
+    void discoverSegments() {
+        segments_.clear();
+        partition_ = TimePartition::Spec();
+        
+        if (!TimePartition::readSpec(partitionDir(), partition_)) {
+            partition_ = TimePartition::Spec();
+            segments_[TimePartition::UNTIMED].path = getCollectionPath();
+            return;
+        }
+        
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(partitionDir(), ec)) {
+            int64_t start;
+            if (entry.path().extension() == ".json" &&
+                TimePartition::parseSegmentName(entry.path().stem().string(), partition_.width, start)) {
+                segments_[start].path = entry.path().string();
+            }
+        }
+    }
+    
+    int64_t segmentKey(const JsonValue& doc) const {
+        int64_t ts;
+        if (!partitioned() || !doc.hasKey(partition_.field) ||
+            !TimePartition::timeValue(doc[partition_.field], ts)) {
+            return TimePartition::UNTIMED;
+        }
+        return TimeUtils::bucketStart(ts, partition_.width);
+    }
+    
+    // Сегмент по ключу, загруженный с диска (новый сегмент создается пустым)
+    Segment& segment(int64_t key) {
+        std::lock_guard<std::mutex> lock(lazyMutex_);
+        Segment& seg = segments_[key];
+        if (seg.path.empty()) {
+            seg.path = segmentPath(key);
+        }
+        if (!seg.loaded) {
+            loadSegment(seg);
+        }
+        seg.lastUse = std::chrono::steady_clock::now();
+        return seg;
+    }
+    
+    // Обход сегментов, пересекающихся с интервалом времени; сегмент
+    // документов без времени просматривается всегда. Останавливается,
+    // если func вернула false.
+    template<typename Func>
+    void forEachSegment(const TimePartition::Range& range, Func func) {
+        for (auto& [key, seg] : segments_) {
+            if (key != TimePartition::UNTIMED && !range.overlaps(key, partition_.width)) continue;
+            if (!func(segment(key))) return;
+        }
+    }
+    
+    // Настройка индекса - список полей: {"fields": ["raw_log", "command"]}
+    std::string indexConfigPath(const std::string& type) const {
+        return (std::filesystem::path(dbPath_) / (collectionName_ + "_" + type + "_index.json")).string();
+    }
+    
+    std::vector<std::string> loadIndexFields(const std::string& type) const {
+        std::vector<std::string> fields;
+        std::ifstream file(indexConfigPath(type));
+        if (!file.is_open()) return fields;
+        
+        std::ostringstream buffer;
+        buffer << file.rdbuf();
+        try {
+            JsonParser parser;
+            JsonValue config = parser.parse(buffer.str());
+            if (!config.hasKey("fields") || !config["fields"].isArray()) return fields;
+            for (const auto& field : config["fields"].asArray()) {
+                if (field.isString()) fields.push_back(field.asString());
+            }
+        } catch (...) {
+            fields.clear();
+        }
+        return fields;
+    }
+    
+    void saveIndexFields(const std::string& type, const std::vector<std::string>& fields) const {
+        JsonValue config;
+        config["fields"] = JsonValue(std::vector<JsonValue>(fields.begin(), fields.end()));
+        std::ofstream file(indexConfigPath(type));
+        if (!file.is_open()) {
+            throw std::runtime_error("Cannot write index config: " + indexConfigPath(type));
+        }
+        file << config.toString() << "\n";
+    }
+    
+    TextIndex& textIndex(Segment& seg) {
+        std::lock_guard<std::mutex> lock(lazyMutex_);
+        if (!seg.text) {
+            seg.text = std::make_unique<TextIndex>(textFields_);
+            seg.documents.forEach([&](const std::string& id, const JsonValue& doc) {
+                seg.text->add(id, doc);
+                return true;
+            });
+        }
+        return *seg.text;
+    }
+    
+    TrigramIndex& trigramIndex(Segment& seg) {
+        std::lock_guard<std::mutex> lock(lazyMutex_);
+        if (!seg.trigrams) {
+            seg.trigrams = std::make_unique<TrigramIndex>(trigramFields_);
+            seg.documents.forEach([&](const std::string& id, const JsonValue& doc) {
+                seg.trigrams->add(id, doc);
+                return true;
+            });
+        }
+        return *seg.trigrams;
+    }
+    
+    // Индексы применяются к $text, к $like с триграммами и к условиям на
+    // индексированные поля ($eq, $in, интервалы) верхнего уровня запроса. При $or или $and QueryEvaluator
+    // не проверяет остальные поля, такой запрос не сужается.
+    IndexPlan indexPlan(const JsonValue& query) const {
+        IndexPlan plan;
+        if (!query.isObject() || (query.hasKey("$or") && query["$or"].isArray()) ||
+            (query.hasKey("$and") && query["$and"].isArray())) {
+            return plan;
+        }
+        
+        auto conditions = query.asObject();
+        std::string search;
+        if (!textFields_.empty() && query.hasKey("$text") && TextSearch::searchString(query["$text"], search)) {
+            plan.useText = true;
+            plan.text = TextSearch::parseQuery(search);
+            conditions.erase("$text");
+        }
+        for (const auto& [field, condition] : conditions) {
+            for (size_t i = 0; i < fieldIndexes_.size(); ++i) {
+                FieldIndex::Lookup lookup;
+                if (fieldIndexes_[i].field == field && FieldIndex::lookup(fieldIndexes_[i].type, condition, lookup)) {
+                    plan.fields.emplace_back(i, std::move(lookup));
+                    break;
+                }
+            }
+            if (std::find(trigramFields_.begin(), trigramFields_.end(), field) == trigramFields_.end() ||
+                !condition.isObject() || !condition.hasKey("$like") || !condition["$like"].isString()) {
+                continue;
+            }
+            const std::string& pattern = condition["$like"].asString();
+            if (TrigramIndex::selective(pattern)) {
+                plan.likes.emplace_back(field, pattern);
+            }
+        }
+        plan.rest = JsonValue(conditions);
+        return plan;
+    }
+    
+    // Пересечение кандидатов всех индексов плана. Условия $like остаются
+    // в rest: триграммы дают только кандидатов.
+    std::vector<std::string> candidates(Segment& seg, const IndexPlan& plan) {
+        std::vector<std::string> ids;
+        bool first = true;
+        auto narrow = [&](std::vector<std::string> found) {
+            if (first) {
+                ids = std::move(found);
+                first = false;
+                return;
+            }
+            std::unordered_set<std::string> keep(found.begin(), found.end());
+            ids.erase(std::remove_if(ids.begin(), ids.end(),
+                                     [&](const std::string& id) { return keep.count(id) == 0; }),
+                      ids.end());
+        };
+        
+        for (const auto& [number, lookup] : plan.fields) {
+            if (!first && ids.empty()) break;
+            std::vector<std::string> found;
+            seg.fields[number]->find(lookup, found);
+            narrow(std::move(found));
+        }
+        if (plan.useText && (first || !ids.empty())) {
+            narrow(textIndex(seg).search(plan.text));
+        }
+        for (const auto& [field, pattern] : plan.likes) {
+            if (!first && ids.empty()) break;
+            std::vector<std::string> found;
+            trigramIndex(seg).candidates(field, pattern, found);
+            narrow(std::move(found));
+        }
+        return ids;
+    }
+    
+    // Обход документов, подходящих под запрос. Если индексы сужают запрос,
+    // остальные условия проверяются только на их кандидатах.
+    template<typename Func>
+    void forEachMatch(const JsonValue& query, Func func) {
+        IndexPlan plan = indexPlan(query);
+        
+        forEachSegment(queryRange(query), [&](Segment& seg) {
+            if (plan.empty()) {
+                bool more = true;
+                seg.documents.forEach([&](const std::string& id, const JsonValue& doc) {
+                    if (QueryEvaluator::matches(doc, query)) {
+                        more = func(seg, id, doc);
+                    }
+                    return more;
+                });
+                return more;
+            }
+            
+            for (const std::string& id : candidates(seg, plan)) {
+                const JsonValue* doc = seg.documents.find(id);
+                if (doc != nullptr && QueryEvaluator::matches(*doc, plan.rest) && !func(seg, id, *doc)) {
+                    return false;
+                }
+            }
+            return true;
+        });
+    }
+    
+    // Интервал времени, которым запрос ограничивает поле разбиения
+    TimePartition::Range queryRange(const JsonValue& query) const {
+        if (!partitioned()) return TimePartition::Range();
+        return TimePartition::queryRange(query, partition_.field);
+    }
+    
+    // Сброс данных файла (или каталога) на диск
+    static void syncPath(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open " + path + " for sync");
+        }
+        int result = ::fsync(fd);
+        ::close(fd);
+        if (result != 0) {
+            throw std::runtime_error("Cannot sync " + path);
+        }
+    }
+    
+    // Снимок сегмента вместе с его журналом и файлами индексов
+    void removeSegmentFiles(const std::string& path) const {
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+        std::filesystem::remove(path + ".log", ec);
+        for (const auto& spec : fieldIndexes_) {
+            std::filesystem::remove(FieldIndex::fileName(path, spec.field, spec.type), ec);
+        }
+    }
+    
+    // Файлы индексов полей по только что записанному снимку. Индексы в
+    // памяти переоткрываются по ним при следующем изменении сегмента.
+    // Индекс восстанавливается по документам, поэтому ошибка записи не
+    // прерывает flush(): при открытии сегмента файл будет построен заново.
+    void writeFieldIndexes(Segment& seg) {
+        FieldIndex::Stamp snapshot;
+        if (fieldIndexes_.empty() || !FieldIndex::Stamp::of(seg.path, snapshot)) return;
+        try {
+            for (const auto& spec : fieldIndexes_) {
+                FieldIndex::write(FieldIndex::fileName(seg.path, spec.field, spec.type), spec.field, spec.type,
+                                  snapshot, seg.documents);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Cannot write field index for " << seg.path << ": " << e.what() << "\n";
+            return;
+        }
+        seg.snapshot = snapshot;
+        seg.fieldsWritten = true;
+    }
+    
+    // Пустые индексы полей сегмента, без файлов
+    void resetFieldIndexes(Segment& seg) {
+        seg.fields.clear();
+        seg.fieldsWritten = false;
+        for (const auto& spec : fieldIndexes_) {
+            seg.fields.push_back(std::make_unique<FieldIndex>(
+                FieldIndex::fileName(seg.path, spec.field, spec.type), spec.field, spec.type));
+        }
+    }
+    
+    // Индексы полей только что прочитанного снимка: файл индекса
+    // отображается в память, а если его нет или он записан по другому
+    // снимку, индекс строится по документам и записывается заново
+    void openFieldIndexes(Segment& seg) {
+        resetFieldIndexes(seg);
+        FieldIndex::Stamp snapshot;
+        if (!FieldIndex::Stamp::of(seg.path, snapshot)) return;
+        
+        for (auto& index : seg.fields) {
+            if (index->open(snapshot, seg.documents.size())) continue;
+            try {
+                FieldIndex::write(index->path(), index->field(), index->type(), snapshot, seg.documents);
+                if (index->open(snapshot, seg.documents.size())) continue;
+            } catch (const std::exception& e) {
+                std::cerr << "Cannot write field index " << index->path() << ": " << e.what() << "\n";
+            }
+            // Без файла индекс держится в памяти
+            seg.documents.forEach([&](const std::string& id, const JsonValue& doc) {
+                index->add(id, doc);
+                return true;
+            });
+        }
+    }
+    
+    // Запись снимка сегмента во временный файл с заменой основного:
+    // прерванная запись не портит прежнюю версию. Журнал после этого не
+    // нужен; если процесс упадет до его удаления, повторное применение
+    // журнала к новому снимку ничего не изменит.
+    void saveSegment(Segment& seg) {
+        seg.dirty = false;
+        
+        // Опустевший сегмент разбиения удаляется целиком
+        if (partitioned() && seg.documents.empty()) {
+            removeSegmentFiles(seg.path);
+            seg.journal.clear();
+            seg.logBytes = 0;
+            seg.snapshotBytes = 0;
+            return;
+        }
+        if (partitioned()) {
+            std::filesystem::create_directories(partitionDir());
+        }
+        
+        std::string tempPath = seg.path + ".tmp";
+        size_t written = 0;
+        {
+            std::ofstream file(tempPath);
+            if (!file.is_open()) {
+                seg.dirty = true;
+                throw std::runtime_error("Cannot open file for writing: " + tempPath);
+            }
+            
+            // Документы пишутся в один буфер, который сбрасывается в файл
+            // блоками, а не строкой на каждый документ
+            static constexpr size_t WRITE_BLOCK = 256 * 1024;
+            std::string buffer = "{\n";
+            buffer.reserve(WRITE_BLOCK * 2);
+            size_t remaining = seg.documents.size();
+            seg.documents.forEach([&](const std::string& id, const JsonValue& doc) {
+                buffer += "  ";
+                JsonFormat::appendString(buffer, id);
+                buffer += ": ";
+                doc.appendTo(buffer);
+                buffer += --remaining > 0 ? ",\n" : "\n";
+                if (buffer.size() >= WRITE_BLOCK) {
+                    file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                    buffer.clear();
+                }
+                return true;
+            });
+            buffer += "}\n";
+            file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            written = static_cast<size_t>(file.tellp());
+            if (!file.good()) {
+                seg.dirty = true;
+                throw std::runtime_error("Cannot write file: " + tempPath);
+            }
+        }
+        
+        std::error_code ec;
+        try {
+            syncPath(tempPath);
+            std::filesystem::rename(tempPath, seg.path, ec);
+            if (!ec) {
+                std::string dir = std::filesystem::path(seg.path).parent_path().string();
+                syncPath(dir.empty() ? "." : dir);
+            }
+        } catch (...) {
+            seg.dirty = true;
+            throw;
+        }
+        if (ec) {
+            seg.dirty = true;
+            throw std::runtime_error("Cannot replace file " + seg.path + ": " + ec.message());
+        }
+        
+        std::filesystem::remove(seg.logPath(), ec);
+        seg.journal.clear();
+        seg.logBytes = 0;
+        seg.snapshotBytes = written;
+        writeFieldIndexes(seg);
+    }
+    
+    // Дописать накопленные записи в журнал сегмента одним write и fsync.
+    // При ошибке журнал обрезается до прежнего размера, записи остаются в
+    // journal до следующей попытки.
+    void appendJournal(Segment& seg) {
+        if (partitioned()) {
+            std::filesystem::create_directories(partitionDir());
+        }
+        // Коллекции и сегменты находятся по файлам снимков
+        if (!std::filesystem::exists(seg.path)) {
+            std::ofstream(seg.path) << "{}\n";
+            seg.snapshotBytes = 3;
+        }
+        
+        std::string path = seg.logPath();
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open file for writing: " + path);
+        }
+        
+        size_t offset = 0;
+        while (offset < seg.journal.size()) {
+            ssize_t n = ::write(fd, seg.journal.data() + offset, seg.journal.size() - offset);
+            if (n <= 0) break;
+            offset += static_cast<size_t>(n);
+        }
+        bool ok = offset == seg.journal.size() && ::fsync(fd) == 0;
+        if (!ok) {
+            if (::ftruncate(fd, static_cast<off_t>(seg.logBytes)) != 0) {
+                std::cerr << "Cannot truncate " << path << "\n";
+            }
+            ::close(fd);
+            throw std::runtime_error("Cannot append to " + path);
+        }
+        ::close(fd);
+        
+        seg.logBytes += seg.journal.size();
+        seg.journal.clear();
+    }
+    
+    // Применение журнала поверх снимка. Недописанная последняя запись
+    // (процесс упал во время записи, строка без перевода строки)
+    // отбрасывается и обрезается в файле, чтобы новые записи шли за
+    // последней целой.
+    void replayJournal(Segment& seg) {
+        std::ifstream file(seg.logPath());
         if (!file.is_open()) {
-            throw std::runtime_error("Cannot open file for writing: " + filePath);
+            return;
         }
         
-        file << "{\n";
-        auto items = documents_.items();
-        for (size_t i = 0; i < items.size(); ++i) {
-            file << "  \"" << items[i].first << "\": " << items[i].second.toString();
-            if (i < items.size() - 1) {
-                file << ",";
+        JsonParser parser;
+        std::string line;
+        size_t valid = 0;
+        bool torn = false;
+        while (std::getline(file, line)) {
+            if (file.eof()) {
+                torn = true;  // строка без перевода строки
+                break;
+            }
+            valid += line.size() + 1;
+            try {
+                JsonValue record = parser.parse(line);
+                if (record.hasKey("put") && record["put"].hasKey("_id") && record["put"]["_id"].isString()) {
+                    const JsonValue& doc = record["put"];
+                    seg.documents.put(doc["_id"].asString(), doc);
+                    for (auto& index : seg.fields) index->add(doc["_id"].asString(), doc);
+                } else if (record.hasKey("del") && record["del"].isString()) {
+                    seg.documents.remove(record["del"].asString());
+                    for (auto& index : seg.fields) index->remove(record["del"].asString());
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "Skipping bad record in " << seg.logPath() << ": " << e.what() << "\n";
             }
-            file << "\n";
         }
-        file << "}\n";
         file.close();
+        
+        if (torn) {
+            std::error_code ec;
+            std::filesystem::resize_file(seg.logPath(), valid, ec);
+        }
+        seg.logBytes = valid;
     }
     
-    void loadCollection() {
-        std::string filePath = getCollectionPath();
+    void loadSegment(Segment& seg) {
+        seg.loaded = true;
+        seg.documents.clear();
+        seg.resetIndexes();
+        seg.journal.clear();
+        seg.logBytes = 0;
+        seg.snapshotBytes = 0;
         
-        if (!std::filesystem::exists(filePath)) {
-            documents_.clear();
+        if (!std::filesystem::exists(seg.path)) {
+            openFieldIndexes(seg);
             return;
         }
         
-        std::ifstream file(filePath);
+        std::ifstream file(seg.path);
         if (!file.is_open()) {
-            throw std::runtime_error("Cannot open file for reading: " + filePath);
+            throw std::runtime_error("Cannot open file for reading: " + seg.path);
         }
         
         std::ostringstream buffer;
         buffer << file.rdbuf();
         std::string content = buffer.str();
         file.close();
+        seg.snapshotBytes = content.size();
+        
+        if (content.find_first_not_of(" \t\n\r") != std::string::npos) {
+            try {
+                JsonParser parser;
+                JsonValue root = parser.parse(content);
+                
+                if (root.isObject()) {
+                    const auto& obj = root.asObject();
+                    for (const auto& [id, doc] : obj) {
+                        seg.documents.put(id, doc);
+                    }
+                }
+            } catch (...) {
+                seg.documents.clear();
+            }
+        }
         
-        if (content.empty() || content.find_first_not_of(" \t\n\r") == std::string::npos) {
-            documents_.clear();
+        openFieldIndexes(seg);
+        replayJournal(seg);
+    }
+    
+    // Изменение "expire" от ведущего: {"field": ..., "before": ...}. Сегменты
+    // целиком раньше границы удаляются файлами, в остальных (и в коллекции
+    // без разбиения) удаляются документы со временем раньше границы.
+    void expireBefore(const JsonValue& change, std::set<int64_t>& touched) {
+        int64_t before;
+        if (!change.hasKey("field") || !change["field"].isString() ||
+            !change.hasKey("before") || !TimePartition::timeValue(change["before"], before)) {
             return;
         }
+        std::string field = change["field"].asString();
+        bool sameField = partitioned() && field == partition_.field;
         
-        try {
-            JsonParser parser;
-            JsonValue root = parser.parse(content);
-            
-            if (!root.isObject()) {
-                documents_.clear();
-                return;
+        std::vector<int64_t> dropped;
+        for (auto& [key, seg] : segments_) {
+            if (sameField && key == TimePartition::UNTIMED) continue;
+            if (sameField && key >= before) break;
+            if (sameField && key + partition_.width <= before) {
+                dropped.push_back(key);
+                continue;
             }
             
-            documents_.clear();
-            auto obj = root.asObject();
-            for (const auto& [id, doc] : obj) {
-                documents_.put(id, doc);
+            Segment& loaded = segment(key);
+            std::vector<std::string> expired;
+            loaded.documents.forEach([&](const std::string& id, const JsonValue& doc) {
+                int64_t ts;
+                if (doc.hasKey(field) && TimePartition::timeValue(doc[field], ts) && ts < before) {
+                    expired.push_back(id);
+                }
+                return true;
+            });
+            for (const auto& id : expired) {
+                loaded.erase(id);
+            }
+            if (!expired.empty()) {
+                touched.insert(key);
             }
-        } catch (...) {
-            documents_.clear();
+        }
+        
+        for (int64_t key : dropped) {
+            removeSegmentFiles(segments_[key].path);
+            segments_.erase(key);
+            touched.erase(key);
         }
     }
     
 public:
-    Database(const std::string& dbPath, const std::string& collectionName) 
-        : dbPath_(dbPath), collectionName_(collectionName) {
+    // appendLog = false - режим без журнала: каждый flush() переписывает
+    // снимки измененных сегментов целиком
+    Database(const std::string& dbPath, const std::string& collectionName, bool appendLog = true) 
+        : dbPath_(dbPath), collectionName_(collectionName), appendLog_(appendLog) {
         // Создаем директорию базы данных, если её нет
         if (!std::filesystem::exists(dbPath_)) {
             std::filesystem::create_directories(dbPath_);
         }
         
-        loadCollection();
+        discoverSegments();
+        textFields_ = loadIndexFields("text");
+        trigramFields_ = loadIndexFields("trigram");
+        for (FieldIndex::Type type : {FieldIndex::Type::Hash, FieldIndex::Type::Ordered}) {
+            for (const auto& field : loadIndexFields(FieldIndex::typeName(type))) {
+                fieldIndexes_.push_back({field, type});
+            }
+        }
     }
     
-    void insert(const JsonValue& document) {
+    ~Database() {
+        try {
+            flush();
+        } catch (const std::exception& e) {
+            std::cerr << "Cannot save collection " << collectionName_ << ": " << e.what() << "\n";
+        }
+    }
+    
+    Database(const Database&) = delete;
+    Database& operator=(const Database&) = delete;
+    
+    // Запись измененных сегментов на диск; возвращает число записанных.
+    // Изменения дописываются в журналы (одна запись и fsync на сегмент за
+    // вызов), разросшийся журнал сжимается в новый снимок. Достаточно
+    // блокировки чтения коллекции: сегменты меняются только под блокировкой
+    // записи, так что сжатие не останавливает запросы на чтение.
+    size_t flush() {
+        std::lock_guard<std::mutex> lock(flushMutex_);
+        size_t written = 0;
+        for (auto& [key, seg] : segments_) {
+            if (!seg.dirty && seg.journal.empty()) continue;
+            if (seg.dirty || !appendLog_) {
+                saveSegment(seg);
+            } else {
+                appendJournal(seg);
+                if (seg.logBytes > COMPACT_MIN_LOG_BYTES && seg.logBytes > seg.snapshotBytes) {
+                    saveSegment(seg);
+                }
+            }
+            written++;
+        }
+        return written;
+    }
+    
+    bool appendLog() const {
+        return appendLog_;
+    }
+    
+    // Выгрузка сегментов, к которым не обращались с момента idleSince:
+    // документы и индексы освобождаются, следующее обращение прочитает
+    // сегмент с диска. Выгружаются только записанные сегменты (без
+    // записей журнала в памяти и отметки dirty), поэтому вызывать после
+    // flush() и под блокировкой записи коллекции.
+    size_t unloadIdle(std::chrono::steady_clock::time_point idleSince) {
+        std::lock_guard<std::mutex> lock(lazyMutex_);
+        size_t unloaded = 0;
+        for (auto& [key, seg] : segments_) {
+            if (!seg.loaded || seg.dirty || !seg.journal.empty() || seg.lastUse >= idleSince) continue;
+            seg.documents.clear();
+            seg.resetIndexes();
+            seg.fields.clear();
+            seg.fieldsWritten = false;
+            seg.loaded = false;
+            unloaded++;
+        }
+        return unloaded;
+    }
+    
+    // Есть ли на диске данные коллекции: снимок или каталог сегментов
+    static bool exists(const std::string& dbPath, const std::string& collectionName) {
+        std::error_code ec;
+        std::filesystem::path base = std::filesystem::path(dbPath) / collectionName;
+        return std::filesystem::exists(base.string() + ".json", ec) ||
+               std::filesystem::exists(base / TimePartition::SPEC_FILE, ec);
+    }
+    
+    // Строковый _id документа сохраняется (его назначает маршрутизатор шардов),
+    // иначе генерируется новый
+    std::string insert(const JsonValue& document) {
         JsonValue doc = document;
-        std::string id = generateId();
+        std::string id;
+        if (doc.hasKey("_id") && doc["_id"].isString() && !doc["_id"].asString().empty()) {
+            id = doc["_id"].asString();
+        } else {
+            id = generateId();
+        }
         doc["_id"] = JsonValue(id);
-        documents_.put(id, doc);
-        saveCollection();
+        Segment& seg = segment(segmentKey(doc));
+        seg.put(id, doc);
+        return id;
+    }
+    
+    // Применение изменений, полученных с ведущего сервера; они попадают в
+    // журналы сегментов, а сброс (reset) и удаление по времени переписывают
+    // снимки при следующем flush(). Вставки сохраняют исходный _id, удаления
+    // выполняются по _id, поэтому повторное применение тех же изменений безопасно.
+    void applyChanges(const std::vector<std::pair<std::string, JsonValue>>& changes, bool reset = false) {
+        std::set<int64_t> touched;
+        if (reset) {
+            for (auto& [key, seg] : segments_) {
+                seg.documents.clear();
+                seg.journal.clear();
+                seg.loaded = true;
+                seg.resetIndexes();
+                resetFieldIndexes(seg);
+                touched.insert(key);
+            }
+        }
+        for (const auto& [operation, doc] : changes) {
+            if (operation == "expire") {
+                expireBefore(doc, touched);
+                continue;
+            }
+            if (!doc.hasKey("_id") || !doc["_id"].isString()) continue;
+            Segment& seg = segment(segmentKey(doc));
+            std::string id = doc["_id"].asString();
+            if (operation == "insert") {
+                seg.put(id, doc);
+            } else if (operation == "delete") {
+                seg.erase(id);
+            }
+        }
+        for (int64_t key : touched) {
+            segments_[key].dirty = true;
+        }
+    }
+    
+    std::vector<JsonValue> documents() {
+        std::vector<JsonValue> result;
+        forEachSegment(TimePartition::Range(), [&](Segment& seg) {
+            seg.documents.forEach([&](const std::string&, const JsonValue& doc) {
+                result.push_back(doc);
+                return true;
+            });
+            return true;
+        });
+        return result;
     }
     
     std::vector<JsonValue> find(const JsonValue& query) {
         std::vector<JsonValue> results;
-        auto items = documents_.items();
+        forEachMatch(query, [&](Segment&, const std::string&, const JsonValue& doc) {
+            results.push_back(doc);
+            return true;
+        });
+        return results;
+    }
+
+    // Страница по упорядоченному индексу первого ключа сортировки: в
+    // каждом сегменте обход идет от значения after по порядку индекса и
+    // останавливается на группе ключа, после которой набрано limit
+    // документов. Годится, только если значение поля есть в индексе у
+    // всех документов сегмента: null, логические значения и объекты в
+    // индекс не попадают, а в порядке сортировки стоят по краям.
+    bool pageByIndex(const JsonValue& query, const Aggregator::SortKeys& sortKeys,
+                     const JsonValue* after, size_t limit, std::vector<JsonValue>& page) {
+        if (sortKeys.empty() || limit == 0) return false;
+        const auto& [field, direction] = sortKeys.front();
+        if (field.find('.') != std::string::npos) return false;
         
-        for (const auto& [id, doc] : items) {
-            if (QueryEvaluator::matches(doc, query)) {
-                results.push_back(doc);
+        size_t number = fieldIndexes_.size();
+        for (size_t i = 0; i < fieldIndexes_.size(); ++i) {
+            if (fieldIndexes_[i].field == field && fieldIndexes_[i].type == FieldIndex::Type::Ordered) {
+                number = i;
+                break;
             }
         }
+        if (number == fieldIndexes_.size()) return false;
         
-        return results;
+        std::string from;
+        if (after && (!after->hasKey(field) || !FieldIndex::orderedKey((*after)[field], from))) {
+            return false;
+        }
+        
+        bool usable = true;
+        TimePartition::Range range = queryRange(query);
+        forEachSegment(range, [&](Segment& seg) {
+            usable = number < seg.fields.size() && seg.fields[number]->indexed() == seg.documents.size();
+            return usable;
+        });
+        if (!usable) return false;
+        
+        forEachSegment(range, [&](Segment& seg) {
+            size_t found = 0;
+            seg.fields[number]->scan(from, direction < 0, [&](std::string_view, const std::vector<std::string>& ids) {
+                for (const std::string& id : ids) {
+                    const JsonValue* doc = seg.documents.find(id);
+                    if (doc == nullptr || !QueryEvaluator::matches(*doc, query)) continue;
+                    if (after && Aggregator::compareDocuments(*doc, *after, sortKeys) <= 0) continue;
+                    page.push_back(*doc);
+                    found++;
+                }
+                return found < limit;
+            });
+            return true;
+        });
+        Aggregator::sortTop(page, sortKeys, limit);
+        return true;
     }
     
-    int remove(const JsonValue& query) {
-        std::vector<std::string> idsToRemove;
-        auto items = documents_.items();
+    // Страница результата find: до limit документов в порядке sortKeys,
+    // идущих строго после документа after (nullptr - с начала). Порядок
+    // должен быть полным (последний ключ - _id), тогда страницы не
+    // пересекаются. Если первый ключ сортировки (или _id без сортировки)
+    // покрыт упорядоченным индексом, страница читается с позиции after
+    // и стоит пропорционально ее размеру. Иначе просматриваются все
+    // документы под запросом, в памяти держится не больше 2 * limit.
+    // matched - число всех документов под запросом; его подсчет - всегда
+    // полный просмотр, поэтому курсор запрашивает его один раз.
+    std::vector<JsonValue> findPage(const JsonValue& query, const Aggregator::SortKeys& sortKeys,
+                                    const JsonValue* after, size_t limit, size_t* matched = nullptr) {
+        std::vector<JsonValue> page;
+        if (pageByIndex(query, sortKeys, after, limit, page)) {
+            if (matched) {
+                *matched = 0;
+                forEachMatch(query, [&](Segment&, const std::string&, const JsonValue&) {
+                    ++*matched;
+                    return true;
+                });
+            }
+            return page;
+        }
+        
+        size_t count = 0;
+        forEachMatch(query, [&](Segment&, const std::string&, const JsonValue& doc) {
+            count++;
+            if (limit == 0 || (after && Aggregator::compareDocuments(doc, *after, sortKeys) <= 0)) {
+                return true;
+            }
+            page.push_back(doc);
+            if (page.size() >= 2 * limit) {
+                Aggregator::sortTop(page, sortKeys, limit);
+            }
+            return true;
+        });
+        Aggregator::sortTop(page, sortKeys, limit);
+        if (matched) *matched = count;
+        return page;
+    }
+
+    // Если removed задан, в него складываются удаленные документы
+    int remove(const JsonValue& query, std::vector<JsonValue>* removed = nullptr) {
+        // Удаленные _id по сегментам; документы удаляются после обхода
+        std::map<Segment*, std::vector<std::string>> idsToRemove;
+        forEachMatch(query, [&](Segment& seg, const std::string& id, const JsonValue& doc) {
+            idsToRemove[&seg].push_back(id);
+            if (removed) {
+                removed->push_back(doc);
+            }
+            return true;
+        });
         
-        for (const auto& [id, doc] : items) {
-            if (QueryEvaluator::matches(doc, query)) {
-                idsToRemove.push_back(id);
+        int removedCount = 0;
+        for (const auto& [seg, ids] : idsToRemove) {
+            for (const std::string& id : ids) {
+                seg->erase(id);
             }
+            removedCount += static_cast<int>(ids.size());
+        }
+        return removedCount;
+    }
+    
+    // Перевод коллекции на разбиение по полю времени field с шагом width
+    // секунд (или смена поля и шага). Документы переписываются в сегменты,
+    // затем сохраняется настройка и удаляются прежние файлы.
+    void partitionBy(const std::string& field, int64_t width) {
+        if (partitioned() && partition_.field == field && partition_.width == width) {
+            return;
         }
         
-        for (const std::string& id : idsToRemove) {
-            documents_.remove(id);
+        std::vector<std::string> oldPaths;
+        for (const auto& [key, seg] : segments_) {
+            oldPaths.push_back(seg.path);
         }
+        std::vector<JsonValue> docs = documents();
         
-        if (!idsToRemove.empty()) {
-            saveCollection();
+        // Политика хранения сохраняется при смене поля и шага
+        segments_.clear();
+        partition_.field = field;
+        partition_.width = width;
+        
+        std::set<std::string> newPaths;
+        for (const auto& doc : docs) {
+            int64_t key = segmentKey(doc);
+            Segment& seg = segments_[key];
+            seg.path = segmentPath(key);
+            seg.loaded = true;
+            seg.documents.put(doc["_id"].asString(), doc);
+        }
+        for (auto& [key, seg] : segments_) {
+            saveSegment(seg);
+            openFieldIndexes(seg);
+            newPaths.insert(seg.path);
         }
+        TimePartition::writeSpec(partitionDir(), partition_);
         
-        return idsToRemove.size();
+        for (const std::string& path : oldPaths) {
+            if (newPaths.count(path) == 0) {
+                removeSegmentFiles(path);
+            }
+        }
+    }
+    
+    // Число файлов-сегментов коллекции
+    size_t segmentCount() const {
+        return segments_.size();
+    }
+    
+    const TimePartition::Spec& partitionSpec() const {
+        return partition_;
+    }
+    
+    // Политика хранения коллекции с разбиением: максимальный возраст
+    // документов по полю разбиения и/или максимальное число документов
+    void setRetention(int64_t maxAge, int64_t maxDocuments) {
+        if (!partitioned()) {
+            throw std::runtime_error("Retention requires a time-partitioned collection");
+        }
+        partition_.maxAge = maxAge;
+        partition_.maxDocuments = maxDocuments;
+        TimePartition::writeSpec(partitionDir(), partition_);
     }
     
-    void createIndex(const std::string& field) {
-        // Базовая реализация индекса (можно расширить)
-        // Для задания со звездочкой - просто сохраняем информацию об индексе
-        std::string indexPath = std::filesystem::path(dbPath_) / (collectionName_ + "_" + field + "_index.json");
-        std::ofstream file(indexPath);
-        if (file.is_open()) {
-            file << "{\"field\": \"" << field << "\", \"collection\": \"" << collectionName_ << "\"}\n";
-            file.close();
+    struct ExpireResult {
+        size_t segments = 0;
+        size_t documents = 0;
+        int64_t before = TimePartition::UNTIMED;  // удалены все документы раньше этого момента
+    };
+    
+    // Применение политики хранения удалением старейших сегментов целиком,
+    // без чтения документов. Сегмент удаляется, если он весь старше
+    // now - maxAge или если без него в коллекции остается не меньше
+    // maxDocuments документов. sizeOf(path) - число документов в
+    // непрочитанном сегменте. Сегмент документов без времени не удаляется.
+    template<typename SizeOf>
+    ExpireResult expire(int64_t now, SizeOf sizeOf) {
+        ExpireResult result;
+        if (!partitioned() || !partition_.hasRetention()) return result;
+        
+        std::vector<int64_t> keys;
+        std::vector<size_t> sizes;
+        size_t total = 0;
+        for (auto& [key, seg] : segments_) {
+            // Непрочитанный сегмент с журналом читается: по снимку число
+            // документов не узнать
+            bool counted = seg.loaded || std::filesystem::exists(seg.logPath());
+            size_t size = counted ? segment(key).documents.size() : sizeOf(seg.path);
+            total += size;
+            if (key == TimePartition::UNTIMED) continue;
+            keys.push_back(key);
+            sizes.push_back(size);
+        }
+        
+        size_t dropCount = 0;
+        if (partition_.maxAge > 0) {
+            while (dropCount < keys.size() && keys[dropCount] + partition_.width <= now - partition_.maxAge) {
+                total -= sizes[dropCount];
+                dropCount++;
+            }
+        }
+        if (partition_.maxDocuments > 0) {
+            size_t limit = static_cast<size_t>(partition_.maxDocuments);
+            while (dropCount < keys.size() && total - sizes[dropCount] >= limit) {
+                total -= sizes[dropCount];
+                dropCount++;
+            }
+        }
+        if (dropCount == 0) return result;
+        
+        for (size_t i = 0; i < dropCount; ++i) {
+            removeSegmentFiles(segments_[keys[i]].path);
+            segments_.erase(keys[i]);
+            result.segments++;
+            result.documents += sizes[i];
+        }
+        result.before = keys[dropCount - 1] + partition_.width;
+        return result;
+    }
+    
+    std::vector<JsonValue> aggregate(const JsonValue& pipeline) {
+        Aggregator aggregator(pipeline);
+        
+        // Первый $match конвейера ограничивает сегменты по времени, а если
+        // его сужают индексы - и документы, которые читает конвейер
+        TimePartition::Range range;
+        if (pipeline.isArray()) {
+            const auto& stages = pipeline.asArray();
+            if (!stages.empty() && stages[0].hasKey("$match")) {
+                const JsonValue& match = stages[0]["$match"];
+                if (!indexPlan(match).empty()) {
+                    forEachMatch(match, [&](Segment&, const std::string&, const JsonValue& doc) {
+                        aggregator.consume(doc);
+                        return !aggregator.done();
+                    });
+                    return aggregator.finish();
+                }
+                range = queryRange(match);
+            }
+        }
+        
+        forEachSegment(range, [&](Segment& seg) {
+            seg.documents.forEach([&](const std::string&, const JsonValue& doc) {
+                aggregator.consume(doc);
+                return !aggregator.done();
+            });
+            return !aggregator.done();
+        });
+        return aggregator.finish();
+    }
+    
+    // Гистограмма по времени: количество документов в интервалах ширины
+    // bucketSeconds по полю field (ISO 8601 или секунды эпохи) за один проход.
+    // Значения, которые не читаются как время (в том числе числа вне
+    // TimePartition::MIN_TIME..MAX_TIME), пропускаются. Если задан groupBy, в каждом интервале считаются также подгруппы.
+    std::vector<JsonValue> histogram(const std::string& field, int64_t bucketSeconds,
+                                     int64_t from = std::numeric_limits<int64_t>::min(),
+                                     int64_t to = std::numeric_limits<int64_t>::max(),
+                                     const std::string& groupBy = "") {
+        struct Bucket {
+            int count = 0;
+            std::map<std::string, int> groups;
+        };
+        std::map<int64_t, Bucket> buckets;
+        
+        TimePartition::Range range;
+        if (partitioned() && field == partition_.field) {
+            range.from = from;
+            range.to = to == std::numeric_limits<int64_t>::max() ? to : to - 1;
+        }
+        
+        auto consume = [&](const std::string&, const JsonValue& doc) {
+            if (!doc.hasKey(field)) return true;
+            
+            int64_t ts;
+            if (!TimePartition::timeValue(doc[field], ts) || ts < from || ts >= to) return true;
+            
+            Bucket& bucket = buckets[TimeUtils::bucketStart(ts, bucketSeconds)];
+            bucket.count++;
+            if (!groupBy.empty()) {
+                std::string key = "null";
+                if (doc.hasKey(groupBy)) {
+                    const JsonValue& groupValue = doc[groupBy];
+                    key = groupValue.isString() ? groupValue.asString() : groupValue.toString();
+                }
+                bucket.groups[key]++;
+            }
+            return true;
+        };
+        forEachSegment(range, [&](Segment& seg) {
+            seg.documents.forEach(consume);
+            return true;
+        });
+        
+        std::vector<JsonValue> results;
+        results.reserve(buckets.size());
+        for (const auto& [start, bucket] : buckets) {
+            JsonValue entry;
+            entry["bucket"] = JsonValue(TimeUtils::formatIso8601(start));
+            entry["count"] = JsonValue(bucket.count);
+            if (!groupBy.empty()) {
+                JsonValue groups;
+                for (const auto& [key, count] : bucket.groups) {
+                    groups[key] = JsonValue(count);
+                }
+                entry["groups"] = groups;
+            }
+            results.push_back(entry);
+        }
+        return results;
+    }
+    
+    // Индекс типа "text" - полнотекстовый для $text, "trigram" - индекс
+    // триграмм для $like: поле добавляется в настройку, индексы сегментов
+    // перестраиваются при следующем запросе, который их использует.
+    // "hash" (по умолчанию) и "ordered" - индексы значений поля: в
+    // загруженных сегментах строятся сразу и записываются в файлы со
+    // следующим снимком, остальные сегменты строят их при открытии.
+    void createIndex(const std::string& field, const std::string& type = "") {
+        if (type == "text" || type == "trigram") {
+            std::vector<std::string>& fields = type == "text" ? textFields_ : trigramFields_;
+            if (std::find(fields.begin(), fields.end(), field) != fields.end()) return;
+            fields.push_back(field);
+            for (auto& [key, seg] : segments_) {
+                seg.resetIndexes();
+            }
+            saveIndexFields(type, fields);
+            return;
+        }
+        
+        FieldIndex::Type indexType;
+        if (!FieldIndex::parseType(type.empty() ? "hash" : type, indexType)) {
+            throw std::runtime_error("Unknown index type: " + type);
+        }
+        std::vector<std::string> fields;
+        for (const auto& spec : fieldIndexes_) {
+            if (spec.type != indexType) continue;
+            if (spec.field == field) return;
+            fields.push_back(spec.field);
+        }
+        fields.push_back(field);
+        fieldIndexes_.push_back({field, indexType});
+        saveIndexFields(FieldIndex::typeName(indexType), fields);
+        
+        for (auto& [key, seg] : segments_) {
+            if (!seg.loaded) continue;
+            auto index = std::make_unique<FieldIndex>(FieldIndex::fileName(seg.path, field, indexType), field, indexType);
+            seg.documents.forEach([&](const std::string& id, const JsonValue& doc) {
+                index->add(id, doc);
+                return true;
+            });
+            seg.fields.push_back(std::move(index));
+            seg.dirty = true;
         }
     }
 };
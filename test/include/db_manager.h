@@ -3,44 +3,304 @@
 
 #include "database.h"
 #include <mutex>
-#include <map>
 #include <memory>
 #include <shared_mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <ctime>
+#include <iostream>
+#include <algorithm>
 
+// Открытые коллекции живут в памяти между запросами: запрос работает с
+// уже загруженными сегментами и индексами, а изменения записываются на
+// диск фоновым потоком раз в flushIntervalMs (и при остановке сервера):
+// дописываются в журналы сегментов или, без журнала (appendLog = false),
+// переписывают снимки. Изменения последнего интервала при аварийном
+// завершении процесса теряются.
+// Сегменты, к которым не обращались IDLE_FLUSHES интервалов записи,
+// выгружаются из памяти после очередной записи и читаются с диска при
+// следующем запросе. Чтение коллекции, которой нет на диске, не открывает ее.
+// Блокировка чтения/записи своя у каждой коллекции, поэтому запись в одну
+// коллекцию не задерживает запросы к другим коллекциям той же базы.
 class DatabaseManager {
 private:
-    // Блокировки для каждой базы данных
-    std::map<std::string, std::shared_ptr<std::shared_mutex>> dbLocks_;
-    std::mutex locksMutex_; // Защищает сам map блокировок
-    
-    // Получить или создать блокировку для базы данных
-    std::shared_ptr<std::shared_mutex> getLock(const std::string& dbName) {
-        std::lock_guard<std::mutex> lock(locksMutex_);
-        if (dbLocks_.find(dbName) == dbLocks_.end()) {
-            dbLocks_[dbName] = std::make_shared<std::shared_mutex>();
-        }
-        return dbLocks_[dbName];
-    }
-    
+    // Открытая коллекция. Записи не удаляются до уничтожения менеджера,
+    // поэтому найденный указатель остается действительным.
+    struct Entry {
+        std::string dbName;
+        std::string collectionName;
+        std::shared_mutex lock;
+        std::unique_ptr<Database> database;
+        std::atomic<uint64_t> readWaitNs{0};
+        std::atomic<uint64_t> writeWaitNs{0};
+        Entry* next = nullptr;
+    };
+
+    // Полоса таблицы коллекций - список записей. Опубликованные записи не
+    // меняются, поэтому поиск идет без блокировок; mutex полосы нужен
+    // только для добавления новой коллекции.
+    struct Stripe {
+        std::atomic<Entry*> head{nullptr};
+        std::mutex mutex;
+    };
+
+    // Ожидание блокировок: count - все захваты, contended - захваты, не
+    // удавшиеся с первой попытки; время считается только у них
+    struct WaitStats {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> contended{0};
+        std::atomic<uint64_t> totalNs{0};
+        std::atomic<uint64_t> maxNs{0};
+
+        void record(uint64_t ns) {
+            contended++;
+            totalNs += ns;
+            uint64_t max = maxNs.load();
+            while (ns > max && !maxNs.compare_exchange_weak(max, ns)) {}
+        }
+
+        JsonValue toJson() const {
+            JsonValue stats;
+            stats["count"] = JsonValue(static_cast<double>(count.load()));
+            stats["contended"] = JsonValue(static_cast<double>(contended.load()));
+            stats["total_ms"] = JsonValue(static_cast<double>(totalNs.load()) / 1e6);
+            stats["max_ms"] = JsonValue(static_cast<double>(maxNs.load()) / 1e6);
+            return stats;
+        }
+    };
+
+    static constexpr size_t STRIPES = 64;
+    static constexpr int IDLE_FLUSHES = 60;
+
+    Stripe stripes_[STRIPES];
+    std::atomic<size_t> openCollections_;
+    WaitStats readWaits_;
+    WaitStats writeWaits_;
+
+    int flushIntervalMs_;
+    bool appendLog_;
+    std::atomic<bool> running_;
+    std::thread flusher_;
+    std::mutex wakeMutex_;
+    std::condition_variable wake_;
+    std::atomic<uint64_t> flushedSegments_;
+    std::atomic<uint64_t> unloadedSegments_;
+    std::atomic<std::time_t> lastFlush_;
+
+    Stripe& stripeFor(const std::string& dbName, const std::string& collectionName) {
+        uint64_t hash = FlatHash::mix(FlatHash::hashBytes(dbName.data(), dbName.size()),
+                                      FlatHash::hashBytes(collectionName.data(), collectionName.size()) | 1);
+        return stripes_[hash % STRIPES];
+    }
+
+    static Entry* findIn(const Stripe& stripe, const std::string& dbName, const std::string& collectionName) {
+        for (Entry* entry = stripe.head.load(std::memory_order_acquire); entry != nullptr; entry = entry->next) {
+            if (entry->collectionName == collectionName && entry->dbName == dbName) {
+                return entry;
+            }
+        }
+        return nullptr;
+    }
+
+    // Открытая коллекция; при первом обращении читается только список
+    // сегментов, документы загружаются по мере запросов
+    Entry* getEntry(const std::string& dbName, const std::string& collectionName) {
+        Stripe& stripe = stripeFor(dbName, collectionName);
+        if (Entry* entry = findIn(stripe, dbName, collectionName)) {
+            return entry;
+        }
+
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        if (Entry* entry = findIn(stripe, dbName, collectionName)) {
+            return entry;
+        }
+        auto entry = std::make_unique<Entry>();
+        entry->dbName = dbName;
+        entry->collectionName = collectionName;
+        entry->database = std::make_unique<Database>(dbName, collectionName, appendLog_);
+        entry->next = stripe.head.load(std::memory_order_relaxed);
+        stripe.head.store(entry.get(), std::memory_order_release);
+        openCollections_++;
+        return entry.release();
+    }
+
+    // Захват блокировки с замером ожидания, если сразу захватить не удалось
+    template<typename Lock>
+    static void acquire(Lock& lock, WaitStats& stats, std::atomic<uint64_t>& entryWaitNs) {
+        stats.count++;
+        if (lock.try_lock()) {
+            return;
+        }
+        auto start = std::chrono::steady_clock::now();
+        lock.lock();
+        uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+        stats.record(ns);
+        entryWaitNs += ns;
+    }
+
+    template<typename Func>
+    void forEachEntry(Func func) {
+        for (Stripe& stripe : stripes_) {
+            for (Entry* entry = stripe.head.load(std::memory_order_acquire); entry != nullptr; entry = entry->next) {
+                func(*entry);
+            }
+        }
+    }
+
+    void run() {
+        while (running_) {
+            {
+                std::unique_lock<std::mutex> lock(wakeMutex_);
+                wake_.wait_for(lock, std::chrono::milliseconds(flushIntervalMs_), [this] { return !running_; });
+            }
+            flush();
+            unloadIdle();
+        }
+    }
+
 public:
-    // Выполнить операцию с блокировкой на чтение
+    explicit DatabaseManager(int flushIntervalMs = 1000, bool appendLog = true)
+        : openCollections_(0), flushIntervalMs_(flushIntervalMs), appendLog_(appendLog), running_(false),
+          flushedSegments_(0), unloadedSegments_(0), lastFlush_(0) {}
+
+    ~DatabaseManager() {
+        stop();
+        for (Stripe& stripe : stripes_) {
+            Entry* entry = stripe.head.load();
+            while (entry != nullptr) {
+                Entry* next = entry->next;
+                delete entry;
+                entry = next;
+            }
+        }
+    }
+
+    DatabaseManager(const DatabaseManager&) = delete;
+    DatabaseManager& operator=(const DatabaseManager&) = delete;
+
+    // Запуск фоновой записи изменений
+    void start() {
+        if (running_) return;
+        running_ = true;
+        flusher_ = std::thread(&DatabaseManager::run, this);
+    }
+
+    // Остановка фоновой записи с записью оставшихся изменений
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex_);
+            running_ = false;
+        }
+        wake_.notify_all();
+        if (flusher_.joinable()) {
+            flusher_.join();
+        }
+        flush();
+    }
+
+    // Запись измененных сегментов всех открытых коллекций; возвращает
+    // число записанных сегментов
+    size_t flush() {
+        size_t written = 0;
+        forEachEntry([&](Entry& entry) {
+            std::shared_lock<std::shared_mutex> sharedLock(entry.lock);
+            try {
+                written += entry.database->flush();
+            } catch (const std::exception& e) {
+                std::cerr << "Flush of " << entry.dbName << "." << entry.collectionName
+                          << " failed: " << e.what() << "\n";
+            }
+        });
+        flushedSegments_ += written;
+        lastFlush_ = std::time(nullptr);
+        return written;
+    }
+
+    // Выгрузка давно не используемых сегментов всех коллекций. Коллекция,
+    // занятая запросом, пропускается до следующего раза.
+    size_t unloadIdle() {
+        auto idleSince = std::chrono::steady_clock::now() - std::chrono::milliseconds(flushIntervalMs_) * IDLE_FLUSHES;
+        size_t unloaded = 0;
+        forEachEntry([&](Entry& entry) {
+            std::unique_lock<std::shared_mutex> uniqueLock(entry.lock, std::try_to_lock);
+            if (uniqueLock.owns_lock()) {
+                unloaded += entry.database->unloadIdle(idleSince);
+            }
+        });
+        unloadedSegments_ += unloaded;
+        return unloaded;
+    }
+
+    JsonValue status() {
+        JsonValue status;
+        status["open_collections"] = JsonValue(static_cast<int>(openCollections_.load()));
+        status["flush_interval_ms"] = JsonValue(flushIntervalMs_);
+        status["persistence"] = JsonValue(appendLog_ ? "log" : "snapshot");
+        status["flushed_segments"] = JsonValue(static_cast<double>(flushedSegments_.load()));
+        status["unloaded_segments"] = JsonValue(static_cast<double>(unloadedSegments_.load()));
+        std::time_t last = lastFlush_.load();
+        status["last_flush"] = JsonValue(last > 0 ? TimeUtils::formatIso8601(last) : std::string());
+        return status;
+    }
+
+    // Ожидание блокировок коллекций: общие счетчики чтения и записи и
+    // коллекции, где ожидание было, по убыванию суммарного времени
+    JsonValue lockStats() {
+        std::vector<std::pair<uint64_t, JsonValue>> waited;
+        forEachEntry([&](Entry& entry) {
+            uint64_t readNs = entry.readWaitNs.load();
+            uint64_t writeNs = entry.writeWaitNs.load();
+            if (readNs + writeNs == 0) return;
+            JsonValue collection;
+            collection["database"] = JsonValue(entry.dbName);
+            collection["collection"] = JsonValue(entry.collectionName);
+            collection["read_wait_ms"] = JsonValue(static_cast<double>(readNs) / 1e6);
+            collection["write_wait_ms"] = JsonValue(static_cast<double>(writeNs) / 1e6);
+            waited.emplace_back(readNs + writeNs, collection);
+        });
+        std::sort(waited.begin(), waited.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+        std::vector<JsonValue> collections;
+        for (auto& [ns, collection] : waited) {
+            collections.push_back(collection);
+        }
+
+        JsonValue stats;
+        stats["read"] = readWaits_.toJson();
+        stats["write"] = writeWaits_.toJson();
+        stats["collections"] = JsonValue(collections);
+        return stats;
+    }
+
+    // Выполнить операцию с блокировкой коллекции на чтение. Коллекция,
+    // которой нет ни среди открытых, ни на диске, не открывается: запрос
+    // выполняется на пустой временной коллекции.
     template<typename Func>
     auto executeRead(const std::string& dbName, const std::string& collectionName, Func func) {
-        auto lock = getLock(dbName);
-        std::shared_lock<std::shared_mutex> sharedLock(*lock);
-        Database db(dbName, collectionName);
-        return func(db);
+        Entry* entry = findIn(stripeFor(dbName, collectionName), dbName, collectionName);
+        if (entry == nullptr && !Database::exists(dbName, collectionName)) {
+            Database empty(dbName, collectionName, appendLog_);
+            return func(empty);
+        }
+        if (entry == nullptr) {
+            entry = getEntry(dbName, collectionName);
+        }
+        std::shared_lock<std::shared_mutex> sharedLock(entry->lock, std::defer_lock);
+        acquire(sharedLock, readWaits_, entry->readWaitNs);
+        return func(*entry->database);
     }
-    
-    // Выполнить операцию с блокировкой на запись
+
+    // Выполнить операцию с блокировкой коллекции на запись
     template<typename Func>
     auto executeWrite(const std::string& dbName, const std::string& collectionName, Func func) {
-        auto lock = getLock(dbName);
-        std::unique_lock<std::shared_mutex> uniqueLock(*lock);
-        Database db(dbName, collectionName);
-        return func(db);
+        Entry* entry = getEntry(dbName, collectionName);
+        std::unique_lock<std::shared_mutex> uniqueLock(entry->lock, std::defer_lock);
+        acquire(uniqueLock, writeWaits_, entry->writeWaitNs);
+        return func(*entry->database);
     }
 };
 
 #endif // DB_MANAGER_H
-
@@ -0,0 +1,687 @@
+#ifndef FIELD_INDEX_H
+#define FIELD_INDEX_H
+
+#include "json_parser.h"
+#include "flat_hashmap.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <algorithm>
+#include <climits>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Индекс значений одного поля: "hash" - для условий на равенство ($eq,
+// $in), "ordered" - еще и для интервалов ($gt, $gte, $lt, $lte). Индекс
+// сегмента хранится в двоичном файле рядом со снимком и при открытии
+// сегмента отображается в память (mmap), поэтому перезапуск сервера его
+// не перестраивает. Файл соответствует снимку; изменения, сделанные
+// после него, ведутся в памяти: удаленные документы файла отмечаются в
+// removed_, новые значения лежат в added_. С новым снимком файл
+// индекса записывается заново.
+//
+// Ключ - значение поля с байтом типа. Строки ('s' + байты) сравниваются
+// как std::string::compare. Числа упорядоченного индекса ('n' + 8 байтов)
+// закодированы так, что порядок байтов совпадает с порядком чисел; в
+// хеш-индексе число хранится целой частью ('i'), как его сравнивает $eq
+// в QueryEvaluator.
+class FieldIndex {
+public:
+    enum class Type { Hash, Ordered };
+
+    // Снимок, по которому записан файл индекса
+    struct Stamp {
+        uint64_t size = 0;
+        int64_t mtimeNs = 0;
+
+        static bool of(const std::string& path, Stamp& stamp) {
+            struct stat st;
+            if (::stat(path.c_str(), &st) != 0) return false;
+            stamp.size = static_cast<uint64_t>(st.st_size);
+            stamp.mtimeNs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+            return true;
+        }
+    };
+
+    // Интервал ключей; у хеш-индекса только точки (from == to)
+    struct Interval {
+        std::string from;
+        std::string to;
+        bool fromInclusive = true;
+        bool toInclusive = true;
+    };
+
+    // Условие на поле в виде объединения интервалов ключей
+    using Lookup = std::vector<Interval>;
+
+private:
+    static constexpr char MAGIC[8] = {'F', 'I', 'D', 'X', 0, 0, 0, 1};
+    static constexpr size_t NONE = static_cast<size_t>(-1);
+
+    // Заголовок файла; за ним массивы idOffsets, keyOffsets, postingStarts
+    // (uint64), postings, slots (uint32) и байты _id и ключей. _id и ключи
+    // отсортированы, postings - номера документов (_id) по ключам, slots -
+    // открытая адресация по хешу ключа (номер ключа + 1, 0 - пусто).
+    struct Header {
+        char magic[8];
+        uint32_t type;
+        uint32_t reserved;
+        uint64_t stampSize;
+        int64_t stampMtimeNs;
+        uint64_t documents;  // документов в снимке
+        uint64_t idCount;    // документов со значением поля
+        uint64_t keyCount;
+        uint64_t postingCount;
+        uint64_t slotCount;
+        uint64_t idBytes;
+        uint64_t keyBytes;
+    };
+
+    struct Layout {
+        size_t idOffsets;
+        size_t keyOffsets;
+        size_t postingStarts;
+        size_t postings;
+        size_t slots;
+        size_t idBytes;
+        size_t keyBytes;
+        size_t size;
+    };
+
+    std::string path_;
+    std::string field_;
+    Type type_;
+
+    const char* map_ = nullptr;
+    size_t mapSize_ = 0;
+    const Header* header_ = nullptr;
+    const uint64_t* idOffsets_ = nullptr;
+    const uint64_t* keyOffsets_ = nullptr;
+    const uint64_t* postingStarts_ = nullptr;
+    const uint32_t* postings_ = nullptr;
+    const uint32_t* slots_ = nullptr;
+    const char* idBytes_ = nullptr;
+    const char* keyBytes_ = nullptr;
+
+    std::vector<bool> removed_;                               // документы файла, удаленные после снимка
+    size_t removedCount_ = 0;
+    std::map<std::string, std::set<std::string>> added_;      // ключ -> _id, добавленные после снимка
+    std::unordered_map<std::string, std::string> addedKeys_;  // _id -> ключ в added_
+
+    static size_t align8(size_t n) {
+        return (n + 7) & ~static_cast<size_t>(7);
+    }
+
+    static Layout layout(const Header& header) {
+        Layout l;
+        l.idOffsets = sizeof(Header);
+        l.keyOffsets = l.idOffsets + (header.idCount + 1) * sizeof(uint64_t);
+        l.postingStarts = l.keyOffsets + (header.keyCount + 1) * sizeof(uint64_t);
+        l.postings = l.postingStarts + (header.keyCount + 1) * sizeof(uint64_t);
+        l.slots = align8(l.postings + header.postingCount * sizeof(uint32_t));
+        l.idBytes = align8(l.slots + header.slotCount * sizeof(uint32_t));
+        l.keyBytes = l.idBytes + header.idBytes;
+        l.size = l.keyBytes + header.keyBytes;
+        return l;
+    }
+
+    static void appendBigEndian(std::string& key, uint64_t bits) {
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            key.push_back(static_cast<char>(bits >> shift));
+        }
+    }
+
+    static std::string stringKey(const std::string& value) {
+        return 's' + value;
+    }
+
+    static std::string integerKey(int value) {
+        std::string key(1, 'i');
+        appendBigEndian(key, static_cast<uint64_t>(static_cast<int64_t>(value)));
+        return key;
+    }
+
+    // У отрицательных чисел инвертируются все биты, у положительных -
+    // знаковый: беззнаковый порядок кодов совпадает с порядком чисел
+    static std::string numberKey(double value) {
+        if (value == 0) value = 0;  // -0.0 и 0.0 - один ключ
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        bits = (bits >> 63) ? ~bits : bits | (1ull << 63);
+        std::string key(1, 'n');
+        appendBigEndian(key, bits);
+        return key;
+    }
+
+    static bool keyOf(Type type, const JsonValue& value, std::string& key) {
+        if (value.isString()) {
+            key = stringKey(value.asString());
+        } else if (value.isInt()) {
+            key = type == Type::Hash ? integerKey(value.asInt()) : numberKey(value.asDouble());
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    // Значения, равные value по правилам $eq. Числа сравниваются по
+    // asInt(), то есть по целой части: упорядоченному индексу нужен
+    // интервал (k - 1, k + 1). На границах int приведение насыщается,
+    // такое условие индекс не сужает.
+    static bool equalTo(Type type, const JsonValue& value, Lookup& lookup) {
+        if (value.isString() || (value.isInt() && type == Type::Hash)) {
+            std::string key;
+            keyOf(type, value, key);
+            lookup.push_back({key, key, true, true});
+            return true;
+        }
+        if (!value.isInt()) return false;
+        int k = value.asInt();
+        if (k == INT_MIN || k == INT_MAX) return false;
+        lookup.push_back({numberKey(k - 1.0), numberKey(k + 1.0), false, false});
+        return true;
+    }
+
+    // Пересечение условий $gt, $gte, $lt, $lte. Граница-строка и
+    // граница-число одновременно не выполняются ни для какого значения.
+    static bool range(const JsonValue& condition, Lookup& lookup) {
+        Interval interval;
+        char tag = 0;
+        for (const std::string op : {"$gt", "$gte", "$lt", "$lte"}) {
+            if (!condition.hasKey(op)) continue;
+            const JsonValue& bound = condition[op];
+            char boundTag = bound.isString() ? 's' : bound.isInt() ? 'n' : 0;
+            if (boundTag == 0) return false;
+            if (tag != 0 && tag != boundTag) {
+                lookup.clear();
+                return true;
+            }
+            if (tag == 0) {
+                tag = boundTag;
+                interval.from = std::string(1, tag);
+                interval.to = std::string(1, static_cast<char>(tag + 1));
+                interval.toInclusive = false;
+            }
+
+            std::string key = bound.isString() ? stringKey(bound.asString()) : numberKey(bound.asDouble());
+            bool inclusive = op.size() == 4;
+            if (op[1] == 'g') {
+                if (key > interval.from || (key == interval.from && !inclusive)) {
+                    interval.from = key;
+                    interval.fromInclusive = inclusive;
+                }
+            } else if (key < interval.to || (key == interval.to && !inclusive)) {
+                interval.to = key;
+                interval.toInclusive = inclusive;
+            }
+        }
+        if (tag == 0) return false;
+        lookup.push_back(interval);
+        return true;
+    }
+
+    static bool above(std::string_view key, const Interval& interval) {
+        int cmp = key.compare(interval.from);
+        return cmp > 0 || (cmp == 0 && interval.fromInclusive);
+    }
+
+    static bool below(std::string_view key, const Interval& interval) {
+        int cmp = key.compare(interval.to);
+        return cmp < 0 || (cmp == 0 && interval.toInclusive);
+    }
+
+    size_t idCount() const {
+        return header_ ? header_->idCount : 0;
+    }
+
+    size_t keyCount() const {
+        return header_ ? header_->keyCount : 0;
+    }
+
+    std::string_view idAt(size_t number) const {
+        return std::string_view(idBytes_ + idOffsets_[number], idOffsets_[number + 1] - idOffsets_[number]);
+    }
+
+    std::string_view keyAt(size_t number) const {
+        return std::string_view(keyBytes_ + keyOffsets_[number], keyOffsets_[number + 1] - keyOffsets_[number]);
+    }
+
+    // Номер документа файла по _id
+    size_t baseNumber(const std::string& id) const {
+        size_t lo = 0;
+        size_t hi = idCount();
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            int cmp = idAt(mid).compare(id);
+            if (cmp == 0) return mid;
+            if (cmp < 0) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return NONE;
+    }
+
+    void appendPostings(size_t key, std::vector<std::string>& ids) const {
+        for (uint64_t i = postingStarts_[key]; i < postingStarts_[key + 1]; ++i) {
+            uint32_t doc = postings_[i];
+            if (!removed_[doc]) {
+                ids.emplace_back(idAt(doc));
+            }
+        }
+    }
+
+    void findBase(const Interval& interval, std::vector<std::string>& ids) const {
+        if (type_ == Type::Hash) {
+            size_t slots = header_->slotCount;
+            if (slots == 0) return;
+            uint64_t hash = FlatHash::hashBytes(interval.from.data(), interval.from.size());
+            for (size_t i = hash & (slots - 1);; i = (i + 1) & (slots - 1)) {
+                if (slots_[i] == 0) return;
+                if (keyAt(slots_[i] - 1) == interval.from) {
+                    appendPostings(slots_[i] - 1, ids);
+                    return;
+                }
+            }
+        }
+
+        size_t lo = 0;
+        size_t hi = keyCount();
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (above(keyAt(mid), interval)) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+        for (size_t key = lo; key < keyCount() && below(keyAt(key), interval); ++key) {
+            appendPostings(key, ids);
+        }
+    }
+
+    // Проверка отображенного файла и разметка массивов
+    bool attach(const Stamp& stamp, size_t documents) {
+        Header header;
+        std::memcpy(&header, map_, sizeof(header));
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+            header.type != static_cast<uint32_t>(type_) || header.stampSize != stamp.size ||
+            header.stampMtimeNs != stamp.mtimeNs || header.documents != documents) {
+            return false;
+        }
+        for (uint64_t count : {header.idCount, header.keyCount, header.postingCount, header.slotCount,
+                               header.idBytes, header.keyBytes}) {
+            if (count > mapSize_) return false;
+        }
+        Layout l = layout(header);
+        if (l.size != mapSize_ || header.idCount > UINT32_MAX || header.keyCount >= UINT32_MAX ||
+            (type_ == Type::Hash && header.keyCount > 0 &&
+             (header.slotCount <= header.keyCount || (header.slotCount & (header.slotCount - 1)) != 0))) {
+            return false;
+        }
+
+        header_ = reinterpret_cast<const Header*>(map_);
+        idOffsets_ = reinterpret_cast<const uint64_t*>(map_ + l.idOffsets);
+        keyOffsets_ = reinterpret_cast<const uint64_t*>(map_ + l.keyOffsets);
+        postingStarts_ = reinterpret_cast<const uint64_t*>(map_ + l.postingStarts);
+        postings_ = reinterpret_cast<const uint32_t*>(map_ + l.postings);
+        slots_ = reinterpret_cast<const uint32_t*>(map_ + l.slots);
+        idBytes_ = map_ + l.idBytes;
+        keyBytes_ = map_ + l.keyBytes;
+        return idOffsets_[header.idCount] == header.idBytes && keyOffsets_[header.keyCount] == header.keyBytes &&
+               postingStarts_[header.keyCount] == header.postingCount;
+    }
+
+    void unmap() {
+        if (map_ != nullptr) {
+            ::munmap(const_cast<char*>(map_), mapSize_);
+        }
+        map_ = nullptr;
+        mapSize_ = 0;
+        header_ = nullptr;
+    }
+
+    static void writeFile(const std::string& path, const std::string& data) {
+        std::string tempPath = path + ".tmp";
+        int fd = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open file for writing: " + tempPath);
+        }
+        size_t offset = 0;
+        while (offset < data.size()) {
+            ssize_t n = ::write(fd, data.data() + offset, data.size() - offset);
+            if (n <= 0) break;
+            offset += static_cast<size_t>(n);
+        }
+        bool ok = offset == data.size() && ::fsync(fd) == 0;
+        ::close(fd);
+        if (!ok || ::rename(tempPath.c_str(), path.c_str()) != 0) {
+            ::unlink(tempPath.c_str());
+            throw std::runtime_error("Cannot write index file: " + path);
+        }
+    }
+
+public:
+    FieldIndex(std::string path, std::string field, Type type)
+        : path_(std::move(path)), field_(std::move(field)), type_(type) {}
+
+    ~FieldIndex() {
+        unmap();
+    }
+
+    FieldIndex(const FieldIndex&) = delete;
+    FieldIndex& operator=(const FieldIndex&) = delete;
+
+    static const char* typeName(Type type) {
+        return type == Type::Hash ? "hash" : "ordered";
+    }
+
+    static bool parseType(const std::string& name, Type& type) {
+        if (name == "hash") {
+            type = Type::Hash;
+        } else if (name == "ordered") {
+            type = Type::Ordered;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    // Файл индекса поля рядом со снимком сегмента:
+    // <сегмент>.json.<тип>.<поле>.idx, символы поля вне [A-Za-z0-9_-]
+    // записываются как %XX
+    static std::string fileName(const std::string& segmentPath, const std::string& field, Type type) {
+        static const char* HEX = "0123456789abcdef";
+        std::string name = segmentPath + "." + typeName(type) + ".";
+        for (char c : field) {
+            if (std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-') {
+                name.push_back(c);
+            } else {
+                name.push_back('%');
+                name.push_back(HEX[static_cast<unsigned char>(c) >> 4]);
+                name.push_back(HEX[static_cast<unsigned char>(c) & 15]);
+            }
+        }
+        return name + ".idx";
+    }
+
+    // Условие на поле в интервалы ключей индекса типа type. false -
+    // условие индекс не сужает, документы проверяются полным просмотром.
+    static bool lookup(Type type, const JsonValue& condition, Lookup& result) {
+        result.clear();
+        if (!condition.isObject()) {
+            return equalTo(type, condition, result);
+        }
+        if (condition.hasKey("$eq")) {
+            return equalTo(type, condition["$eq"], result);
+        }
+        if (condition.hasKey("$in")) {
+            const JsonValue& items = condition["$in"];
+            if (!items.isArray()) return false;
+            // Значения других типов $in не находит
+            for (const auto& item : items.asArray()) {
+                if ((item.isString() || item.isInt()) && !equalTo(type, item, result)) return false;
+            }
+            return true;
+        }
+        return type == Type::Ordered && range(condition, result);
+    }
+
+    // Запись файла индекса по документам снимка stamp (таблица
+    // documents с forEach(id, doc)): во временный файл с заменой прежнего
+    template<typename Documents>
+    static void write(const std::string& path, const std::string& field, Type type, const Stamp& stamp,
+                      const Documents& documents) {
+        std::vector<std::pair<std::string, std::string>> entries;  // ключ, _id
+        documents.forEach([&](const std::string& id, const JsonValue& doc) {
+            std::string key;
+            if (doc.hasKey(field) && keyOf(type, doc[field], key)) {
+                entries.emplace_back(std::move(key), id);
+            }
+            return true;
+        });
+        std::sort(entries.begin(), entries.end());
+
+        std::vector<std::string_view> ids;
+        ids.reserve(entries.size());
+        for (const auto& entry : entries) ids.push_back(entry.second);
+        std::sort(ids.begin(), ids.end());
+
+        Header header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.type = static_cast<uint32_t>(type);
+        header.stampSize = stamp.size;
+        header.stampMtimeNs = stamp.mtimeNs;
+        header.documents = documents.size();
+        header.idCount = ids.size();
+        header.postingCount = entries.size();
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (i == 0 || entries[i].first != entries[i - 1].first) {
+                header.keyCount++;
+                header.keyBytes += entries[i].first.size();
+            }
+        }
+        for (const auto& id : ids) header.idBytes += id.size();
+        if (type == Type::Hash && header.keyCount > 0) {
+            header.slotCount = 1;
+            while (header.slotCount < 2 * header.keyCount) header.slotCount <<= 1;
+        }
+
+        Layout l = layout(header);
+        std::string data(l.size, '\0');
+        char* out = &data[0];
+        std::memcpy(out, &header, sizeof(header));
+        auto put64 = [&](size_t offset, size_t i, uint64_t value) {
+            std::memcpy(out + offset + i * sizeof(uint64_t), &value, sizeof(value));
+        };
+        auto put32 = [&](size_t offset, size_t i, uint32_t value) {
+            std::memcpy(out + offset + i * sizeof(uint32_t), &value, sizeof(value));
+        };
+
+        uint64_t bytes = 0;
+        for (size_t i = 0; i < ids.size(); ++i) {
+            put64(l.idOffsets, i, bytes);
+            std::memcpy(out + l.idBytes + bytes, ids[i].data(), ids[i].size());
+            bytes += ids[i].size();
+        }
+        put64(l.idOffsets, ids.size(), bytes);
+
+        bytes = 0;
+        uint64_t key = 0;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            const std::string& value = entries[i].first;
+            if (i == 0 || value != entries[i - 1].first) {
+                put64(l.keyOffsets, key, bytes);
+                put64(l.postingStarts, key, i);
+                std::memcpy(out + l.keyBytes + bytes, value.data(), value.size());
+                bytes += value.size();
+
+                if (header.slotCount > 0) {
+                    uint64_t slot = FlatHash::hashBytes(value.data(), value.size()) & (header.slotCount - 1);
+                    uint32_t taken;
+                    while (std::memcpy(&taken, out + l.slots + slot * sizeof(uint32_t), sizeof(taken)), taken != 0) {
+                        slot = (slot + 1) & (header.slotCount - 1);
+                    }
+                    put32(l.slots, slot, static_cast<uint32_t>(key + 1));
+                }
+                key++;
+            }
+            auto doc = std::lower_bound(ids.begin(), ids.end(), std::string_view(entries[i].second));
+            put32(l.postings, i, static_cast<uint32_t>(doc - ids.begin()));
+        }
+        put64(l.keyOffsets, key, bytes);
+        put64(l.postingStarts, key, entries.size());
+
+        writeFile(path, data);
+    }
+
+    // Отобразить в память файл индекса, записанный по снимку stamp с
+    // documents документами; false - файла нет или он от другого снимка
+    bool open(const Stamp& stamp, size_t documents) {
+        clear();
+        int fd = ::open(path_.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat st;
+        void* map = MAP_FAILED;
+        if (::fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(Header)) {
+            map = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (map == MAP_FAILED) return false;
+
+        map_ = static_cast<const char*>(map);
+        mapSize_ = static_cast<size_t>(st.st_size);
+        if (!attach(stamp, documents)) {
+            unmap();
+            return false;
+        }
+        removed_.assign(idCount(), false);
+        removedCount_ = 0;
+        return true;
+    }
+
+    // Пустой индекс без файла
+    void clear() {
+        unmap();
+        removed_.clear();
+        removedCount_ = 0;
+        added_.clear();
+        addedKeys_.clear();
+    }
+
+    void add(const std::string& id, const JsonValue& doc) {
+        remove(id);
+        std::string key;
+        if (!doc.hasKey(field_) || !keyOf(type_, doc[field_], key)) return;
+        added_[key].insert(id);
+        addedKeys_[id] = std::move(key);
+    }
+
+    void remove(const std::string& id) {
+        auto it = addedKeys_.find(id);
+        if (it != addedKeys_.end()) {
+            auto list = added_.find(it->second);
+            list->second.erase(id);
+            if (list->second.empty()) added_.erase(list);
+            addedKeys_.erase(it);
+        }
+        size_t number = baseNumber(id);
+        if (number != NONE && !removed_[number]) {
+            removed_[number] = true;
+            removedCount_++;
+        }
+    }
+
+    // _id документов, значение поля которых попадает в интервалы lookup
+    void find(const Lookup& lookup, std::vector<std::string>& ids) const {
+        ids.clear();
+        for (const Interval& interval : lookup) {
+            if (header_ != nullptr) {
+                findBase(interval, ids);
+            }
+            for (auto it = added_.lower_bound(interval.from); it != added_.end() && below(it->first, interval); ++it) {
+                if (above(it->first, interval)) {
+                    ids.insert(ids.end(), it->second.begin(), it->second.end());
+                }
+            }
+        }
+        // Интервалы $in могут пересекаться
+        if (lookup.size() > 1) {
+            std::sort(ids.begin(), ids.end());
+            ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+        }
+    }
+
+    // Обход ключей по порядку (descending - по убыванию), начиная с ключа
+    // from включительно; пустой from - с крайнего ключа. func получает
+    // ключ и _id его документов и возвращает false, чтобы остановить обход.
+    template<typename Func>
+    void scan(const std::string& from, bool descending, Func func) const {
+        size_t keys = keyCount();
+        size_t lo = 0;
+        size_t hi = keys;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            int cmp = keyAt(mid).compare(from);
+            if (cmp < 0 || (descending && cmp == 0)) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        // По возрастанию base - следующий ключ файла, по убыванию - base - 1
+        size_t base = descending && from.empty() ? keys : lo;
+        auto added = descending ? (from.empty() ? added_.end() : added_.upper_bound(from)) : added_.lower_bound(from);
+
+        std::vector<std::string> ids;
+        while (true) {
+            bool hasBase = descending ? base > 0 : base < keys;
+            bool hasAdded = descending ? added != added_.begin() : added != added_.end();
+            if (!hasBase && !hasAdded) return;
+
+            auto addedIt = descending && hasAdded ? std::prev(added) : added;
+            int cmp = 0;
+            if (hasBase && hasAdded) {
+                cmp = keyAt(descending ? base - 1 : base).compare(addedIt->first);
+                if (descending) cmp = -cmp;
+            }
+            bool takeBase = hasBase && (!hasAdded || cmp <= 0);
+            bool takeAdded = hasAdded && (!hasBase || cmp >= 0);
+
+            ids.clear();
+            std::string_view key;
+            if (takeBase) {
+                size_t number = descending ? --base : base++;
+                key = keyAt(number);
+                appendPostings(number, ids);
+            }
+            if (takeAdded) {
+                key = addedIt->first;
+                ids.insert(ids.end(), addedIt->second.begin(), addedIt->second.end());
+                added = descending ? addedIt : std::next(addedIt);
+            }
+            if (!ids.empty() && !func(key, ids)) return;
+        }
+    }
+
+    // Ключ значения в упорядоченном индексе; false - значение (null,
+    // логическое, объект) в индекс не попадает
+    static bool orderedKey(const JsonValue& value, std::string& key) {
+        return keyOf(Type::Ordered, value, key);
+    }
+
+    // Число документов, значение поля которых есть в индексе
+    size_t indexed() const {
+        return idCount() - removedCount_ + addedKeys_.size();
+    }
+
+    const std::string& path() const {
+        return path_;
+    }
+
+    const std::string& field() const {
+        return field_;
+    }
+
+    Type type() const {
+        return type_;
+    }
+
+    // Файл отображен в память (индекс не строился заново)
+    bool mapped() const {
+        return header_ != nullptr;
+    }
+};
+
+#endif // FIELD_INDEX_H
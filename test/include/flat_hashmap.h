@@ -0,0 +1,510 @@
+#ifndef FLAT_HASHMAP_H
+#define FLAT_HASHMAP_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <type_traits>
+#include <functional>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace FlatHash {
+
+// Управляющие байты свободных ячеек; у занятой - 7 битов хеша (0..127)
+constexpr int8_t EMPTY = -128;
+constexpr int8_t DELETED = -2;
+
+inline uint64_t read64(const char* p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint64_t read32(const char* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// Перемешивание произведением 64x64 -> 128 бит
+inline uint64_t mix(uint64_t a, uint64_t b) {
+    __uint128_t product = static_cast<__uint128_t>(a) * b;
+    return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+}
+
+// Хеш строки по 8-16 байт за шаг (в духе wyhash) вместо побайтового djb2
+inline uint64_t hashBytes(const char* p, size_t n) {
+    constexpr uint64_t K0 = 0xa0761d6478bd642full;
+    constexpr uint64_t K1 = 0xe7037ed1a0b428dbull;
+    constexpr uint64_t K2 = 0x8ebc6af09c88c6e3ull;
+
+    uint64_t seed = K0 ^ n;
+    while (n > 16) {
+        seed = mix(read64(p) ^ K1, read64(p + 8) ^ seed);
+        p += 16;
+        n -= 16;
+    }
+
+    uint64_t a = 0, b = 0;
+    if (n > 8) {
+        a = read64(p);
+        b = read64(p + n - 8);
+    } else if (n >= 4) {
+        a = read32(p);
+        b = read32(p + n - 4);
+    } else if (n > 0) {
+        a = static_cast<uint64_t>(static_cast<unsigned char>(p[0])) << 16 |
+            static_cast<uint64_t>(static_cast<unsigned char>(p[n >> 1])) << 8 |
+            static_cast<uint64_t>(static_cast<unsigned char>(p[n - 1]));
+    }
+    return mix(a ^ K1 ^ n, mix(b ^ seed, K2));
+}
+
+template<typename K>
+uint64_t hash(const K& key) {
+    if constexpr (std::is_convertible_v<const K&, std::string_view>) {
+        std::string_view view(key);
+        return hashBytes(view.data(), view.size());
+    } else {
+        // std::hash для целых - тождественная функция, биты нужно перемешать
+        return mix(static_cast<uint64_t>(std::hash<K>{}(key)) ^ 0x9e3779b97f4a7c15ull, 0xbf58476d1ce4e5b9ull);
+    }
+}
+
+// Группа из 16 управляющих байтов: маски совпадений по одному биту на
+// байт. С SSE2 группа сравнивается за одну инструкцию, без него - в цикле.
+class Group {
+public:
+    static constexpr size_t WIDTH = 16;
+
+    explicit Group(const int8_t* ctrl) {
+#if defined(__SSE2__)
+        ctrl_ = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl));
+#else
+        std::memcpy(ctrl_, ctrl, WIDTH);
+#endif
+    }
+
+    // Позиции с заданным 7-битным фрагментом хеша
+    uint32_t match(int8_t h2) const {
+#if defined(__SSE2__)
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl_, _mm_set1_epi8(h2))));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < WIDTH; ++i) {
+            if (ctrl_[i] == h2) mask |= 1u << i;
+        }
+        return mask;
+#endif
+    }
+
+    // Пустые позиции (поиск ключа на них заканчивается)
+    uint32_t matchEmpty() const {
+        return match(EMPTY);
+    }
+
+    // Пустые и удаленные позиции - у них установлен старший бит
+    uint32_t matchFree() const {
+#if defined(__SSE2__)
+        return static_cast<uint32_t>(_mm_movemask_epi8(ctrl_));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < WIDTH; ++i) {
+            if (ctrl_[i] < 0) mask |= 1u << i;
+        }
+        return mask;
+#endif
+    }
+
+private:
+#if defined(__SSE2__)
+    __m128i ctrl_;
+#else
+    int8_t ctrl_[WIDTH];
+#endif
+};
+
+inline unsigned lowestBit(uint32_t mask) {
+    return static_cast<unsigned>(__builtin_ctz(mask));
+}
+
+// Число нулевых старших битов в 16-битной маске группы
+inline unsigned highestBitGap(uint32_t mask) {
+    return static_cast<unsigned>(__builtin_clz(mask)) - 16;
+}
+
+}  // namespace FlatHash
+
+// Хеш-таблица с открытой адресацией в духе SwissTable. Для каждой ячейки
+// хранится управляющий байт: 7 младших битов хеша для занятой ячейки или
+// признак пустой/удаленной. Поиск сравнивает сразу 16 управляющих байтов
+// и проверяет ключи только у совпавших, так что цепочек указателей и
+// лишних сравнений строк нет. Интерфейс совпадает с HashMap; ключи-строки
+// можно искать по std::string_view без создания std::string.
+// Как и в HashMap, перестройка постепенная: прежняя таблица остается до
+// конца переноса, каждая вставка и удаление переносят MIGRATE_STEP ее
+// ячеек, поиск смотрит в обе таблицы.
+template<typename K, typename V>
+class FlatHashMap {
+public:
+    // Тип ключа в операциях поиска: для строк - string_view
+    using Lookup = std::conditional_t<std::is_same_v<K, std::string>, std::string_view, K>;
+
+private:
+    using Group = FlatHash::Group;
+
+    static constexpr int8_t EMPTY = FlatHash::EMPTY;
+    static constexpr int8_t DELETED = FlatHash::DELETED;
+    static constexpr size_t INITIAL_CAPACITY = 16;
+    static constexpr size_t MIGRATE_STEP = 4;  // ячеек прежней таблицы за операцию записи
+
+    struct Slot {
+        K key;
+        V value;
+
+        template<typename KeyArg, typename ValueArg>
+        Slot(KeyArg&& k, ValueArg&& v) : key(std::forward<KeyArg>(k)), value(std::forward<ValueArg>(v)) {}
+    };
+
+    // Управляющие байты и ячейки одной таблицы. Байтов capacity + WIDTH - 1:
+    // последние повторяют первые, чтобы группа у конца читалась без переноса.
+    struct Table {
+        std::unique_ptr<int8_t[]> ctrl;
+        Slot* slots = nullptr;
+        size_t capacity = 0;
+
+        // Перемещенная таблица остается пустой: capacity без ctrl
+        // означал бы ячейки, которых уже нет
+        Table() = default;
+
+        Table(Table&& other) noexcept
+            : ctrl(std::move(other.ctrl)),
+              slots(std::exchange(other.slots, nullptr)),
+              capacity(std::exchange(other.capacity, 0)) {}
+
+        Table& operator=(Table&& other) noexcept {
+            if (this != &other) {
+                release();
+                ctrl = std::move(other.ctrl);
+                slots = std::exchange(other.slots, nullptr);
+                capacity = std::exchange(other.capacity, 0);
+            }
+            return *this;
+        }
+
+        void allocate(size_t size) {
+            capacity = size;
+            ctrl.reset(new int8_t[capacity + Group::WIDTH - 1]);
+            std::memset(ctrl.get(), static_cast<unsigned char>(EMPTY), capacity + Group::WIDTH - 1);
+            slots = std::allocator<Slot>().allocate(capacity);
+        }
+
+        void release() {
+            if (slots == nullptr) return;
+            if constexpr (!std::is_trivially_destructible_v<Slot>) {
+                for (size_t i = 0; i < capacity; ++i) {
+                    if (ctrl[i] >= 0) slots[i].~Slot();
+                }
+            }
+            std::allocator<Slot>().deallocate(slots, capacity);
+            slots = nullptr;
+            ctrl.reset();
+            capacity = 0;
+        }
+
+        void setCtrl(size_t index, int8_t value) {
+            ctrl[index] = value;
+            ctrl[((index - (Group::WIDTH - 1)) & (capacity - 1)) + (Group::WIDTH - 1)] = value;
+        }
+
+        // Индекс ячейки с ключом или capacity, если ключа нет
+        size_t find(const Lookup& key, uint64_t hash) const {
+            size_t mask = capacity - 1;
+            size_t pos = h1(hash) & mask;
+            for (size_t step = Group::WIDTH;; step += Group::WIDTH) {
+                Group group(ctrl.get() + pos);
+                for (uint32_t match = group.match(h2(hash)); match != 0; match &= match - 1) {
+                    size_t index = (pos + FlatHash::lowestBit(match)) & mask;
+                    if (slots[index].key == key) return index;
+                }
+                if (group.matchEmpty() != 0) return capacity;
+                pos = (pos + step) & mask;
+            }
+        }
+
+        // Первая пустая или удаленная ячейка на пути поиска
+        size_t findFree(uint64_t hash) const {
+            size_t mask = capacity - 1;
+            size_t pos = h1(hash) & mask;
+            for (size_t step = Group::WIDTH;; step += Group::WIDTH) {
+                uint32_t free = Group(ctrl.get() + pos).matchFree();
+                if (free != 0) return (pos + FlatHash::lowestBit(free)) & mask;
+                pos = (pos + step) & mask;
+            }
+        }
+    };
+
+    Table table_;
+    Table old_;             // прежняя таблица во время переноса
+    size_t migrated_ = 0;   // ячейки old_ до этой уже перенесены
+    size_t size_ = 0;       // элементы обеих таблиц
+    size_t growthLeft_ = 0; // сколько пустых ячеек table_ можно занять до перестройки
+
+    static size_t maxLoad(size_t capacity) {
+        return capacity - capacity / 8;  // заполнение не выше 7/8
+    }
+
+    static size_t h1(uint64_t hash) {
+        return static_cast<size_t>(hash >> 7);
+    }
+
+    static int8_t h2(uint64_t hash) {
+        return static_cast<int8_t>(hash & 0x7F);
+    }
+
+    bool rehashing() const {
+        return old_.slots != nullptr;
+    }
+
+    void allocate(size_t capacity) {
+        table_.allocate(capacity);
+        growthLeft_ = maxLoad(capacity);
+    }
+
+    template<typename KeyArg, typename ValueArg>
+    void place(uint64_t hash, KeyArg&& key, ValueArg&& value) {
+        size_t index = table_.findFree(hash);
+        new (&table_.slots[index]) Slot(std::forward<KeyArg>(key), std::forward<ValueArg>(value));
+        if (table_.ctrl[index] == EMPTY) growthLeft_--;
+        table_.setCtrl(index, h2(hash));
+    }
+
+    // Начать перенос в таблицу новой емкости; элементы пока на месте
+    void resize(size_t capacity) {
+        while (rehashing()) {
+            migrateStep();
+        }
+        old_ = std::move(table_);
+        migrated_ = 0;
+        allocate(capacity);
+    }
+
+    // Перенести следующие MIGRATE_STEP ячеек прежней таблицы
+    void migrateStep() {
+        if (!rehashing()) return;
+
+        size_t end = std::min(migrated_ + MIGRATE_STEP, old_.capacity);
+        for (; migrated_ < end; ++migrated_) {
+            if (old_.ctrl[migrated_] < 0) continue;
+            Slot& slot = old_.slots[migrated_];
+            place(FlatHash::hash(slot.key), std::move(slot.key), std::move(slot.value));
+            slot.~Slot();
+            old_.setCtrl(migrated_, DELETED);
+        }
+
+        if (migrated_ == old_.capacity) {
+            old_.release();
+        }
+    }
+
+    const Slot* findSlot(const Lookup& key) const {
+        uint64_t hash = FlatHash::hash(key);
+        size_t index = table_.find(key, hash);
+        if (index != table_.capacity) return &table_.slots[index];
+        if (rehashing()) {
+            index = old_.find(key, hash);
+            if (index != old_.capacity) return &old_.slots[index];
+        }
+        return nullptr;
+    }
+
+    template<typename ValueArg>
+    void insert(const Lookup& key, ValueArg&& value) {
+        migrateStep();
+
+        Slot* existing = const_cast<Slot*>(findSlot(key));
+        if (existing != nullptr) {
+            existing->value = std::forward<ValueArg>(value);
+            return;
+        }
+
+        uint64_t hash = FlatHash::hash(key);
+        if (growthLeft_ == 0 && table_.ctrl[table_.findFree(hash)] == EMPTY) {
+            // Рост вдвое или, если место заняли удаленные ячейки,
+            // перестройка того же размера
+            resize(size_ * 2 >= maxLoad(table_.capacity) ? table_.capacity * 2 : table_.capacity);
+        }
+        place(hash, K(key), std::forward<ValueArg>(value));
+        size_++;
+    }
+
+    void moveFrom(FlatHashMap& other) {
+        table_ = std::move(other.table_);
+        old_ = std::move(other.old_);
+        migrated_ = other.migrated_;
+        size_ = other.size_;
+        growthLeft_ = other.growthLeft_;
+        other.migrated_ = 0;
+        other.size_ = 0;
+        other.allocate(INITIAL_CAPACITY);
+    }
+
+public:
+    FlatHashMap() {
+        allocate(INITIAL_CAPACITY);
+    }
+
+    ~FlatHashMap() {
+        table_.release();
+        old_.release();
+    }
+
+    FlatHashMap(const FlatHashMap& other) {
+        allocate(other.table_.capacity);
+        other.forEach([this](const K& key, const V& value) {
+            put(key, value);
+            return true;
+        });
+    }
+
+    FlatHashMap(FlatHashMap&& other) noexcept {
+        moveFrom(other);
+    }
+
+    FlatHashMap& operator=(const FlatHashMap& other) {
+        if (this != &other) {
+            FlatHashMap copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    FlatHashMap& operator=(FlatHashMap&& other) noexcept {
+        if (this != &other) {
+            table_.release();
+            old_.release();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    void put(const Lookup& key, const V& value) {
+        insert(key, value);
+    }
+
+    void put(const Lookup& key, V&& value) {
+        insert(key, std::move(value));
+    }
+
+    bool get(const Lookup& key, V& value) const {
+        const Slot* slot = findSlot(key);
+        if (slot == nullptr) return false;
+        value = slot->value;
+        return true;
+    }
+
+    // Указатель на значение без копирования или nullptr; действителен до
+    // следующей вставки или удаления
+    const V* find(const Lookup& key) const {
+        const Slot* slot = findSlot(key);
+        return slot == nullptr ? nullptr : &slot->value;
+    }
+
+    V* find(const Lookup& key) {
+        const Slot* slot = findSlot(key);
+        return slot == nullptr ? nullptr : const_cast<V*>(&slot->value);
+    }
+
+    bool contains(const Lookup& key) const {
+        return findSlot(key) != nullptr;
+    }
+
+    bool remove(const Lookup& key) {
+        migrateStep();
+
+        uint64_t hash = FlatHash::hash(key);
+        size_t index = table_.find(key, hash);
+        if (index == table_.capacity) {
+            if (!rehashing()) return false;
+            size_t oldIndex = old_.find(key, hash);
+            if (oldIndex == old_.capacity) return false;
+            old_.slots[oldIndex].~Slot();
+            old_.setCtrl(oldIndex, DELETED);
+            size_--;
+            return true;
+        }
+
+        table_.slots[index].~Slot();
+        size_--;
+
+        // Ячейку можно сделать пустой, если ни одна группа, читаемая поиском,
+        // не была через нее целиком заполненной: тогда ни один поиск не
+        // проходил дальше нее. Иначе она остается удаленной до перестройки.
+        size_t mask = table_.capacity - 1;
+        uint32_t emptyAfter = Group(table_.ctrl.get() + index).matchEmpty();
+        uint32_t emptyBefore = Group(table_.ctrl.get() + ((index - Group::WIDTH) & mask)).matchEmpty();
+        if (emptyAfter != 0 && emptyBefore != 0 &&
+            FlatHash::lowestBit(emptyAfter) + FlatHash::highestBitGap(emptyBefore) < Group::WIDTH) {
+            table_.setCtrl(index, EMPTY);
+            growthLeft_++;
+        } else {
+            table_.setCtrl(index, DELETED);
+        }
+
+        // После массового удаления таблица сжимается тем же переносом
+        if (!rehashing() && table_.capacity > INITIAL_CAPACITY && size_ < table_.capacity / 8) {
+            resize(table_.capacity / 2);
+        }
+        return true;
+    }
+
+    std::vector<std::pair<K, V>> items() const {
+        std::vector<std::pair<K, V>> result;
+        result.reserve(size_);
+        forEach([&result](const K& key, const V& value) {
+            result.emplace_back(key, value);
+            return true;
+        });
+        return result;
+    }
+
+    // Обход всех элементов без копирования; обход прекращается,
+    // если функция вернула false
+    template<typename Func>
+    void forEach(Func func) const {
+        for (const Table* table : {&table_, &old_}) {
+            if (table == &old_ && !rehashing()) break;
+            for (size_t i = 0; i < table->capacity; ++i) {
+                if (table->ctrl[i] >= 0 && !func(table->slots[i].key, table->slots[i].value)) {
+                    return;
+                }
+            }
+        }
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    void clear() {
+        table_.release();
+        old_.release();
+        size_ = 0;
+        allocate(INITIAL_CAPACITY);
+    }
+};
+
+#endif // FLAT_HASHMAP_H
@@ -0,0 +1,139 @@
+#ifndef FLAT_MAP_H
+#define FLAT_MAP_H
+
+#include <vector>
+#include <utility>
+#include <tuple>
+#include <algorithm>
+#include <stdexcept>
+
+// Упорядоченный словарь в одном массиве пар: поля объекта JSON лежат
+// подряд, без отдельного узла на каждое, поиск - двоичный по ключу.
+// Порядок обхода - по возрастанию ключа, как у std::map.
+// Вставка в середину сдвигает хвост массива, поэтому большой словарь,
+// ключи которого приходят вразнобой, лучше собрать целиком и передать
+// в assign(): он сортируется один раз.
+// Итератор (как и у std::vector) недействителен после вставки и удаления.
+template<typename K, typename V>
+class FlatMap {
+public:
+    using value_type = std::pair<K, V>;
+    using iterator = typename std::vector<value_type>::iterator;
+    using const_iterator = typename std::vector<value_type>::const_iterator;
+
+private:
+    std::vector<value_type> items_;
+
+    template<typename Key>
+    const_iterator lowerBound(const Key& key) const {
+        return std::lower_bound(items_.begin(), items_.end(), key,
+                                [](const value_type& item, const Key& k) { return item.first < k; });
+    }
+
+    template<typename Key>
+    iterator lowerBound(const Key& key) {
+        return std::lower_bound(items_.begin(), items_.end(), key,
+                                [](const value_type& item, const Key& k) { return item.first < k; });
+    }
+
+public:
+    FlatMap() = default;
+
+    iterator begin() { return items_.begin(); }
+    iterator end() { return items_.end(); }
+    const_iterator begin() const { return items_.begin(); }
+    const_iterator end() const { return items_.end(); }
+
+    size_t size() const { return items_.size(); }
+    bool empty() const { return items_.empty(); }
+    void clear() { items_.clear(); }
+    void reserve(size_t count) { items_.reserve(count); }
+
+    // Ключ можно искать без создания K (например, строку по const char*)
+    template<typename Key>
+    const_iterator find(const Key& key) const {
+        auto it = lowerBound(key);
+        return it != items_.end() && !(key < it->first) ? it : items_.end();
+    }
+
+    template<typename Key>
+    iterator find(const Key& key) {
+        auto it = lowerBound(key);
+        return it != items_.end() && !(key < it->first) ? it : items_.end();
+    }
+
+    template<typename Key>
+    size_t count(const Key& key) const {
+        return find(key) != items_.end() ? 1 : 0;
+    }
+
+    template<typename Key>
+    const V& at(const Key& key) const {
+        auto it = find(key);
+        if (it == items_.end()) {
+            throw std::out_of_range("FlatMap::at: key not found");
+        }
+        return it->second;
+    }
+
+    template<typename Key>
+    V& at(const Key& key) {
+        return const_cast<V&>(static_cast<const FlatMap&>(*this).at(key));
+    }
+
+    // Вставка без замены существующего значения
+    template<typename... Args>
+    std::pair<iterator, bool> try_emplace(K key, Args&&... args) {
+        auto it = lowerBound(key);
+        if (it != items_.end() && !(key < it->first)) {
+            return {it, false};
+        }
+        it = items_.emplace(it, std::piecewise_construct, std::forward_as_tuple(std::move(key)),
+                            std::forward_as_tuple(std::forward<Args>(args)...));
+        return {it, true};
+    }
+
+    V& operator[](const K& key) {
+        return try_emplace(key).first->second;
+    }
+
+    V& operator[](K&& key) {
+        return try_emplace(std::move(key)).first->second;
+    }
+
+    template<typename Key>
+    size_t erase(const Key& key) {
+        auto it = find(key);
+        if (it == items_.end()) return 0;
+        items_.erase(it);
+        return 1;
+    }
+
+    iterator erase(const_iterator it) {
+        return items_.erase(it);
+    }
+
+    // Замена содержимого парами в любом порядке: одна сортировка вместо
+    // вставок по одной; из повторяющихся ключей остается последний
+    void assign(std::vector<value_type>&& items) {
+        items_ = std::move(items);
+        auto notLess = [](const value_type& a, const value_type& b) { return !(a.first < b.first); };
+        if (std::adjacent_find(items_.begin(), items_.end(), notLess) == items_.end()) {
+            return;
+        }
+        std::stable_sort(items_.begin(), items_.end(),
+                         [](const value_type& a, const value_type& b) { return a.first < b.first; });
+        // Сдвиг последнего из каждой группы равных ключей на место первого
+        auto out = items_.begin();
+        for (auto it = items_.begin(); it != items_.end();) {
+            auto last = it;
+            while (last + 1 != items_.end() && !(it->first < (last + 1)->first)) ++last;
+            if (out != last) *out = std::move(*last);
+            ++out;
+            it = last + 1;
+        }
+        items_.erase(out, items_.end());
+    }
+};
+
+#endif // FLAT_MAP_H
@@ -4,11 +4,19 @@
 #include <string>
 #include <vector>
 #include <list>
+#include <algorithm>
 #include <utility>
 #include <cstddef>
 #include <type_traits>
 #include <functional>
+#include "node_pool.h"
 
+// Узлы цепочек выделяются из пула (NodePool): удаленные узлы
+// переиспользуются, а clear() и деструктор возвращают память блоками.
+// Рост и сжатие таблицы идут постепенно: прежний массив корзин остается
+// рядом с новым, каждая вставка и удаление переносят несколько корзин,
+// а поиск до конца переноса смотрит в оба массива. Поэтому ни одна
+// операция не перестраивает всю таблицу целиком.
 template<typename K, typename V>
 class HashMap {
 private:
@@ -21,10 +29,14 @@ private:
     };
     
     std::vector<Node*> buckets;
+    std::vector<Node*> oldBuckets_;  // прежний массив во время переноса
+    size_t migrated_;                // корзины oldBuckets_ до этой уже перенесены
+    NodePool<Node> pool_;
     size_t size_;
     size_t capacity_;
     static constexpr double LOAD_FACTOR = 0.75;
     static constexpr size_t INITIAL_CAPACITY = 16;
+    static constexpr size_t MIGRATE_STEP = 2;  // корзин за одну операцию записи
     
     // Собственная хэш-функция для строк
     size_t hash(const std::string& key) const {
@@ -35,35 +47,110 @@ private:
         return hash_value;
     }
     
-    size_t getBucketIndex(const K& key) const {
+    size_t getBucketIndex(const K& key, size_t capacity) const {
         if constexpr (std::is_same_v<K, std::string>) {
-            return hash(key) % capacity_;
+            return hash(key) % capacity;
         } else {
-            return std::hash<K>{}(key) % capacity_;
+            return std::hash<K>{}(key) % capacity;
+        }
+    }
+    
+    size_t getBucketIndex(const K& key) const {
+        return getBucketIndex(key, capacity_);
+    }
+    
+    bool rehashing() const {
+        return !oldBuckets_.empty();
+    }
+    
+    // Начать перенос в массив новой емкости; узлы пока остаются на месте
+    void resize(size_t new_capacity) {
+        while (rehashing()) {
+            migrateStep();
         }
+        oldBuckets_ = std::move(buckets);
+        buckets.assign(new_capacity, nullptr);
+        capacity_ = new_capacity;
+        migrated_ = 0;
     }
     
-    void resize() {
-        size_t old_capacity = capacity_;
-        capacity_ *= 2;
-        std::vector<Node*> new_buckets(capacity_, nullptr);
+    // Перенести следующие MIGRATE_STEP корзин прежнего массива
+    void migrateStep() {
+        if (!rehashing()) {
+            return;
+        }
         
-        for (size_t i = 0; i < old_capacity; ++i) {
-            Node* current = buckets[i];
+        size_t end = std::min(migrated_ + MIGRATE_STEP, oldBuckets_.size());
+        for (; migrated_ < end; ++migrated_) {
+            Node* current = oldBuckets_[migrated_];
             while (current != nullptr) {
                 Node* next = current->next;
                 size_t new_index = getBucketIndex(current->key);
-                current->next = new_buckets[new_index];
-                new_buckets[new_index] = current;
+                current->next = buckets[new_index];
+                buckets[new_index] = current;
                 current = next;
             }
+            oldBuckets_[migrated_] = nullptr;
+        }
+        
+        if (migrated_ == oldBuckets_.size()) {
+            std::vector<Node*>().swap(oldBuckets_);
+        }
+    }
+    
+    Node* findNode(const K& key) const {
+        for (Node* current = buckets[getBucketIndex(key)]; current != nullptr; current = current->next) {
+            if (current->key == key) {
+                return current;
+            }
+        }
+        if (rehashing()) {
+            size_t index = getBucketIndex(key, oldBuckets_.size());
+            for (Node* current = oldBuckets_[index]; current != nullptr; current = current->next) {
+                if (current->key == key) {
+                    return current;
+                }
+            }
+        }
+        return nullptr;
+    }
+    
+    bool unlink(std::vector<Node*>& table, size_t index, const K& key) {
+        Node* current = table[index];
+        Node* prev = nullptr;
+        
+        while (current != nullptr) {
+            if (current->key == key) {
+                if (prev == nullptr) {
+                    table[index] = current->next;
+                } else {
+                    prev->next = current->next;
+                }
+                pool_.destroy(current);
+                return true;
+            }
+            prev = current;
+            current = current->next;
         }
         
-        buckets = std::move(new_buckets);
+        return false;
+    }
+    
+    // Уничтожить узлы цепочек массива (память вернет pool_.reset())
+    static void destroyChains(std::vector<Node*>& table) {
+        if constexpr (!std::is_trivially_destructible_v<Node>) {
+            for (Node* current : table) {
+                while (current != nullptr) {
+                    Node* next = current->next;
+                    current->~Node();
+                    current = next;
+                }
+            }
+        }
     }
     
 public:
-    HashMap() : size_(0), capacity_(INITIAL_CAPACITY) {
+    HashMap() : migrated_(0), size_(0), capacity_(INITIAL_CAPACITY) {
         buckets.resize(capacity_, nullptr);
     }
     
@@ -71,112 +158,110 @@ public:
         clear();
     }
     
-    HashMap(const HashMap& other) : size_(0), capacity_(other.capacity_) {
+    HashMap(const HashMap& other) : migrated_(0), size_(0), capacity_(other.capacity_) {
         buckets.resize(capacity_, nullptr);
-        for (const auto& pair : other.items()) {
-            put(pair.first, pair.second);
-        }
+        other.forEach([this](const K& key, const V& value) {
+            put(key, value);
+            return true;
+        });
     }
     
     HashMap& operator=(const HashMap& other) {
         if (this != &other) {
             clear();
             capacity_ = other.capacity_;
-            buckets.resize(capacity_, nullptr);
-            for (const auto& pair : other.items()) {
-                put(pair.first, pair.second);
-            }
+            buckets.assign(capacity_, nullptr);
+            other.forEach([this](const K& key, const V& value) {
+                put(key, value);
+                return true;
+            });
         }
         return *this;
     }
     
     void put(const K& key, const V& value) {
-        size_t index = getBucketIndex(key);
-        Node* current = buckets[index];
+        migrateStep();
         
         // Проверяем, существует ли уже ключ
-        while (current != nullptr) {
-            if (current->key == key) {
-                current->value = value;
-                return;
-            }
-            current = current->next;
+        Node* existing = findNode(key);
+        if (existing != nullptr) {
+            existing->value = value;
+            return;
         }
         
         // Добавляем новый узел в начало цепочки
-        Node* new_node = new Node(key, value);
+        size_t index = getBucketIndex(key);
+        Node* new_node = pool_.create(key, value);
         new_node->next = buckets[index];
         buckets[index] = new_node;
         size_++;
         
         // Проверяем необходимость расширения
-        if (static_cast<double>(size_) / capacity_ >= LOAD_FACTOR) {
-            resize();
+        if (!rehashing() && static_cast<double>(size_) / capacity_ >= LOAD_FACTOR) {
+            resize(capacity_ * 2);
         }
     }
     
     bool get(const K& key, V& value) const {
-        size_t index = getBucketIndex(key);
-        Node* current = buckets[index];
-        
-        while (current != nullptr) {
-            if (current->key == key) {
-                value = current->value;
-                return true;
-            }
-            current = current->next;
+        Node* node = findNode(key);
+        if (node == nullptr) {
+            return false;
         }
-        
-        return false;
+        value = node->value;
+        return true;
+    }
+    
+    // Значение по ключу без копирования или nullptr
+    const V* find(const K& key) const {
+        Node* node = findNode(key);
+        return node == nullptr ? nullptr : &node->value;
     }
     
     bool contains(const K& key) const {
-        size_t index = getBucketIndex(key);
-        Node* current = buckets[index];
-        
-        while (current != nullptr) {
-            if (current->key == key) {
-                return true;
-            }
-            current = current->next;
-        }
-        
-        return false;
+        return findNode(key) != nullptr;
     }
     
     bool remove(const K& key) {
-        size_t index = getBucketIndex(key);
-        Node* current = buckets[index];
-        Node* prev = nullptr;
+        migrateStep();
         
-        while (current != nullptr) {
-            if (current->key == key) {
-                if (prev == nullptr) {
-                    buckets[index] = current->next;
-                } else {
-                    prev->next = current->next;
-                }
-                delete current;
-                size_--;
-                return true;
-            }
-            prev = current;
-            current = current->next;
+        bool removed = unlink(buckets, getBucketIndex(key), key) ||
+                       (rehashing() && unlink(oldBuckets_, getBucketIndex(key, oldBuckets_.size()), key));
+        if (!removed) {
+            return false;
         }
+        size_--;
         
-        return false;
+        // После массового удаления таблица сжимается тем же переносом
+        if (!rehashing() && capacity_ > INITIAL_CAPACITY &&
+            static_cast<double>(size_) / capacity_ < LOAD_FACTOR / 4) {
+            resize(capacity_ / 2);
+        }
+        return true;
     }
     
     std::vector<std::pair<K, V>> items() const {
         std::vector<std::pair<K, V>> result;
-        for (size_t i = 0; i < capacity_; ++i) {
-            Node* current = buckets[i];
-            while (current != nullptr) {
-                result.push_back({current->key, current->value});
-                current = current->next;
+        result.reserve(size_);
+        forEach([&result](const K& key, const V& value) {
+            result.push_back({key, value});
+            return true;
+        });
+        return result;
+    }
+    
+    // Обход всех элементов без копирования; обход прекращается,
+    // если функция вернула false
+    template<typename Func>
+    void forEach(Func func) const {
+        for (const auto* table : {&buckets, &oldBuckets_}) {
+            for (Node* head : *table) {
+                for (Node* current = head; current != nullptr; current = current->next) {
+                    if (!func(current->key, current->value)) {
+                        return;
+                    }
+                }
             }
         }
-        return result;
     }
     
     size_t size() const {
@@ -188,15 +273,13 @@ public:
     }
     
     void clear() {
-        for (size_t i = 0; i < capacity_; ++i) {
-            Node* current = buckets[i];
-            while (current != nullptr) {
-                Node* next = current->next;
-                delete current;
-                current = next;
-            }
-            buckets[i] = nullptr;
-        }
+        // Узлы с тривиальными ключом и значением не нужно обходить:
+        // память пула освобождается целиком
+        destroyChains(buckets);
+        destroyChains(oldBuckets_);
+        pool_.reset();
+        std::fill(buckets.begin(), buckets.end(), nullptr);
+        std::vector<Node*>().swap(oldBuckets_);
         size_ = 0;
     }
 };
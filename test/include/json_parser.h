@@ -1,17 +1,30 @@
 #ifndef JSON_PARSER_H
 #define JSON_PARSER_H
 
+#include "flat_map.h"
 #include <string>
-#include <map>
 #include <vector>
 #include <variant>
-#include <sstream>
 #include <stdexcept>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+#include <string_view>
+#include <charconv>
+#include <utility>
+#include <iterator>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 class JsonValue {
 public:
+    // Поля объекта лежат одним массивом, упорядоченным по ключу (FlatMap):
+    // у документа из десятка полей это одно выделение памяти вместо узла
+    // дерева на каждое поле, а поиск поля не ходит по указателям
+    using Object = FlatMap<std::string, JsonValue>;
     using Value = std::variant<std::nullptr_t, bool, int, double, std::string, 
-                               std::vector<JsonValue>, std::map<std::string, JsonValue>>;
+                               std::vector<JsonValue>, Object>;
     
 private:
     Value value_;
@@ -23,8 +36,12 @@ public:
     JsonValue(int i) : value_(i) {}
     JsonValue(double d) : value_(d) {}
     JsonValue(const std::string& s) : value_(s) {}
+    JsonValue(std::string&& s) : value_(std::move(s)) {}
+    JsonValue(const char* s) : value_(std::string(s)) {}
     JsonValue(const std::vector<JsonValue>& arr) : value_(arr) {}
-    JsonValue(const std::map<std::string, JsonValue>& obj) : value_(obj) {}
+    JsonValue(std::vector<JsonValue>&& arr) : value_(std::move(arr)) {}
+    JsonValue(const Object& obj) : value_(obj) {}
+    JsonValue(Object&& obj) : value_(std::move(obj)) {}
     
     bool isNull() const { return std::holds_alternative<std::nullptr_t>(value_); }
     bool isBool() const { return std::holds_alternative<bool>(value_); }
@@ -32,7 +49,7 @@ public:
     bool isDouble() const { return std::holds_alternative<double>(value_); }
     bool isString() const { return std::holds_alternative<std::string>(value_); }
     bool isArray() const { return std::holds_alternative<std::vector<JsonValue>>(value_); }
-    bool isObject() const { return std::holds_alternative<std::map<std::string, JsonValue>>(value_); }
+    bool isObject() const { return std::holds_alternative<Object>(value_); }
     
     bool asBool() const { 
         if (!isBool()) {
@@ -50,23 +67,44 @@ public:
         if (std::holds_alternative<int>(value_)) return static_cast<double>(std::get<int>(value_));
         throw std::runtime_error("Value is not a number");
     }
-    std::string asString() const { 
+    // Строка, массив и объект возвращаются ссылкой на хранимое значение
+    // (без копирования); у временного JsonValue значение забирается
+    // перемещением, чтобы ссылка не пережила его.
+    const std::string& asString() const & { 
         if (!isString()) {
             throw std::runtime_error("Value is not a string");
         }
         return std::get<std::string>(value_); 
     }
-    std::vector<JsonValue> asArray() const { 
+    std::string asString() && {
+        if (!isString()) {
+            throw std::runtime_error("Value is not a string");
+        }
+        return std::move(std::get<std::string>(value_));
+    }
+    const std::vector<JsonValue>& asArray() const & { 
         if (!isArray()) {
             throw std::runtime_error("Value is not an array");
         }
         return std::get<std::vector<JsonValue>>(value_); 
     }
-    std::map<std::string, JsonValue> asObject() const { 
+    std::vector<JsonValue> asArray() && {
+        if (!isArray()) {
+            throw std::runtime_error("Value is not an array");
+        }
+        return std::move(std::get<std::vector<JsonValue>>(value_));
+    }
+    const Object& asObject() const & { 
         if (!isObject()) {
             throw std::runtime_error("Value is not an object");
         }
-        return std::get<std::map<std::string, JsonValue>>(value_); 
+        return std::get<Object>(value_); 
+    }
+    Object asObject() && {
+        if (!isObject()) {
+            throw std::runtime_error("Value is not an object");
+        }
+        return std::move(std::get<Object>(value_));
     }
     
     const Value& getValue() const { return value_; }
@@ -74,87 +112,252 @@ public:
     
     JsonValue& operator[](const std::string& key) {
         if (!isObject()) {
-            value_ = std::map<std::string, JsonValue>();
+            value_ = Object();
         }
-        return std::get<std::map<std::string, JsonValue>>(value_)[key];
+        return std::get<Object>(value_)[key];
     }
     
     const JsonValue& operator[](const std::string& key) const {
-        return std::get<std::map<std::string, JsonValue>>(value_).at(key);
+        return std::get<Object>(value_).at(key);
     }
     
     bool hasKey(const std::string& key) const {
         if (!isObject()) return false;
-        return std::get<std::map<std::string, JsonValue>>(value_).count(key) > 0;
+        return std::get<Object>(value_).count(key) > 0;
+    }
+    
+    // Поле объекта или nullptr - один поиск вместо hasKey и operator[]
+    const JsonValue* find(const std::string& key) const {
+        if (!isObject()) return nullptr;
+        const auto& obj = std::get<Object>(value_);
+        auto it = obj.find(key);
+        return it == obj.end() ? nullptr : &it->second;
     }
     
+    // Запись в конец out: все вложенные значения пишутся в один буфер,
+    // который вызывающий может переиспользовать между сообщениями
+    void appendTo(std::string& out) const;
     std::string toString() const;
 };
 
+// Разбор JSON прямо по буферу вызывающего (std::string_view, без копии
+// входа). Концы строк, экранирования и пропуски ищутся блоками по 16 байт:
+// с SSE2 блок сравнивается за несколько инструкций, без него - в цикле.
+// Буфер должен оставаться живым только на время вызова parse.
 class JsonParser {
 private:
-    std::string input_;
+    static constexpr size_t BLOCK = 16;
+
+    std::string_view input_;
     size_t pos_;
+    // Общие стеки полей и элементов для всех уровней вложенности: объект
+    // или массив собирается на стеке и затем переносится в контейнер
+    // точного размера одним выделением памяти
+    std::vector<JsonValue::Object::value_type> fieldStack_;
+    std::vector<JsonValue> itemStack_;
     
-    void skipWhitespace() {
-        while (pos_ < input_.length() && std::isspace(input_[pos_])) {
-            pos_++;
+    // Маска байтов блока (бит на байт), равных кавычке или обратной косой
+    static uint32_t stringStops(const char* p) {
+#if defined(__SSE2__)
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i stops = _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('"')),
+                                     _mm_cmpeq_epi8(block, _mm_set1_epi8('\\')));
+        return static_cast<uint32_t>(_mm_movemask_epi8(stops));
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < BLOCK; ++i) {
+            if (p[i] == '"' || p[i] == '\\') mask |= 1u << i;
         }
+        return mask;
+#endif
     }
     
-    std::string parseString() {
-        if (input_[pos_] != '"') {
-            throw std::runtime_error("Expected string");
+    // Маска байтов блока, не являющихся пробельными символами JSON
+    static uint32_t nonWhitespace(const char* p) {
+#if defined(__SSE2__)
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i space = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\n'))),
+            _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('\t')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\r'))));
+        return ~static_cast<uint32_t>(_mm_movemask_epi8(space)) & 0xFFFFu;
+#else
+        uint32_t mask = 0;
+        for (size_t i = 0; i < BLOCK; ++i) {
+            if (!isWhitespace(p[i])) mask |= 1u << i;
+        }
+        return mask;
+#endif
+    }
+    
+    static bool isWhitespace(char c) {
+        return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+    }
+    
+    // Позиция первой кавычки или обратной косой начиная с pos
+    size_t findStringStop(size_t pos) const {
+        const char* data = input_.data();
+        size_t size = input_.size();
+        for (; pos + BLOCK <= size; pos += BLOCK) {
+            if (uint32_t mask = stringStops(data + pos)) {
+                return pos + static_cast<size_t>(__builtin_ctz(mask));
+            }
         }
+        while (pos < size && data[pos] != '"' && data[pos] != '\\') pos++;
+        return pos;
+    }
+    
+    void skipWhitespace() {
+        // Обычно между лексемами нет пробелов или один - блок не нужен
+        if (pos_ >= input_.size() || !isWhitespace(input_[pos_])) return;
         pos_++;
-        std::string result;
-        while (pos_ < input_.length() && input_[pos_] != '"') {
-            if (input_[pos_] == '\\') {
-                pos_++;
-                if (pos_ >= input_.length()) break;
-                switch (input_[pos_]) {
-                    case 'n': result += '\n'; break;
-                    case 't': result += '\t'; break;
-                    case 'r': result += '\r'; break;
-                    case '\\': result += '\\'; break;
-                    case '"': result += '"'; break;
-                    default: result += input_[pos_]; break;
+        const char* data = input_.data();
+        size_t size = input_.size();
+        for (; pos_ + BLOCK <= size; pos_ += BLOCK) {
+            if (uint32_t mask = nonWhitespace(data + pos_)) {
+                pos_ += static_cast<size_t>(__builtin_ctz(mask));
+                return;
+            }
+        }
+        while (pos_ < size && isWhitespace(data[pos_])) pos_++;
+    }
+    
+    char peek() const {
+        return pos_ < input_.size() ? input_[pos_] : '\0';
+    }
+    
+    static void appendUtf8(std::string& out, uint32_t code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+    
+    uint32_t parseHex4() {
+        if (pos_ + 4 > input_.size()) {
+            throw std::runtime_error("Invalid unicode escape");
+        }
+        uint32_t code = 0;
+        auto [end, ec] = std::from_chars(input_.data() + pos_, input_.data() + pos_ + 4, code, 16);
+        if (ec != std::errc() || end != input_.data() + pos_ + 4) {
+            throw std::runtime_error("Invalid unicode escape");
+        }
+        pos_ += 4;
+        return code;
+    }
+    
+    // Экранирование после обратной косой (pos_ указывает на символ за ней)
+    void parseEscape(std::string& result) {
+        if (pos_ >= input_.size()) {
+            throw std::runtime_error("Unterminated string");
+        }
+        char c = input_[pos_++];
+        switch (c) {
+            case 'n': result += '\n'; break;
+            case 't': result += '\t'; break;
+            case 'r': result += '\r'; break;
+            case 'b': result += '\b'; break;
+            case 'f': result += '\f'; break;
+            case 'u': {
+                uint32_t code = parseHex4();
+                // Символ вне BMP записывается суррогатной парой
+                if (code >= 0xD800 && code < 0xDC00 && input_.compare(pos_, 2, "\\u") == 0) {
+                    size_t save = pos_;
+                    pos_ += 2;
+                    uint32_t low = parseHex4();
+                    if (low >= 0xDC00 && low < 0xE000) {
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    } else {
+                        pos_ = save;
+                    }
                 }
-            } else {
-                result += input_[pos_];
+                appendUtf8(result, code);
+                break;
             }
-            pos_++;
+            default: result += c; break;
+        }
+    }
+    
+    std::string parseString() {
+        if (peek() != '"') {
+            throw std::runtime_error("Expected string");
         }
-        if (pos_ >= input_.length() || input_[pos_] != '"') {
+        pos_++;
+        size_t stop = findStringStop(pos_);
+        if (stop >= input_.size()) {
             throw std::runtime_error("Unterminated string");
         }
+        // Строка без экранирований - один кусок входа
+        std::string result(input_.data() + pos_, stop - pos_);
+        pos_ = stop;
+        while (input_[pos_] == '\\') {
+            pos_++;
+            parseEscape(result);
+            stop = findStringStop(pos_);
+            if (stop >= input_.size()) {
+                throw std::runtime_error("Unterminated string");
+            }
+            result.append(input_.data() + pos_, stop - pos_);
+            pos_ = stop;
+        }
         pos_++;
         return result;
     }
     
     JsonValue parseNumber() {
-        size_t start = pos_;
+        const char* begin = input_.data() + pos_;
+        const char* end = input_.data() + input_.size();
+        const char* p = begin;
         bool isFloat = false;
         
-        if (input_[pos_] == '-') pos_++;
-        while (pos_ < input_.length() && std::isdigit(input_[pos_])) pos_++;
-        if (pos_ < input_.length() && input_[pos_] == '.') {
+        if (p < end && *p == '-') p++;
+        while (p < end && *p >= '0' && *p <= '9') p++;
+        if (p < end && *p == '.') {
             isFloat = true;
-            pos_++;
-            while (pos_ < input_.length() && std::isdigit(input_[pos_])) pos_++;
+            p++;
+            while (p < end && *p >= '0' && *p <= '9') p++;
+        }
+        if (p < end && (*p == 'e' || *p == 'E')) {
+            isFloat = true;
+            p++;
+            if (p < end && (*p == '+' || *p == '-')) p++;
+            while (p < end && *p >= '0' && *p <= '9') p++;
         }
         
-        std::string numStr = input_.substr(start, pos_ - start);
-        if (isFloat) {
-            return JsonValue(std::stod(numStr));
-        } else {
-            return JsonValue(std::stoi(numStr));
+        if (!isFloat) {
+            int value = 0;
+            auto [last, ec] = std::from_chars(begin, p, value);
+            if (ec == std::errc() && last == p) {
+                pos_ += static_cast<size_t>(p - begin);
+                return JsonValue(value);
+            }
+            if (ec != std::errc::result_out_of_range) {
+                throw std::runtime_error("Invalid number");
+            }
+            // Целое вне диапазона int хранится как double
         }
+        double value = 0;
+        auto [last, ec] = std::from_chars(begin, p, value);
+        if (ec != std::errc() || last != p) {
+            throw std::runtime_error("Invalid number");
+        }
+        pos_ += static_cast<size_t>(p - begin);
+        return JsonValue(value);
     }
     
     JsonValue parseValue() {
         skipWhitespace();
-        if (pos_ >= input_.length()) {
+        if (pos_ >= input_.size()) {
             throw std::runtime_error("Unexpected end of input");
         }
         
@@ -165,15 +368,15 @@ private:
             return parseArray();
         } else if (c == '"') {
             return JsonValue(parseString());
-        } else if (c == '-' || std::isdigit(c)) {
+        } else if (c == '-' || (c >= '0' && c <= '9')) {
             return parseNumber();
-        } else if (input_.substr(pos_, 4) == "true") {
+        } else if (input_.compare(pos_, 4, "true") == 0) {
             pos_ += 4;
             return JsonValue(true);
-        } else if (input_.substr(pos_, 5) == "false") {
+        } else if (input_.compare(pos_, 5, "false") == 0) {
             pos_ += 5;
             return JsonValue(false);
-        } else if (input_.substr(pos_, 4) == "null") {
+        } else if (input_.compare(pos_, 4, "null") == 0) {
             pos_ += 4;
             return JsonValue(nullptr);
         } else {
@@ -182,134 +385,205 @@ private:
     }
     
     JsonValue parseObject() {
-        if (input_[pos_] != '{') {
+        if (peek() != '{') {
             throw std::runtime_error("Expected object");
         }
         pos_++;
         skipWhitespace();
         
-        std::map<std::string, JsonValue> obj;
+        // Поля упорядочиваются один раз в assign(): ключи снимка коллекции
+        // идут вразнобой, и вставка по одному сдвигала бы массив объекта
+        // на каждом поле
+        size_t first = fieldStack_.size();
         
-        if (input_[pos_] == '}') {
+        if (peek() == '}') {
             pos_++;
-            return JsonValue(obj);
+            return JsonValue(JsonValue::Object());
         }
         
         while (true) {
             skipWhitespace();
             std::string key = parseString();
             skipWhitespace();
-            if (input_[pos_] != ':') {
+            if (peek() != ':') {
                 throw std::runtime_error("Expected colon");
             }
             pos_++;
             JsonValue value = parseValue();
-            obj[key] = value;
+            fieldStack_.emplace_back(std::move(key), std::move(value));
             
             skipWhitespace();
-            if (input_[pos_] == '}') {
+            if (peek() == '}') {
                 pos_++;
                 break;
-            } else if (input_[pos_] == ',') {
+            } else if (peek() == ',') {
                 pos_++;
             } else {
                 throw std::runtime_error("Expected comma or closing brace");
             }
         }
         
-        return JsonValue(obj);
+        std::vector<JsonValue::Object::value_type> fields(
+            std::make_move_iterator(fieldStack_.begin() + static_cast<std::ptrdiff_t>(first)),
+            std::make_move_iterator(fieldStack_.end()));
+        fieldStack_.erase(fieldStack_.begin() + static_cast<std::ptrdiff_t>(first), fieldStack_.end());
+        
+        // При повторе ключа побеждает последний
+        JsonValue::Object obj;
+        obj.assign(std::move(fields));
+        return JsonValue(std::move(obj));
     }
     
     JsonValue parseArray() {
-        if (input_[pos_] != '[') {
+        if (peek() != '[') {
             throw std::runtime_error("Expected array");
         }
         pos_++;
         skipWhitespace();
         
-        std::vector<JsonValue> arr;
-        
-        if (input_[pos_] == ']') {
+        if (peek() == ']') {
             pos_++;
-            return JsonValue(arr);
+            return JsonValue(std::vector<JsonValue>());
         }
         
+        size_t first = itemStack_.size();
+        
         while (true) {
-            arr.push_back(parseValue());
+            JsonValue item = parseValue();
+            itemStack_.push_back(std::move(item));
             skipWhitespace();
-            if (input_[pos_] == ']') {
+            if (peek() == ']') {
                 pos_++;
                 break;
-            } else if (input_[pos_] == ',') {
+            } else if (peek() == ',') {
                 pos_++;
             } else {
                 throw std::runtime_error("Expected comma or closing bracket");
             }
         }
         
-        return JsonValue(arr);
+        std::vector<JsonValue> arr(std::make_move_iterator(itemStack_.begin() + static_cast<std::ptrdiff_t>(first)),
+                                   std::make_move_iterator(itemStack_.end()));
+        itemStack_.erase(itemStack_.begin() + static_cast<std::ptrdiff_t>(first), itemStack_.end());
+        return JsonValue(std::move(arr));
     }
     
 public:
-    JsonValue parse(const std::string& json) {
+    JsonValue parse(std::string_view json) {
         input_ = json;
         pos_ = 0;
+        fieldStack_.clear();
+        itemStack_.clear();
         skipWhitespace();
         JsonValue result = parseValue();
         skipWhitespace();
-        if (pos_ < input_.length()) {
+        if (pos_ < input_.size()) {
             throw std::runtime_error("Unexpected characters after JSON");
         }
+        input_ = std::string_view();
         return result;
     }
+    
+    // Разбор буфера вызывающего без копирования
+    JsonValue parse(const char* data, size_t size) {
+        return parse(std::string_view(data, size));
+    }
 };
 
-std::string JsonValue::toString() const {
-    if (isNull()) return "null";
-    if (isBool()) return asBool() ? "true" : "false";
-    if (isInt()) return std::to_string(asInt());
-    if (isDouble()) {
-        std::ostringstream oss;
-        oss << asDouble();
-        return oss.str();
-    }
-    if (isString()) {
-        std::string s = asString();
-        std::string result = "\"";
-        for (char c : s) {
-            if (c == '"') result += "\\\"";
-            else if (c == '\\') result += "\\\\";
-            else if (c == '\n') result += "\\n";
-            else if (c == '\t') result += "\\t";
-            else if (c == '\r') result += "\\r";
-            else result += c;
-        }
-        result += "\"";
-        return result;
+namespace JsonFormat {
+
+// Замена байтов при записи строки: 0 - байт пишется как есть, иначе
+// символ после обратной косой ('u' - управляющий символ в виде \u00XX)
+struct EscapeTable {
+    char code[256];
+
+    constexpr EscapeTable() : code() {
+        for (int c = 0; c < 0x20; ++c) code[c] = 'u';
+        code[static_cast<unsigned char>('\b')] = 'b';
+        code[static_cast<unsigned char>('\f')] = 'f';
+        code[static_cast<unsigned char>('\n')] = 'n';
+        code[static_cast<unsigned char>('\r')] = 'r';
+        code[static_cast<unsigned char>('\t')] = 't';
+        code[static_cast<unsigned char>('"')] = '"';
+        code[static_cast<unsigned char>('\\')] = '\\';
     }
-    if (isArray()) {
-        std::string result = "[";
-        auto arr = asArray();
-        for (size_t i = 0; i < arr.size(); ++i) {
-            if (i > 0) result += ", ";
-            result += arr[i].toString();
+};
+
+inline constexpr EscapeTable ESCAPES{};
+
+// Строка в кавычках; участки без экранирования дописываются целиком
+inline void appendString(std::string& out, std::string_view s) {
+    static constexpr char HEX[] = "0123456789abcdef";
+    out += '"';
+    size_t run = 0;
+    for (size_t i = 0; i < s.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(s[i]);
+        char code = ESCAPES.code[c];
+        if (code == 0) continue;
+        out.append(s.data() + run, i - run);
+        out += '\\';
+        out += code;
+        if (code == 'u') {
+            out += "00";
+            out += HEX[c >> 4];
+            out += HEX[c & 0xF];
         }
-        result += "]";
-        return result;
+        run = i + 1;
     }
-    if (isObject()) {
-        std::string result = "{";
-        auto obj = asObject();
+    out.append(s.data() + run, s.size() - run);
+    out += '"';
+}
+
+}  // namespace JsonFormat
+
+inline void JsonValue::appendTo(std::string& out) const {
+    if (const double* d = std::get_if<double>(&value_)) {
+        // В JSON нет nan и inf: такое значение (например, результат
+        // деления в агрегации) записывается как null, иначе снимок
+        // коллекции потом не прочитать
+        if (!std::isfinite(*d)) {
+            out += "null";
+            return;
+        }
+        // Кратчайшая запись, по которой число восстанавливается точно
+        char buffer[32];
+        auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), *d);
+        out.append(buffer, end);
+    } else if (const int* i = std::get_if<int>(&value_)) {
+        char buffer[16];
+        auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), *i);
+        out.append(buffer, end);
+    } else if (const std::string* str = std::get_if<std::string>(&value_)) {
+        JsonFormat::appendString(out, *str);
+    } else if (const auto* arr = std::get_if<std::vector<JsonValue>>(&value_)) {
+        out += '[';
+        for (size_t i = 0; i < arr->size(); ++i) {
+            if (i > 0) out += ", ";
+            (*arr)[i].appendTo(out);
+        }
+        out += ']';
+    } else if (const auto* obj = std::get_if<Object>(&value_)) {
+        out += '{';
         bool first = true;
-        for (const auto& [key, value] : obj) {
-            if (!first) result += ", ";
+        for (const auto& [key, value] : *obj) {
+            if (!first) out += ", ";
             first = false;
-            result += "\"" + key + "\": " + value.toString();
+            JsonFormat::appendString(out, key);
+            out += ": ";
+            value.appendTo(out);
         }
-        result += "}";
-        return result;
+        out += '}';
+    } else if (const bool* b = std::get_if<bool>(&value_)) {
+        out += *b ? "true" : "false";
+    } else {
+        out += "null";
     }
-    return "null";
+}
+
+inline std::string JsonValue::toString() const {
+    std::string out;
+    appendTo(out);
+    return out;
 }
 
 #endif // JSON_PARSER_H
@@ -0,0 +1,117 @@
+#ifndef LIKE_PATTERN_H
+#define LIKE_PATTERN_H
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+
+// Шаблон $like, разобранный один раз: '%' - любая последовательность
+// символов, '_' - один любой символ, регистр ASCII не учитывается.
+// Шаблон режется по '%' на куски: первый кусок сравнивается с началом
+// строки, последний - с концом, средние ищутся по порядку слева направо
+// (самое левое вхождение каждого куска не мешает найти следующие).
+class LikePattern {
+private:
+    std::vector<std::string> pieces_;  // куски между '%' в нижнем регистре
+    size_t minLength_ = 0;             // суммарная длина кусков
+
+    static char lower(char c) {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    static bool matchAt(const std::string& text, size_t pos, const std::string& piece) {
+        for (size_t i = 0; i < piece.size(); ++i) {
+            if (piece[i] != '_' && piece[i] != lower(text[pos + i])) return false;
+        }
+        return true;
+    }
+
+    // Первое вхождение куска, целиком лежащее в [from, to); npos - нет
+    static size_t find(const std::string& text, size_t from, size_t to, const std::string& piece) {
+        if (piece.size() > to - from) return std::string::npos;
+        for (size_t pos = from; pos + piece.size() <= to; ++pos) {
+            if (matchAt(text, pos, piece)) return pos;
+        }
+        return std::string::npos;
+    }
+
+public:
+    explicit LikePattern(const std::string& pattern) {
+        pieces_.emplace_back();
+        for (char c : pattern) {
+            if (c == '%') {
+                pieces_.emplace_back();
+            } else {
+                pieces_.back().push_back(lower(c));
+                minLength_++;
+            }
+        }
+    }
+
+    bool matches(const std::string& text) const {
+        if (text.size() < minLength_) return false;
+
+        const std::string& first = pieces_.front();
+        if (pieces_.size() == 1) {
+            return text.size() == first.size() && matchAt(text, 0, first);
+        }
+
+        const std::string& last = pieces_.back();
+        if (!matchAt(text, 0, first) || !matchAt(text, text.size() - last.size(), last)) {
+            return false;
+        }
+
+        size_t pos = first.size();
+        size_t end = text.size() - last.size();
+        for (size_t i = 1; i + 1 < pieces_.size(); ++i) {
+            if (pieces_[i].empty()) continue;
+            size_t found = find(text, pos, end, pieces_[i]);
+            if (found == std::string::npos) return false;
+            pos = found + pieces_[i].size();
+        }
+        return true;
+    }
+};
+
+// Разобранные шаблоны последних запросов: ограниченный LRU на поток
+// сервера, поэтому обход коллекции разбирает шаблон один раз, а
+// блокировки не нужны. Последний использованный шаблон проверяется
+// первым без хеширования - обычно это шаблон текущего запроса.
+class LikePatternCache {
+private:
+    static constexpr size_t CAPACITY = 64;
+
+    using Entries = std::list<std::pair<std::string, LikePattern>>;
+    Entries entries_;  // в начале - последний использованный
+    std::unordered_map<std::string, Entries::iterator> index_;
+
+public:
+    // Ссылка действительна до следующего вызова get в этом потоке
+    const LikePattern& get(const std::string& pattern) {
+        if (!entries_.empty() && entries_.front().first == pattern) {
+            return entries_.front().second;
+        }
+
+        auto found = index_.find(pattern);
+        if (found != index_.end()) {
+            entries_.splice(entries_.begin(), entries_, found->second);
+            return entries_.front().second;
+        }
+
+        entries_.emplace_front(pattern, LikePattern(pattern));
+        index_[pattern] = entries_.begin();
+        if (entries_.size() > CAPACITY) {
+            index_.erase(entries_.back().first);
+            entries_.pop_back();
+        }
+        return entries_.front().second;
+    }
+
+    static LikePatternCache& local() {
+        thread_local LikePatternCache cache;
+        return cache;
+    }
+};
+
+#endif // LIKE_PATTERN_H
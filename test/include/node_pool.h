@@ -0,0 +1,77 @@
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+
+#include <vector>
+#include <memory>
+#include <new>
+#include <utility>
+#include <cstddef>
+
+// Пул узлов одного типа: память берется блоками по SLAB_SIZE узлов,
+// освобожденные узлы складываются в список свободных и выдаются снова.
+// Узлы не разбросаны по куче, а reset() возвращает всю память разом,
+// не обходя узлы по одному.
+template<typename T, size_t SLAB_SIZE = 256>
+class NodePool {
+private:
+    // Свободный узел хранит ссылку на следующий свободный на месте данных
+    union Cell {
+        Cell* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    std::vector<std::unique_ptr<Cell[]>> slabs_;
+    Cell* free_ = nullptr;
+    size_t used_ = SLAB_SIZE;  // занятые ячейки последнего блока
+
+    Cell* take() {
+        if (free_ != nullptr) {
+            Cell* cell = free_;
+            free_ = cell->next;
+            return cell;
+        }
+        if (used_ == SLAB_SIZE) {
+            slabs_.emplace_back(new Cell[SLAB_SIZE]);
+            used_ = 0;
+        }
+        return &slabs_.back()[used_++];
+    }
+
+public:
+    NodePool() = default;
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    template<typename... Args>
+    T* create(Args&&... args) {
+        Cell* cell = take();
+        try {
+            return new (cell->storage) T(std::forward<Args>(args)...);
+        } catch (...) {
+            cell->next = free_;
+            free_ = cell;
+            throw;
+        }
+    }
+
+    void destroy(T* node) {
+        node->~T();
+        Cell* cell = reinterpret_cast<Cell*>(node);
+        cell->next = free_;
+        free_ = cell;
+    }
+
+    // Забыть все узлы и вернуть память. Деструкторы узлов не вызываются:
+    // для нетривиальных типов их вызывает владелец до reset().
+    void reset() {
+        slabs_.clear();
+        free_ = nullptr;
+        used_ = SLAB_SIZE;
+    }
+
+    size_t slabCount() const {
+        return slabs_.size();
+    }
+};
+
+#endif // NODE_POOL_H
@@ -2,32 +2,16 @@
 #define QUERY_EVALUATOR_H
 
 #include "json_parser.h"
-#include <regex>
+#include "text_index.h"
+#include "like_pattern.h"
 #include <algorithm>
 #include <cmath>
 
 class QueryEvaluator {
 private:
+    // Шаблон разбирается один раз и берется из кэша потока
     static bool matchesPattern(const std::string& text, const std::string& pattern) {
-        // Преобразуем SQL-like pattern в regex
-        std::string regexPattern;
-        for (char c : pattern) {
-            if (c == '%') {
-                regexPattern += ".*";
-            } else if (c == '_') {
-                regexPattern += ".";
-            } else if (c == '.' || c == '^' || c == '$' || c == '*' || c == '+' || 
-                       c == '?' || c == '(' || c == ')' || c == '[' || c == ']' || 
-                       c == '{' || c == '}' || c == '|' || c == '\\') {
-                regexPattern += "\\";
-                regexPattern += c;
-            } else {
-                regexPattern += c;
-            }
-        }
-        
-        std::regex regex(regexPattern, std::regex_constants::icase);
-        return std::regex_match(text, regex);
+        return LikePatternCache::local().get(pattern).matches(text);
     }
     
     static bool evaluateOperator(const JsonValue& docValue, const std::string& op, const JsonValue& queryValue) {
@@ -40,20 +24,20 @@ private:
                 return std::abs(docValue.asDouble() - queryValue.asDouble()) < 1e-9;
             }
             return false;
-        } else if (op == "$gt") {
-            if (docValue.isInt() && queryValue.isInt()) {
-                return docValue.asInt() > queryValue.asInt();
-            } else if (docValue.isDouble() || queryValue.isDouble()) {
-                return docValue.asDouble() > queryValue.asDouble();
-            }
-            return false;
-        } else if (op == "$lt") {
-            if (docValue.isInt() && queryValue.isInt()) {
-                return docValue.asInt() < queryValue.asInt();
-            } else if (docValue.isDouble() || queryValue.isDouble()) {
-                return docValue.asDouble() < queryValue.asDouble();
+        } else if (op == "$gt" || op == "$gte" || op == "$lt" || op == "$lte") {
+            int order;
+            if (docValue.isString() && queryValue.isString()) {
+                int cmp = docValue.asString().compare(queryValue.asString());
+                order = (cmp > 0) - (cmp < 0);
+            } else if (docValue.isInt() && queryValue.isInt()) {
+                order = (docValue.asDouble() > queryValue.asDouble()) - (docValue.asDouble() < queryValue.asDouble());
+            } else {
+                return false;
             }
-            return false;
+            if (op == "$gt") return order > 0;
+            if (op == "$gte") return order >= 0;
+            if (op == "$lt") return order < 0;
+            return order <= 0;
         } else if (op == "$like") {
             if (docValue.isString() && queryValue.isString()) {
                 return matchesPattern(docValue.asString(), queryValue.asString());
@@ -61,8 +45,7 @@ private:
             return false;
         } else if (op == "$in") {
             if (!queryValue.isArray()) return false;
-            auto arr = queryValue.asArray();
-            for (const auto& item : arr) {
+            for (const auto& item : queryValue.asArray()) {
                 if (evaluateOperator(docValue, "$eq", item)) {
                     return true;
                 }
@@ -73,28 +56,30 @@ private:
     }
     
     static bool evaluateCondition(const JsonValue& doc, const std::string& field, const JsonValue& condition) {
-        if (!doc.hasKey(field)) {
+        const JsonValue* docValue = doc.find(field);
+        if (docValue == nullptr) {
             return false;
         }
         
-        JsonValue docValue = doc[field];
-        
         // Если condition - это объект с операторами
         if (condition.isObject()) {
-            auto condObj = condition.asObject();
-            
-            // Проверяем операторы сравнения
-            for (const auto& [op, value] : condObj) {
-                if (op == "$eq" || op == "$gt" || op == "$lt" || op == "$like" || op == "$in") {
-                    return evaluateOperator(docValue, op, value);
+            // Должны выполняться все операторы: {"$gte": a, "$lt": b} - интервал
+            bool hasOperator = false;
+            for (const auto& [op, value] : condition.asObject()) {
+                if (op == "$eq" || op == "$gt" || op == "$gte" || op == "$lt" || op == "$lte" ||
+                    op == "$like" || op == "$in") {
+                    hasOperator = true;
+                    if (!evaluateOperator(*docValue, op, value)) {
+                        return false;
+                    }
                 }
             }
             
-            // Если нет операторов, проверяем как обычное равенство
-            return false;
+            // Если нет операторов, условие не выполняется
+            return hasOperator;
         } else {
             // Простое равенство
-            return evaluateOperator(docValue, "$eq", condition);
+            return evaluateOperator(*docValue, "$eq", condition);
         }
     }
     
@@ -103,14 +88,14 @@ private:
             return false;
         }
         
-        auto queryObj = query.asObject();
+        const auto& queryObj = query.asObject();
         
         // Проверяем логические операторы
-        if (queryObj.count("$or") > 0) {
-            JsonValue orCondition = queryObj.at("$or");
+        auto orIt = queryObj.find("$or");
+        if (orIt != queryObj.end()) {
+            const JsonValue& orCondition = orIt->second;
             if (orCondition.isArray()) {
-                auto orArr = orCondition.asArray();
-                for (const auto& condition : orArr) {
+                for (const auto& condition : orCondition.asArray()) {
                     if (evaluateQuery(doc, condition)) {
                         return true;
                     }
@@ -119,11 +104,11 @@ private:
             }
         }
         
-        if (queryObj.count("$and") > 0) {
-            JsonValue andCondition = queryObj.at("$and");
+        auto andIt = queryObj.find("$and");
+        if (andIt != queryObj.end()) {
+            const JsonValue& andCondition = andIt->second;
             if (andCondition.isArray()) {
-                auto andArr = andCondition.asArray();
-                for (const auto& condition : andArr) {
+                for (const auto& condition : andCondition.asArray()) {
                     if (!evaluateQuery(doc, condition)) {
                         return false;
                     }
@@ -140,6 +125,17 @@ private:
                 continue;
             }
             
+            // Полнотекстовое условие без индекса - по всем строковым полям
+            if (field == "$text") {
+                std::string search;
+                if (!TextSearch::searchString(condition, search) ||
+                    !TextSearch::matches(doc, TextSearch::parseQuery(search))) {
+                    allMatch = false;
+                    break;
+                }
+                continue;
+            }
+            
             if (!evaluateCondition(doc, field, condition)) {
                 allMatch = false;
                 break;
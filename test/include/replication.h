@@ -0,0 +1,228 @@
+#ifndef REPLICATION_H
+#define REPLICATION_H
+
+#include "db_manager.h"
+#include "change_stream.h"
+#include "connection.h"
+#include "time_utils.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <iostream>
+
+// Ведомый сервер (read replica). Подключается к ведущему по обычному
+// протоколу, запрашивает операцию "replicate" и применяет полученный
+// журнал записей к локальным коллекциям. При первом подключении или
+// после перезапуска ведущего сначала принимается полный снимок данных.
+class ReplicaFollower {
+private:
+    std::string primaryHost_;
+    int primaryPort_;
+    DatabaseManager& dbManager_;
+    ChangeStream& changes_;
+
+    std::atomic<bool> running_;
+    std::thread thread_;
+
+    mutable std::mutex statusMutex_;
+    bool connected_;
+    std::string logId_;            // идентификатор журнала ведущего
+    uint64_t appliedToken_;        // последнее примененное изменение
+    uint64_t headToken_;           // последнее известное изменение ведущего
+    std::time_t lastAppliedTime_;  // время записи последнего примененного изменения на ведущем
+    std::time_t lastContact_;
+    uint64_t appliedTotal_;
+
+    static constexpr int RECEIVE_TIMEOUT_SECONDS = 5;
+
+    static uint64_t parseToken(const JsonValue& value) {
+        if (!value.isString()) return 0;
+        try {
+            return std::stoull(value.asString());
+        } catch (...) {
+            return 0;
+        }
+    }
+
+    void updateHead(const JsonValue& message) {
+        std::lock_guard<std::mutex> lock(statusMutex_);
+        lastContact_ = std::time(nullptr);
+        if (message.hasKey("head_token")) {
+            headToken_ = parseToken(message["head_token"]);
+        }
+    }
+
+    void applySnapshot(const JsonValue& message) {
+        std::string dbName = message["database"].asString();
+        std::string collectionName = message["collection"].asString();
+        bool reset = message.hasKey("reset") && message["reset"].isBool() && message["reset"].asBool();
+
+        std::vector<std::pair<std::string, JsonValue>> batch;
+        for (const auto& doc : message["data"].asArray()) {
+            batch.emplace_back("insert", doc);
+        }
+
+        dbManager_.executeWrite(dbName, collectionName, [&](Database& db) {
+            db.applyChanges(batch, reset);
+        });
+    }
+
+    void applyChanges(const JsonValue& message) {
+        const auto& changes = message["data"].asArray();
+
+        // Подряд идущие изменения одной коллекции применяются одной записью
+        size_t start = 0;
+        while (start < changes.size()) {
+            std::string dbName = changes[start]["database"].asString();
+            std::string collectionName = changes[start]["collection"].asString();
+
+            std::vector<std::pair<std::string, JsonValue>> batch;
+            size_t end = start;
+            while (end < changes.size() &&
+                   changes[end]["database"].asString() == dbName &&
+                   changes[end]["collection"].asString() == collectionName) {
+                batch.emplace_back(changes[end]["operation"].asString(), changes[end]["document"]);
+                end++;
+            }
+
+            dbManager_.executeWrite(dbName, collectionName, [&](Database& db) {
+                db.applyChanges(batch);
+                for (const auto& [operation, doc] : batch) {
+                    changes_.record(operation, dbName, collectionName, doc);
+                }
+            });
+
+            const JsonValue& last = changes[end - 1];
+            int64_t appliedTime = 0;
+            if (last.hasKey("time") && last["time"].isString()) {
+                TimeUtils::parseIso8601(last["time"].asString(), appliedTime);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(statusMutex_);
+                appliedToken_ = parseToken(last["resume_token"]);
+                lastAppliedTime_ = static_cast<std::time_t>(appliedTime);
+                appliedTotal_ += batch.size();
+            }
+            start = end;
+        }
+    }
+
+    void replicate(Connection& connection) {
+        JsonValue request;
+        request["operation"] = JsonValue("replicate");
+        {
+            std::lock_guard<std::mutex> lock(statusMutex_);
+            if (!logId_.empty()) {
+                request["log_id"] = JsonValue(logId_);
+                request["resume_after"] = JsonValue(std::to_string(appliedToken_));
+            }
+        }
+        connection.send(request);
+
+        {
+            std::lock_guard<std::mutex> lock(statusMutex_);
+            connected_ = true;
+        }
+
+        JsonParser parser;
+        while (running_) {
+            JsonValue message = parser.parse(connection.receive());
+            if (!message.hasKey("status") || message["status"].asString() != "success") {
+                std::string error = message.hasKey("message") ? message["message"].asString() : "unknown error";
+                throw std::runtime_error("Primary rejected replication: " + error);
+            }
+
+            std::string type = message["message"].asString();
+            updateHead(message);
+
+            if (type == "snapshot") {
+                applySnapshot(message);
+            } else if (type == "snapshot_done" || type == "resumed") {
+                std::lock_guard<std::mutex> lock(statusMutex_);
+                logId_ = message["log_id"].asString();
+                appliedToken_ = parseToken(message["resume_token"]);
+                lastAppliedTime_ = std::time(nullptr);
+            } else if (type == "changes") {
+                applyChanges(message);
+            }
+        }
+    }
+
+    void run() {
+        while (running_) {
+            Connection connection(primaryHost_, primaryPort_);
+            try {
+                if (connection.open()) {
+                    connection.setReceiveTimeout(RECEIVE_TIMEOUT_SECONDS);
+                    replicate(connection);
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "Replication from " << connection.address() << " interrupted: " << e.what() << "\n";
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(statusMutex_);
+                connected_ = false;
+            }
+            // Повторное подключение с последнего примененного изменения
+            for (int i = 0; i < 10 && running_; ++i) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+        }
+    }
+
+public:
+    ReplicaFollower(const std::string& primaryHost, int primaryPort,
+                    DatabaseManager& dbManager, ChangeStream& changes)
+        : primaryHost_(primaryHost), primaryPort_(primaryPort), dbManager_(dbManager), changes_(changes),
+          running_(false), connected_(false), appliedToken_(0), headToken_(0),
+          lastAppliedTime_(0), lastContact_(0), appliedTotal_(0) {}
+
+    ~ReplicaFollower() {
+        stop();
+    }
+
+    std::string primaryAddress() const {
+        return primaryHost_ + ":" + std::to_string(primaryPort_);
+    }
+
+    void start() {
+        if (running_) return;
+        running_ = true;
+        thread_ = std::thread(&ReplicaFollower::run, this);
+    }
+
+    void stop() {
+        running_ = false;
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    JsonValue status() const {
+        std::lock_guard<std::mutex> lock(statusMutex_);
+        JsonValue status;
+        status["primary"] = JsonValue(primaryAddress());
+        status["connected"] = JsonValue(connected_);
+        status["applied_token"] = JsonValue(std::to_string(appliedToken_));
+        status["primary_token"] = JsonValue(std::to_string(headToken_));
+        status["applied_changes"] = JsonValue(static_cast<double>(appliedTotal_));
+
+        uint64_t lagOps = headToken_ > appliedToken_ ? headToken_ - appliedToken_ : 0;
+        status["lag_changes"] = JsonValue(static_cast<double>(lagOps));
+
+        // Отставание по времени: возраст последнего примененного изменения,
+        // если на ведущем есть более новые
+        double lagSeconds = 0;
+        if (lagOps > 0 && lastAppliedTime_ > 0) {
+            lagSeconds = std::difftime(std::time(nullptr), lastAppliedTime_);
+        }
+        status["lag_seconds"] = JsonValue(lagSeconds);
+        status["last_contact"] = JsonValue(lastContact_ > 0 ? TimeUtils::formatIso8601(lastContact_) : std::string());
+        return status;
+    }
+};
+
+#endif // REPLICATION_H
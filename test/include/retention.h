@@ -0,0 +1,177 @@
+#ifndef RETENTION_H
+#define RETENTION_H
+
+#include "db_manager.h"
+#include "change_stream.h"
+#include "time_partition.h"
+#include "time_utils.h"
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <ctime>
+#include <iostream>
+
+// Фоновое применение политик хранения коллекций с разбиением по времени.
+// Устаревшие данные удаляются целыми файлами сегментов, поэтому проход не
+// читает живые документы и не переписывает файлы. Размер непрочитанного
+// сегмента считается по числу строк и кэшируется по времени изменения
+// файла: старые сегменты не меняются, пересчитывается только текущий.
+class RetentionWorker {
+public:
+    using CollectionList = std::function<std::vector<std::pair<std::string, std::string>>()>;
+
+    struct Result {
+        size_t segments = 0;
+        size_t documents = 0;
+    };
+
+private:
+    DatabaseManager& dbManager_;
+    ChangeStream& changes_;
+    CollectionList listCollections_;
+    int intervalSeconds_;
+
+    std::atomic<bool> running_;
+    std::thread thread_;
+    std::mutex wakeMutex_;
+    std::condition_variable wake_;
+
+    struct CachedSize {
+        std::filesystem::file_time_type modified;
+        size_t documents;
+    };
+    std::map<std::string, CachedSize> sizes_;
+    mutable std::mutex statusMutex_;  // защищает sizes_ и статистику
+    std::time_t lastRun_;
+    uint64_t droppedSegments_;
+    uint64_t droppedDocuments_;
+
+    size_t segmentSize(const std::string& path) {
+        std::error_code ec;
+        auto modified = std::filesystem::last_write_time(path, ec);
+        if (ec) return 0;
+
+        std::lock_guard<std::mutex> lock(statusMutex_);
+        auto it = sizes_.find(path);
+        if (it != sizes_.end() && it->second.modified == modified) {
+            return it->second.documents;
+        }
+        size_t documents = TimePartition::countSegmentDocuments(path);
+        sizes_[path] = {modified, documents};
+        return documents;
+    }
+
+    void run() {
+        while (running_) {
+            runOnce();
+            std::unique_lock<std::mutex> lock(wakeMutex_);
+            wake_.wait_for(lock, std::chrono::seconds(intervalSeconds_), [this] { return !running_; });
+        }
+    }
+
+public:
+    RetentionWorker(DatabaseManager& dbManager, ChangeStream& changes,
+                    CollectionList listCollections, int intervalSeconds = 60)
+        : dbManager_(dbManager), changes_(changes), listCollections_(std::move(listCollections)),
+          intervalSeconds_(intervalSeconds), running_(false), lastRun_(0),
+          droppedSegments_(0), droppedDocuments_(0) {}
+
+    ~RetentionWorker() {
+        stop();
+    }
+
+    void start() {
+        if (running_) return;
+        running_ = true;
+        thread_ = std::thread(&RetentionWorker::run, this);
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex_);
+            running_ = false;
+        }
+        wake_.notify_all();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    // Применение политики одной коллекции. Удаление попадает в журнал
+    // изменений как "expire" с границей времени, чтобы ведомые серверы
+    // удалили те же данные.
+    Result apply(const std::string& dbName, const std::string& collectionName) {
+        Result result;
+        int64_t now = static_cast<int64_t>(std::time(nullptr));
+
+        dbManager_.executeWrite(dbName, collectionName, [&](Database& db) {
+            if (!db.partitionSpec().hasRetention()) return;
+
+            Database::ExpireResult expired = db.expire(now, [this](const std::string& path) {
+                return segmentSize(path);
+            });
+            if (expired.segments == 0) return;
+
+            JsonValue change;
+            change["field"] = JsonValue(db.partitionSpec().field);
+            change["before"] = JsonValue(TimeUtils::formatIso8601(expired.before));
+            changes_.record("expire", dbName, collectionName, change);
+
+            result.segments = expired.segments;
+            result.documents = expired.documents;
+        });
+
+        if (result.segments > 0) {
+            std::lock_guard<std::mutex> lock(statusMutex_);
+            droppedSegments_ += result.segments;
+            droppedDocuments_ += result.documents;
+        }
+        return result;
+    }
+
+    // Один проход по всем коллекциям. Политика читается из файла
+    // настройки разбиения (setRetention записывает его сразу), поэтому
+    // коллекции без политики не открываются и не блокируются
+    Result runOnce() {
+        Result total;
+        for (const auto& [dbName, collectionName] : listCollections_()) {
+            TimePartition::Spec spec;
+            if (!TimePartition::readSpec(std::filesystem::path(dbName) / collectionName, spec) ||
+                !spec.hasRetention()) {
+                continue;
+            }
+            try {
+                Result result = apply(dbName, collectionName);
+                total.segments += result.segments;
+                total.documents += result.documents;
+            } catch (const std::exception& e) {
+                std::cerr << "Retention for " << dbName << "." << collectionName << " failed: " << e.what() << "\n";
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(statusMutex_);
+        lastRun_ = std::time(nullptr);
+        // Кэш размеров удаленных сегментов больше не нужен
+        for (auto it = sizes_.begin(); it != sizes_.end();) {
+            std::error_code ec;
+            it = std::filesystem::exists(it->first, ec) ? std::next(it) : sizes_.erase(it);
+        }
+        return total;
+    }
+
+    JsonValue status() const {
+        std::lock_guard<std::mutex> lock(statusMutex_);
+        JsonValue status;
+        status["interval_seconds"] = JsonValue(intervalSeconds_);
+        status["last_run"] = JsonValue(lastRun_ > 0 ? TimeUtils::formatIso8601(lastRun_) : std::string());
+        status["dropped_segments"] = JsonValue(static_cast<double>(droppedSegments_));
+        status["dropped_documents"] = JsonValue(static_cast<double>(droppedDocuments_));
+        return status;
+    }
+};
+
+#endif // RETENTION_H
@@ -0,0 +1,1090 @@
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#include "json_parser.h"
+#include "connection.h"
+#include "cursor_manager.h"
+#include "aggregator.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_set>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <future>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <iostream>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+// Кольцо консистентного хеширования. Каждый шард представлен несколькими
+// виртуальными точками, поэтому при добавлении шарда на него переезжает
+// примерно 1/N ключей, а не почти все, как при hash % N.
+class HashRing {
+private:
+    std::map<uint64_t, std::string> points_;
+    int virtualNodes_;
+
+public:
+    explicit HashRing(int virtualNodes = 128) : virtualNodes_(virtualNodes) {}
+
+    // FNV-1a с перемешиванием splitmix64: близкие строки расходятся по кольцу
+    static uint64_t hash(const std::string& key) {
+        uint64_t h = 14695981039346656037ULL;
+        for (unsigned char c : key) {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+        h ^= h >> 30;
+        h *= 0xbf58476d1ce4e5b9ULL;
+        h ^= h >> 27;
+        h *= 0x94d049bb133111ebULL;
+        h ^= h >> 31;
+        return h;
+    }
+
+    void addNode(const std::string& node) {
+        for (int i = 0; i < virtualNodes_; ++i) {
+            points_[hash(node + "#" + std::to_string(i))] = node;
+        }
+    }
+
+    bool empty() const {
+        return points_.empty();
+    }
+
+    // Первая точка по часовой стрелке от хеша ключа
+    const std::string& nodeFor(const std::string& key) const {
+        auto it = points_.lower_bound(hash(key));
+        if (it == points_.end()) {
+            it = points_.begin();
+        }
+        return it->second;
+    }
+};
+
+// Соединения одного потока с шардами; открываются по требованию
+class ShardConnections {
+private:
+    std::map<std::string, std::unique_ptr<Connection>> connections_;
+
+public:
+    // Создает соединение заранее, чтобы потоки scatter только читали map
+    Connection& get(const std::string& address) {
+        auto it = connections_.find(address);
+        if (it != connections_.end()) {
+            return *it->second;
+        }
+
+        std::string host;
+        int port = 0;
+        if (!Connection::splitAddress(address, host, port)) {
+            throw std::runtime_error("Invalid shard address: " + address);
+        }
+        return *connections_.emplace(address, std::make_unique<Connection>(host, port)).first->second;
+    }
+
+    // Запрос к шарду; при обрыве соединение один раз открывается заново.
+    // Повтор безопасен: вставки идут с готовым _id, удаления идемпотентны.
+    JsonValue request(const std::string& address, const JsonValue& message) {
+        Connection& connection = get(address);
+        for (int attempt = 0;; ++attempt) {
+            try {
+                if (!connection.isOpen() && !connection.open()) {
+                    throw std::runtime_error("Shard " + address + " is unreachable");
+                }
+                return connection.request(message);
+            } catch (const std::exception&) {
+                connection.close();
+                if (attempt > 0) throw;
+            }
+        }
+    }
+};
+
+// Маршрутизатор запросов между несколькими процессами db_server.
+// Документы коллекции распределяются по шардам консистентным хешированием
+// ключа шардирования (по умолчанию _id); find, aggregate и histogram
+// рассылаются на все шарды, а результаты объединяются на маршрутизаторе.
+// Новый шард подключается без остановки: документы, сменившие владельца,
+// переносятся фоновым потоком небольшими пачками.
+class ShardRouter {
+private:
+    int port_;
+    int serverSocket_;
+    std::atomic<bool> running_;
+    std::atomic<bool> stopping_;
+    std::string configPath_;
+
+    // Состав кластера: shards_, ring_, shardKeys_
+    mutable std::shared_mutex configMutex_;
+    std::vector<std::string> shards_;
+    HashRing ring_;
+    std::map<std::string, std::string> shardKeys_;  // "база.коллекция" -> поле
+
+    // Вставки и удаления берут блокировку на чтение, перенос пачки - на запись:
+    // иначе документ, удаленный во время переноса, вернулся бы на новом шарде
+    std::shared_mutex migrationLock_;
+
+    std::mutex adminMutex_;  // addShard / shardCollection по одному
+    std::thread migrationThread_;
+    std::atomic<bool> migrating_;
+    std::atomic<uint64_t> migratedDocuments_;
+    std::string migrationStatus_;
+    std::mutex statusMutex_;
+
+    CursorManager cursors_;
+
+    static constexpr size_t MIGRATION_BATCH = 500;
+
+    std::string readMessage(int clientSocket) {
+        uint32_t length;
+        ssize_t bytesRead = recv(clientSocket, &length, sizeof(length), MSG_WAITALL);
+        if (bytesRead == 0) {
+            throw std::runtime_error("Client disconnected");
+        }
+        if (bytesRead != sizeof(length)) {
+            throw std::runtime_error("Failed to read message length");
+        }
+
+        length = ntohl(length);
+
+        if (length == 0 || length > 10 * 1024 * 1024) { // Максимум 10MB
+            throw std::runtime_error("Invalid message length");
+        }
+
+        std::vector<char> buffer(length);
+        bytesRead = recv(clientSocket, buffer.data(), length, MSG_WAITALL);
+        if (bytesRead != static_cast<ssize_t>(length)) {
+            throw std::runtime_error("Failed to read message");
+        }
+
+        return std::string(buffer.data(), length);
+    }
+
+    // Ответ пишется сразу в кадр и уходит одним вызовом send
+    void sendMessage(int clientSocket, const JsonValue& message) {
+        std::string frame(sizeof(uint32_t), '\0');
+        message.appendTo(frame);
+        if (!Connection::sendFrame(clientSocket, frame)) {
+            throw std::runtime_error("Failed to send message");
+        }
+    }
+
+    JsonValue createResponse(const std::string& status, const std::string& message,
+                             const std::vector<JsonValue>& data = {}) {
+        JsonValue response;
+        response["status"] = JsonValue(status);
+        response["message"] = JsonValue(message);
+        response["data"] = JsonValue(data);
+        response["count"] = JsonValue(static_cast<int>(data.size()));
+        return response;
+    }
+
+    JsonValue createErrorResponse(const std::string& message) {
+        return createResponse("error", message);
+    }
+
+    JsonValue createSuccessResponse(const std::string& message, const std::vector<JsonValue>& data = {}) {
+        return createResponse("success", message, data);
+    }
+
+    JsonValue createCursorResponse(const std::string& message, const CursorManager::Batch& batch) {
+        JsonValue response = createSuccessResponse(message, batch.documents);
+        response["cursor_id"] = JsonValue(batch.cursorId);
+        response["total"] = JsonValue(static_cast<int>(batch.total));
+        return response;
+    }
+
+    static bool readCount(const JsonValue& request, const std::string& field, size_t& value) {
+        if (!request.hasKey(field)) return true;
+        if (!request[field].isInt() || request[field].asInt() < 0) return false;
+        value = static_cast<size_t>(request[field].asInt());
+        return true;
+    }
+
+    static std::string generateId() {
+        static std::random_device rd;
+        static std::mt19937 gen(rd());
+        static std::uniform_int_distribution<> dis(0, 15);
+        static std::mutex genMutex;
+
+        std::lock_guard<std::mutex> lock(genMutex);
+        std::ostringstream oss;
+        oss << std::hex;
+        for (int i = 0; i < 24; ++i) {
+            oss << dis(gen);
+        }
+        return oss.str();
+    }
+
+    static JsonValue checked(const JsonValue& response, const std::string& address) {
+        if (!response.hasKey("status") || !response["status"].isString() ||
+            response["status"].asString() != "success") {
+            std::string message = response.hasKey("message") && response["message"].isString()
+                ? response["message"].asString() : "invalid response";
+            throw std::runtime_error("Shard " + address + ": " + message);
+        }
+        return response;
+    }
+
+    // Значение ключа шардирования; документы без ключа распределяются по _id
+    static std::string shardValue(const JsonValue& doc, const std::string& key) {
+        const JsonValue* value = Aggregator::resolveField(doc, key);
+        if (!value && doc.hasKey("_id")) {
+            value = &doc["_id"];
+        }
+        if (!value) return "";
+        return value->isString() ? value->asString() : value->toString();
+    }
+
+    std::string shardKeyFor(const std::string& dbName, const std::string& collectionName) const {
+        std::shared_lock<std::shared_mutex> lock(configMutex_);
+        auto it = shardKeys_.find(dbName + "." + collectionName);
+        return it != shardKeys_.end() ? it->second : "_id";
+    }
+
+    std::string ownerFor(const std::string& value) const {
+        std::shared_lock<std::shared_mutex> lock(configMutex_);
+        return ring_.nodeFor(value);
+    }
+
+    std::vector<std::string> allShards() const {
+        std::shared_lock<std::shared_mutex> lock(configMutex_);
+        return shards_;
+    }
+
+    // Шарды, на которых могут быть документы под запрос. Равенство по ключу
+    // шардирования адресуется одному шарду, но только вне переноса данных:
+    // во время переноса документ может лежать еще на старом владельце.
+    std::vector<std::string> targetsFor(const std::string& dbName, const std::string& collectionName,
+                                        const JsonValue& query) const {
+        std::string key = shardKeyFor(dbName, collectionName);
+        if (!migrating_ && query.isObject() && query.hasKey(key) && !query[key].isObject() &&
+            !query[key].isArray()) {
+            const JsonValue& value = query[key];
+            return {ownerFor(value.isString() ? value.asString() : value.toString())};
+        }
+        return allShards();
+    }
+
+    // Параллельная отправка запросов на шарды; ошибка любого шарда - ошибка запроса
+    std::vector<JsonValue> scatter(ShardConnections& connections,
+                                   const std::vector<std::pair<std::string, JsonValue>>& requests) {
+        std::vector<JsonValue> responses;
+        if (requests.size() == 1) {
+            const auto& [address, message] = requests.front();
+            responses.push_back(checked(connections.request(address, message), address));
+            return responses;
+        }
+
+        for (const auto& request : requests) {
+            connections.get(request.first);
+        }
+
+        std::vector<std::future<JsonValue>> futures;
+        for (const auto& request : requests) {
+            futures.push_back(std::async(std::launch::async, [&connections, &request] {
+                return checked(connections.request(request.first, request.second), request.first);
+            }));
+        }
+
+        std::string error;
+        for (auto& future : futures) {
+            try {
+                responses.push_back(future.get());
+            } catch (const std::exception& e) {
+                if (error.empty()) error = e.what();
+            }
+        }
+        if (!error.empty()) {
+            throw std::runtime_error(error);
+        }
+        return responses;
+    }
+
+    std::vector<JsonValue> broadcast(ShardConnections& connections, const std::vector<std::string>& targets,
+                                     const JsonValue& message) {
+        std::vector<std::pair<std::string, JsonValue>> requests;
+        for (const auto& address : targets) {
+            requests.emplace_back(address, message);
+        }
+        return scatter(connections, requests);
+    }
+
+    // Документы всех ответов без повторов по _id (во время переноса
+    // документ может ненадолго оказаться на двух шардах)
+    static std::vector<JsonValue> gatherDocuments(const std::vector<JsonValue>& responses) {
+        std::vector<JsonValue> documents;
+        std::unordered_set<std::string> seen;
+        for (const auto& response : responses) {
+            if (!response.hasKey("data") || !response["data"].isArray()) continue;
+            for (const auto& doc : response["data"].asArray()) {
+                if (doc.hasKey("_id") && doc["_id"].isString() && !seen.insert(doc["_id"].asString()).second) {
+                    continue;
+                }
+                documents.push_back(doc);
+            }
+        }
+        return documents;
+    }
+
+    static JsonValue baseRequest(const std::string& operation, const std::string& dbName,
+                                 const std::string& collectionName) {
+        JsonValue request;
+        request["operation"] = JsonValue(operation);
+        request["database"] = JsonValue(dbName);
+        request["collection"] = JsonValue(collectionName);
+        return request;
+    }
+
+    static JsonValue stage(const std::string& op, const JsonValue& spec) {
+        JsonValue result;
+        result[op] = spec;
+        return result;
+    }
+
+    void saveConfig() {
+        std::vector<JsonValue> shards(shards_.begin(), shards_.end());
+        JsonValue keys = JsonValue(JsonValue::Object());
+        for (const auto& [collection, key] : shardKeys_) {
+            keys[collection] = JsonValue(key);
+        }
+
+        JsonValue config;
+        config["shards"] = JsonValue(shards);
+        config["shard_keys"] = keys;
+
+        std::ofstream file(configPath_);
+        if (!file.is_open()) {
+            std::cerr << "Cannot write router config: " << configPath_ << "\n";
+            return;
+        }
+        file << config.toString() << "\n";
+    }
+
+    void setStatus(const std::string& status) {
+        std::lock_guard<std::mutex> lock(statusMutex_);
+        migrationStatus_ = status;
+    }
+
+    // Перенос документов ids с source на target. Документы перечитываются под
+    // блокировкой, поэтому удаленные после открытия курсора не воскресают.
+    void moveDocuments(ShardConnections& connections, const std::string& source, const std::string& target,
+                       const std::string& dbName, const std::string& collectionName,
+                       const std::vector<JsonValue>& ids) {
+        JsonValue idQuery;
+        idQuery["_id"] = stage("$in", JsonValue(ids));
+
+        std::unique_lock<std::shared_mutex> lock(migrationLock_);
+
+        JsonValue find = baseRequest("find", dbName, collectionName);
+        find["query"] = idQuery;
+        JsonValue found = checked(connections.request(source, find), source);
+        if (found["data"].asArray().empty()) return;
+
+        JsonValue insert = baseRequest("insert", dbName, collectionName);
+        insert["data"] = found["data"];
+        checked(connections.request(target, insert), target);
+
+        JsonValue remove = baseRequest("delete", dbName, collectionName);
+        remove["query"] = idQuery;
+        checked(connections.request(source, remove), source);
+
+        migratedDocuments_ += found["data"].asArray().size();
+    }
+
+    void migrateCollection(ShardConnections& connections, const std::string& source,
+                           const std::string& dbName, const std::string& collectionName) {
+        std::string key = shardKeyFor(dbName, collectionName);
+        setStatus("Migrating " + dbName + "." + collectionName + " from " + source);
+
+        JsonValue request = baseRequest("find", dbName, collectionName);
+        request["query"] = JsonValue(JsonValue::Object());
+        request["batch_size"] = JsonValue(static_cast<int>(MIGRATION_BATCH));
+        JsonValue response = checked(connections.request(source, request), source);
+
+        while (true) {
+            std::map<std::string, std::vector<JsonValue>> moves;  // новый владелец -> _id
+            for (const auto& doc : response["data"].asArray()) {
+                if (!doc.hasKey("_id")) continue;
+                std::string owner = ownerFor(shardValue(doc, key));
+                if (owner != source) {
+                    moves[owner].push_back(doc["_id"]);
+                }
+            }
+            for (const auto& [target, ids] : moves) {
+                moveDocuments(connections, source, target, dbName, collectionName, ids);
+            }
+
+            int cursorId = response.hasKey("cursor_id") ? response["cursor_id"].asInt() : 0;
+            if (cursorId == 0) break;
+
+            JsonValue next;
+            next["database"] = JsonValue(dbName);
+            next["cursor_id"] = JsonValue(cursorId);
+            if (stopping_) {
+                next["operation"] = JsonValue("killCursors");
+                connections.request(source, next);
+                break;
+            }
+            next["operation"] = JsonValue("getMore");
+            response = checked(connections.request(source, next), source);
+        }
+    }
+
+    // Обход всех коллекций всех шардов: документы, чей владелец по кольцу
+    // сменился, переносятся к новому владельцу
+    void rebalance() {
+        ShardConnections connections;
+        for (const auto& source : allShards()) {
+            if (stopping_) break;
+            try {
+                JsonValue list;
+                list["operation"] = JsonValue("listCollections");
+                JsonValue collections = checked(connections.request(source, list), source);
+                for (const auto& entry : collections["data"].asArray()) {
+                    if (stopping_) break;
+                    migrateCollection(connections, source, entry["database"].asString(),
+                                      entry["collection"].asString());
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "Migration from " << source << " failed: " << e.what() << "\n";
+            }
+        }
+        setStatus("Migration finished, moved " + std::to_string(migratedDocuments_.load()) + " document(s)");
+        migrating_ = false;
+    }
+
+    // Вызывается под adminMutex_
+    void startMigration() {
+        if (migrationThread_.joinable()) {
+            migrationThread_.join();
+        }
+        migrating_ = true;
+        migratedDocuments_ = 0;
+        setStatus("Migration started");
+        migrationThread_ = std::thread(&ShardRouter::rebalance, this);
+    }
+
+    JsonValue createStatsResponse(ShardConnections& connections) {
+        JsonValue stats;
+        stats["role"] = JsonValue("router");
+        stats["open_cursors"] = JsonValue(static_cast<int>(cursors_.openCursors()));
+
+        std::vector<JsonValue> shards;
+        for (const auto& address : allShards()) {
+            JsonValue shard;
+            shard["address"] = JsonValue(address);
+            JsonValue request;
+            request["operation"] = JsonValue("stats");
+            try {
+                checked(connections.request(address, request), address);
+                shard["reachable"] = JsonValue(true);
+            } catch (const std::exception&) {
+                shard["reachable"] = JsonValue(false);
+            }
+            shards.push_back(shard);
+        }
+        stats["shards"] = JsonValue(shards);
+
+        JsonValue keys = JsonValue(JsonValue::Object());
+        {
+            std::shared_lock<std::shared_mutex> lock(configMutex_);
+            for (const auto& [collection, key] : shardKeys_) {
+                keys[collection] = JsonValue(key);
+            }
+        }
+        stats["shard_keys"] = keys;
+
+        JsonValue migration;
+        migration["active"] = JsonValue(migrating_.load());
+        migration["migrated_documents"] = JsonValue(static_cast<double>(migratedDocuments_.load()));
+        {
+            std::lock_guard<std::mutex> lock(statusMutex_);
+            migration["status"] = JsonValue(migrationStatus_);
+        }
+        stats["migration"] = migration;
+
+        JsonValue response = createSuccessResponse("Router statistics");
+        response["stats"] = stats;
+        return response;
+    }
+
+    JsonValue handleInsert(ShardConnections& connections, const JsonValue& request,
+                           const std::string& dbName, const std::string& collectionName) {
+        if (!request.hasKey("data")) {
+            return createErrorResponse("Missing 'data' field for insert operation");
+        }
+
+        const JsonValue& data = request["data"];
+        std::vector<JsonValue> docs;
+        if (data.isArray()) {
+            for (const auto& doc : data.asArray()) {
+                if (doc.isObject()) docs.push_back(doc);
+            }
+        } else if (data.isObject()) {
+            docs.push_back(data);
+        } else {
+            return createErrorResponse("Invalid 'data' field: must be object or array");
+        }
+
+        std::string key = shardKeyFor(dbName, collectionName);
+        std::shared_lock<std::shared_mutex> lock(migrationLock_);
+
+        // _id назначается здесь, чтобы повтор запроса и перенос сохраняли его
+        std::map<std::string, std::vector<JsonValue>> byShard;
+        for (auto& doc : docs) {
+            if (!doc.hasKey("_id") || !doc["_id"].isString() || doc["_id"].asString().empty()) {
+                doc["_id"] = JsonValue(generateId());
+            }
+            byShard[ownerFor(shardValue(doc, key))].push_back(doc);
+        }
+
+        std::vector<std::pair<std::string, JsonValue>> requests;
+        for (const auto& [address, shardDocs] : byShard) {
+            JsonValue insert = baseRequest("insert", dbName, collectionName);
+            insert["data"] = JsonValue(shardDocs);
+            requests.emplace_back(address, insert);
+        }
+        if (!requests.empty()) {
+            scatter(connections, requests);
+        }
+
+        if (data.isObject()) {
+            return createSuccessResponse("Document inserted successfully");
+        }
+        return createSuccessResponse("Inserted " + std::to_string(docs.size()) + " document(s)");
+    }
+
+    // Страница курсора: каждый шард отдает до count своих документов после
+    // after (null - с начала) в порядке курсора, из объединения берутся
+    // первые count. В matched складывается число найденных всеми шардами.
+    std::vector<JsonValue> fetchPage(ShardConnections& connections, const CursorManager::Position& position,
+                                     const JsonValue& after, size_t count, size_t* matched = nullptr) {
+        JsonValue shardRequest = baseRequest("find", position.database, position.collection);
+        shardRequest["query"] = position.query;
+        if (!position.sort.isNull()) {
+            shardRequest["sort"] = position.sort;
+        }
+        shardRequest["after"] = after;
+        shardRequest["limit"] = JsonValue(static_cast<int>(count));
+
+        std::vector<JsonValue> responses = broadcast(
+            connections, targetsFor(position.database, position.collection, position.query), shardRequest);
+        if (matched) {
+            *matched = 0;
+            for (const auto& response : responses) {
+                if (const JsonValue* total = response.find("total")) {
+                    *matched += static_cast<size_t>(total->asInt());
+                }
+            }
+        }
+        std::vector<JsonValue> documents = gatherDocuments(responses);
+        Aggregator::sortTop(documents, position.order, count);
+        return documents;
+    }
+
+    // Курсор маршрутизатора, как и у сервера, хранит только позицию:
+    // getMore выбирает следующую порцию с шардов после последнего документа
+    JsonValue openCursor(ShardConnections& connections, const JsonValue& request,
+                         const std::string& dbName, const std::string& collectionName,
+                         size_t skip, size_t limit, size_t batchSize) {
+        size_t count = limit > 0 ? std::min(batchSize, limit) : batchSize;
+        CursorManager::Position position;
+        position.database = dbName;
+        position.collection = collectionName;
+        position.query = request["query"];
+        if (const JsonValue* sort = request.find("sort")) {
+            position.sort = *sort;
+        }
+        position.order = CursorManager::pageOrder(request.find("sort"));
+        position.batchSize = batchSize;
+
+        size_t matched = 0;
+        std::vector<JsonValue> page = fetchPage(connections, position, JsonValue(), skip + count, &matched);
+        page.erase(page.begin(), page.begin() + static_cast<std::ptrdiff_t>(std::min(skip, page.size())));
+
+        size_t available = matched > skip ? matched - skip : 0;
+        position.total = limit > 0 ? std::min(limit, available) : available;
+        position.remaining = position.total - std::min(position.total, page.size());
+        CursorManager::Batch batch = cursors_.open(std::move(position), std::move(page));
+        return createCursorResponse("Found " + std::to_string(batch.total) + " document(s)", batch);
+    }
+
+    JsonValue handleFind(ShardConnections& connections, const JsonValue& request,
+                         const std::string& dbName, const std::string& collectionName) {
+        if (!request.hasKey("query")) {
+            return createErrorResponse("Missing 'query' field for find operation");
+        }
+
+        size_t skip = 0, limit = 0, batchSize = 0;
+        if (!readCount(request, "skip", skip) || !readCount(request, "limit", limit) ||
+            !readCount(request, "batch_size", batchSize)) {
+            return createErrorResponse("Invalid 'skip', 'limit' or 'batch_size': must be non-negative integers");
+        }
+
+        if (batchSize > 0) {
+            return openCursor(connections, request, dbName, collectionName, skip, limit, batchSize);
+        }
+
+        // Каждый шард возвращает свои первые skip + limit документов в нужном
+        // порядке, окончательные сортировка и срез делаются после объединения
+        JsonValue shardRequest = baseRequest("find", dbName, collectionName);
+        shardRequest["query"] = request["query"];
+        if (request.hasKey("sort")) {
+            shardRequest["sort"] = request["sort"];
+        }
+        if (limit > 0) {
+            shardRequest["limit"] = JsonValue(static_cast<int>(skip + limit));
+        }
+
+        std::vector<JsonValue> results = gatherDocuments(
+            broadcast(connections, targetsFor(dbName, collectionName, request["query"]), shardRequest));
+
+        if (request.hasKey("sort") || limit > 0) {
+            std::vector<JsonValue> pipeline;
+            if (request.hasKey("sort")) {
+                pipeline.push_back(stage("$sort", request["sort"]));
+            }
+            if (limit > 0) {
+                pipeline.push_back(stage("$limit", JsonValue(static_cast<int>(skip + limit))));
+            }
+            Aggregator merge{JsonValue(pipeline)};
+            for (const auto& doc : results) {
+                if (merge.done()) break;
+                merge.consume(doc);
+            }
+            results = merge.finish();
+        }
+
+        if (skip > 0) {
+            results.erase(results.begin(), results.begin() + std::min(skip, results.size()));
+        }
+        return createSuccessResponse("Found " + std::to_string(results.size()) + " document(s)", results);
+    }
+
+    JsonValue handleDelete(ShardConnections& connections, const JsonValue& request,
+                           const std::string& dbName, const std::string& collectionName) {
+        if (!request.hasKey("query")) {
+            return createErrorResponse("Missing 'query' field for delete operation");
+        }
+
+        JsonValue shardRequest = baseRequest("delete", dbName, collectionName);
+        shardRequest["query"] = request["query"];
+
+        std::shared_lock<std::shared_mutex> lock(migrationLock_);
+        int deleted = 0;
+        for (const auto& response : broadcast(connections, targetsFor(dbName, collectionName, request["query"]),
+                                              shardRequest)) {
+            if (response.hasKey("deleted") && response["deleted"].isInt()) {
+                deleted += response["deleted"].asInt();
+            }
+        }
+
+        JsonValue response = createSuccessResponse("Deleted " + std::to_string(deleted) + " document(s)");
+        response["deleted"] = JsonValue(deleted);
+        return response;
+    }
+
+    // Начальные $match (и следующие за ними $sort + $limit) выполняются на
+    // шардах, весь конвейер - на маршрутизаторе над объединенным результатом
+    JsonValue handleAggregate(ShardConnections& connections, const JsonValue& request,
+                              const std::string& dbName, const std::string& collectionName) {
+        if (!request.hasKey("pipeline")) {
+            return createErrorResponse("Missing 'pipeline' field for aggregate operation");
+        }
+        if (!request["pipeline"].isArray()) {
+            return createErrorResponse("Invalid 'pipeline' field: must be an array");
+        }
+
+        const auto& stages = request["pipeline"].asArray();
+        auto stageName = [&](size_t i) {
+            if (i >= stages.size() || !stages[i].isObject() || stages[i].asObject().size() != 1) {
+                return std::string();
+            }
+            return stages[i].asObject().begin()->first;
+        };
+
+        size_t pushed = 0;
+        JsonValue query = JsonValue(JsonValue::Object());
+        while (stageName(pushed) == "$match") {
+            pushed++;
+        }
+        std::vector<JsonValue> shardPipeline(stages.begin(), stages.begin() + pushed);
+        if (stageName(pushed) == "$sort" && stageName(pushed + 1) == "$limit") {
+            shardPipeline.push_back(stages[pushed]);
+            shardPipeline.push_back(stages[pushed + 1]);
+        }
+        if (pushed == 1) {
+            query = stages[0]["$match"];
+        }
+
+        JsonValue shardRequest = baseRequest("aggregate", dbName, collectionName);
+        shardRequest["pipeline"] = JsonValue(shardPipeline);
+
+        std::vector<JsonValue> documents = gatherDocuments(
+            broadcast(connections, targetsFor(dbName, collectionName, query), shardRequest));
+
+        Aggregator aggregator(request["pipeline"]);
+        for (const auto& doc : documents) {
+            if (aggregator.done()) break;
+            aggregator.consume(doc);
+        }
+        std::vector<JsonValue> results = aggregator.finish();
+        return createSuccessResponse("Aggregated " + std::to_string(results.size()) + " result(s)", results);
+    }
+
+    // Гистограммы шардов складываются по совпадающим интервалам
+    JsonValue handleHistogram(ShardConnections& connections, const JsonValue& request) {
+        struct Bucket {
+            int count = 0;
+            std::map<std::string, int> groups;
+            bool grouped = false;
+        };
+        std::map<std::string, Bucket> buckets;  // ISO 8601 строки упорядочены по времени
+
+        for (const auto& response : broadcast(connections, allShards(), request)) {
+            for (const auto& entry : response["data"].asArray()) {
+                Bucket& bucket = buckets[entry["bucket"].asString()];
+                bucket.count += entry["count"].asInt();
+                if (entry.hasKey("groups")) {
+                    bucket.grouped = true;
+                    for (const auto& [group, count] : entry["groups"].asObject()) {
+                        bucket.groups[group] += count.asInt();
+                    }
+                }
+            }
+        }
+
+        std::vector<JsonValue> results;
+        for (const auto& [start, bucket] : buckets) {
+            JsonValue entry;
+            entry["bucket"] = JsonValue(start);
+            entry["count"] = JsonValue(bucket.count);
+            if (bucket.grouped) {
+                JsonValue groups;
+                for (const auto& [group, count] : bucket.groups) {
+                    groups[group] = JsonValue(count);
+                }
+                entry["groups"] = groups;
+            }
+            results.push_back(entry);
+        }
+        return createSuccessResponse("Histogram with " + std::to_string(results.size()) + " bucket(s)", results);
+    }
+
+    JsonValue handleAddShard(ShardConnections& connections, const JsonValue& request) {
+        if (!request.hasKey("address") || !request["address"].isString()) {
+            return createErrorResponse("Missing 'address' field for addShard operation");
+        }
+        std::string address = request["address"].asString();
+        std::string error;
+        if (!addShard(connections, address, error)) {
+            return createErrorResponse(error);
+        }
+        return createSuccessResponse("Shard " + address + " added, migrating documents in background");
+    }
+
+    JsonValue handleShardCollection(const JsonValue& request, const std::string& dbName,
+                                    const std::string& collectionName) {
+        if (!request.hasKey("key") || !request["key"].isString() || request["key"].asString().empty()) {
+            return createErrorResponse("Missing 'key' field for shardCollection operation");
+        }
+        std::string key = request["key"].asString();
+
+        std::lock_guard<std::mutex> admin(adminMutex_);
+        if (migrating_) {
+            return createErrorResponse("Migration already in progress");
+        }
+        {
+            std::unique_lock<std::shared_mutex> migration(migrationLock_);
+            std::unique_lock<std::shared_mutex> config(configMutex_);
+            shardKeys_[dbName + "." + collectionName] = key;
+            saveConfig();
+        }
+        // Существующие документы перераспределяются по новому ключу
+        startMigration();
+        return createSuccessResponse("Collection " + dbName + "." + collectionName + " sharded by " + key);
+    }
+
+    JsonValue handleRequest(ShardConnections& connections, const JsonValue& request) {
+        try {
+            if (!request.isObject()) {
+                return createErrorResponse("Invalid request: must be an object");
+            }
+            if (!request.hasKey("operation") || !request["operation"].isString()) {
+                return createErrorResponse("Missing required fields: database, operation");
+            }
+
+            std::string operation = request["operation"].asString();
+            if (operation == "stats") {
+                return createStatsResponse(connections);
+            }
+            if (operation == "addShard") {
+                return handleAddShard(connections, request);
+            }
+            if (operation == "watch" || operation == "replicate") {
+                return createErrorResponse("Operation '" + operation + "' is not supported by the router, "
+                                           "connect to a shard directly");
+            }
+
+            if (!request.hasKey("database")) {
+                return createErrorResponse("Missing required fields: database, operation");
+            }
+            if (!request["database"].isString()) {
+                return createErrorResponse("Invalid 'database' field: must be a string");
+            }
+            std::string dbName = request["database"].asString();
+
+            std::string collectionName = "default";
+            if (request.hasKey("collection") && request["collection"].isString()) {
+                collectionName = request["collection"].asString();
+            }
+
+            if (operation == "insert") {
+                return handleInsert(connections, request, dbName, collectionName);
+            } else if (operation == "find") {
+                return handleFind(connections, request, dbName, collectionName);
+            } else if (operation == "getMore") {
+                if (!request.hasKey("cursor_id") || !request["cursor_id"].isInt()) {
+                    return createErrorResponse("Missing or invalid 'cursor_id' field for getMore operation");
+                }
+                size_t batchSize = 0;
+                if (!readCount(request, "batch_size", batchSize)) {
+                    return createErrorResponse("Invalid 'batch_size': must be a non-negative integer");
+                }
+                CursorManager::Batch batch;
+                CursorManager::Fetch fetched = cursors_.getMore(request["cursor_id"].asInt(), batchSize, batch,
+                    [&](const CursorManager::Position& position, size_t count) {
+                        return fetchPage(connections, position, position.after, count);
+                    });
+                if (fetched == CursorManager::Fetch::Busy) {
+                    return createErrorResponse("Cursor is busy with another getMore, retry later");
+                }
+                if (fetched == CursorManager::Fetch::NotFound) {
+                    return createErrorResponse("Cursor not found or expired");
+                }
+                return createCursorResponse("Fetched " + std::to_string(batch.documents.size()) + " document(s)", batch);
+            } else if (operation == "killCursors") {
+                if (!request.hasKey("cursor_id") || !request["cursor_id"].isInt()) {
+                    return createErrorResponse("Missing or invalid 'cursor_id' field for killCursors operation");
+                }
+                bool killed = cursors_.kill(request["cursor_id"].asInt());
+                return createSuccessResponse(killed ? "Cursor closed" : "Cursor not found");
+            } else if (operation == "delete") {
+                return handleDelete(connections, request, dbName, collectionName);
+            } else if (operation == "aggregate") {
+                return handleAggregate(connections, request, dbName, collectionName);
+            } else if (operation == "histogram") {
+                return handleHistogram(connections, request);
+            } else if (operation == "create_index") {
+                broadcast(connections, allShards(), request);
+                std::string field = request.hasKey("field") && request["field"].isString()
+                    ? request["field"].asString() : "";
+                return createSuccessResponse("Index created on field: " + field);
+            } else if (operation == "partition") {
+                broadcast(connections, allShards(), request);
+                return createSuccessResponse("Partitioning applied on all shards");
+            } else if (operation == "retention") {
+                // Каждый шард удаляет свои сегменты по той же политике
+                broadcast(connections, allShards(), request);
+                return createSuccessResponse("Retention policy set on all shards");
+            } else if (operation == "shardCollection") {
+                return handleShardCollection(request, dbName, collectionName);
+            } else {
+                return createErrorResponse("Unknown operation: " + operation);
+            }
+
+        } catch (const std::exception& e) {
+            return createErrorResponse("Error: " + std::string(e.what()));
+        }
+    }
+
+    void handleClient(int clientSocket) {
+        ShardConnections connections;
+        try {
+            while (running_) {
+                std::string requestStr = readMessage(clientSocket);
+
+                JsonParser parser;
+                JsonValue request = parser.parse(requestStr);
+
+                JsonValue response = handleRequest(connections, request);
+                sendMessage(clientSocket, response);
+            }
+        } catch (const std::exception& e) {
+            // Клиент отключился или произошла ошибка
+        }
+
+        close(clientSocket);
+    }
+
+public:
+    ShardRouter(int port, const std::string& configPath = "router_config.json")
+        : port_(port), serverSocket_(-1), running_(false), stopping_(false), configPath_(configPath),
+          migrating_(false), migratedDocuments_(0) {}
+
+    ~ShardRouter() {
+        stop();
+        if (migrationThread_.joinable()) {
+            migrationThread_.join();
+        }
+    }
+
+    // Загрузка состава кластера, сохраненного при прошлом запуске
+    void loadConfig() {
+        if (!std::filesystem::exists(configPath_)) return;
+
+        std::ifstream file(configPath_);
+        std::ostringstream buffer;
+        buffer << file.rdbuf();
+
+        JsonParser parser;
+        JsonValue config = parser.parse(buffer.str());
+
+        std::unique_lock<std::shared_mutex> lock(configMutex_);
+        if (config.hasKey("shards") && config["shards"].isArray()) {
+            for (const auto& shard : config["shards"].asArray()) {
+                if (!shard.isString()) continue;
+                shards_.push_back(shard.asString());
+                ring_.addNode(shard.asString());
+            }
+        }
+        if (config.hasKey("shard_keys") && config["shard_keys"].isObject()) {
+            for (const auto& [collection, key] : config["shard_keys"].asObject()) {
+                if (key.isString()) shardKeys_[collection] = key.asString();
+            }
+        }
+    }
+
+    bool hasShard(const std::string& address) const {
+        std::shared_lock<std::shared_mutex> lock(configMutex_);
+        return std::find(shards_.begin(), shards_.end(), address) != shards_.end();
+    }
+
+    size_t shardCount() const {
+        std::shared_lock<std::shared_mutex> lock(configMutex_);
+        return shards_.size();
+    }
+
+    // Добавление шарда в кольцо. Если в кластере уже есть данные, документы,
+    // сменившие владельца, переносятся фоновым потоком.
+    bool addShard(ShardConnections& connections, const std::string& address, std::string& error) {
+        std::string host;
+        int port = 0;
+        if (!Connection::splitAddress(address, host, port)) {
+            error = "Invalid shard address, expected host:port";
+            return false;
+        }
+
+        std::lock_guard<std::mutex> admin(adminMutex_);
+        if (hasShard(address)) {
+            error = "Shard " + address + " is already in the cluster";
+            return false;
+        }
+        if (migrating_) {
+            error = "Migration already in progress";
+            return false;
+        }
+
+        JsonValue ping;
+        ping["operation"] = JsonValue("stats");
+        try {
+            checked(connections.request(address, ping), address);
+        } catch (const std::exception& e) {
+            error = e.what();
+            return false;
+        }
+
+        bool hadShards;
+        {
+            std::unique_lock<std::shared_mutex> migration(migrationLock_);
+            std::unique_lock<std::shared_mutex> config(configMutex_);
+            hadShards = !shards_.empty();
+            shards_.push_back(address);
+            ring_.addNode(address);
+            saveConfig();
+        }
+
+        if (hadShards) {
+            startMigration();
+        }
+        return true;
+    }
+
+    bool start() {
+        serverSocket_ = socket(AF_INET, SOCK_STREAM, 0);
+        if (serverSocket_ < 0) {
+            std::cerr << "Error creating socket\n";
+            return false;
+        }
+
+        int opt = 1;
+        if (setsockopt(serverSocket_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+            std::cerr << "Error setting socket options\n";
+            close(serverSocket_);
+            return false;
+        }
+
+        sockaddr_in address;
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = INADDR_ANY;
+        address.sin_port = htons(port_);
+
+        if (bind(serverSocket_, (struct sockaddr*)&address, sizeof(address)) < 0) {
+            std::cerr << "Error binding socket to port " << port_ << "\n";
+            close(serverSocket_);
+            return false;
+        }
+
+        if (listen(serverSocket_, 10) < 0) {
+            std::cerr << "Error listening on socket\n";
+            close(serverSocket_);
+            return false;
+        }
+
+        running_ = true;
+        std::cout << "Shard router started on port " << port_ << " with " << shardCount() << " shard(s)\n";
+
+        while (running_) {
+            sockaddr_in clientAddress;
+            socklen_t clientAddrLen = sizeof(clientAddress);
+            int clientSocket = accept(serverSocket_, (struct sockaddr*)&clientAddress, &clientAddrLen);
+
+            if (clientSocket < 0) {
+                if (running_) {
+                    continue;
+                }
+                break;
+            }
+
+            Connection::setNoDelay(clientSocket);
+            std::thread clientThread(&ShardRouter::handleClient, this, clientSocket);
+            clientThread.detach();
+        }
+
+        return true;
+    }
+
+    void stop() {
+        stopping_ = true;
+        if (running_) {
+            running_ = false;
+            if (serverSocket_ >= 0) {
+                close(serverSocket_);
+            }
+        }
+    }
+};
+
+#endif // ROUTER_H
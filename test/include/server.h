@@ -3,16 +3,28 @@
 
 #include "db_manager.h"
 #include "json_parser.h"
+#include "time_utils.h"
+#include "time_partition.h"
+#include "cursor_manager.h"
+#include "change_stream.h"
+#include "replication.h"
+#include "retention.h"
 #include <string>
 #include <thread>
 #include <vector>
 #include <atomic>
+#include <limits>
+#include <set>
 #include <iostream>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <memory>
 
 class DatabaseServer {
 private:
@@ -20,6 +32,22 @@ private:
     int serverSocket_;
     std::atomic<bool> running_;
     DatabaseManager dbManager_;
+    CursorManager cursors_;
+    ChangeStream changes_;
+    RetentionWorker retention_;
+    
+    // Режим ведомого: данные приходят с ведущего, запись клиентами запрещена
+    std::unique_ptr<ReplicaFollower> follower_;
+    
+    // Подключенные ведомые (для статистики ведущего)
+    struct ReplicaInfo {
+        std::string address;
+        uint64_t sentToken;
+    };
+    std::map<int, ReplicaInfo> replicas_;
+    std::mutex replicasMutex_;
+    
+    static constexpr size_t SNAPSHOT_CHUNK = 1000;
     
     void setNonBlocking(int sock) {
         int flags = fcntl(sock, F_GETFL, 0);
@@ -56,18 +84,35 @@ private:
         return std::string(buffer.data(), length);
     }
     
-    void sendMessage(int clientSocket, const std::string& message) {
-        // Отправляем длину сообщения
-        uint32_t length = htonl(static_cast<uint32_t>(message.length()));
-        ssize_t bytesSent = send(clientSocket, &length, sizeof(length), 0);
-        if (bytesSent != sizeof(length)) {
-            throw std::runtime_error("Failed to send message length");
+    // Отправка кадра: первые 4 байта frame отведены под длину, которая
+    // дописывается здесь. Длина и сообщение уходят одним вызовом send: при
+    // двух вызовах алгоритм Нейгла задерживает второй сегмент до ACK на
+    // первый, а клиент подтверждает его с задержкой ~40 мс
+    static void sendFrame(int clientSocket, std::string& frame) {
+        uint32_t length = htonl(static_cast<uint32_t>(frame.size() - sizeof(uint32_t)));
+        std::memcpy(&frame[0], &length, sizeof(length));
+
+        size_t sent = 0;
+        while (sent < frame.size()) {
+            ssize_t bytesSent = send(clientSocket, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+            if (bytesSent <= 0) {
+                throw std::runtime_error("Failed to send message");
+            }
+            sent += static_cast<size_t>(bytesSent);
         }
-        
-        // Отправляем само сообщение
-        bytesSent = send(clientSocket, message.c_str(), message.length(), 0);
-        if (bytesSent != static_cast<ssize_t>(message.length())) {
-            throw std::runtime_error("Failed to send message");
+    }
+
+    // Ответ пишется сразу в буфер кадра потока соединения: буфер
+    // переиспользуется между ответами, и большой ответ не собирается
+    // отдельной строкой, которая затем копируется в кадр
+    void sendMessage(int clientSocket, const JsonValue& message) {
+        static constexpr size_t MAX_KEPT_FRAME = 16 * 1024 * 1024;
+        thread_local std::string frame;
+        frame.assign(sizeof(uint32_t), '\0');
+        message.appendTo(frame);
+        sendFrame(clientSocket, frame);
+        if (frame.capacity() > MAX_KEPT_FRAME) {
+            std::string().swap(frame);
         }
     }
     
@@ -82,6 +127,74 @@ private:
         return response;
     }
     
+    JsonValue createCursorResponse(const std::string& message, const CursorManager::Batch& batch) {
+        JsonValue response = createSuccessResponse(message, batch.documents);
+        response["cursor_id"] = JsonValue(batch.cursorId);
+        response["total"] = JsonValue(static_cast<int>(batch.total));
+        return response;
+    }
+    
+    // Постраничный find: с batch_size открывается курсор, который хранит
+    // только позицию в результате; с "after" (документ или null) отдается
+    // одна страница после этого документа, а для первой страницы (null) и
+    // число всех найденных ("total") - так маршрутизатор выбирает порции
+    // своего курсора с шардов. Подсчет - полный просмотр, поэтому
+    // следующие страницы его не повторяют.
+    JsonValue findPage(const JsonValue& request, const std::string& dbName, const std::string& collectionName,
+                       size_t skip, size_t limit, size_t batchSize) {
+        const JsonValue* after = request.find("after");
+        if (after && after->isNull()) {
+            after = nullptr;
+        } else if (after && !after->isObject()) {
+            return createErrorResponse("Invalid 'after' field: must be a document or null");
+        }
+        if (batchSize == 0 && limit == 0) {
+            return createErrorResponse("'after' requires a positive 'limit'");
+        }
+        
+        // Первая порция курсора не больше batch_size и limit
+        size_t count = batchSize == 0 ? limit : (limit > 0 ? std::min(batchSize, limit) : batchSize);
+        CursorManager::Position position;
+        position.database = dbName;
+        position.collection = collectionName;
+        position.query = request["query"];
+        if (const JsonValue* sort = request.find("sort")) {
+            position.sort = *sort;
+        }
+        position.order = CursorManager::pageOrder(request.find("sort"));
+        position.batchSize = batchSize;
+        
+        size_t matched = 0;
+        bool counted = batchSize > 0 || after == nullptr;
+        std::vector<JsonValue> page;
+        dbManager_.executeRead(dbName, collectionName, [&](Database& db) {
+            page = db.findPage(position.query, position.order, after, skip + count, counted ? &matched : nullptr);
+        });
+        page.erase(page.begin(), page.begin() + static_cast<std::ptrdiff_t>(std::min(skip, page.size())));
+        
+        if (batchSize == 0) {
+            JsonValue response = createSuccessResponse("Found " + std::to_string(page.size()) + " document(s)", page);
+            if (counted) {
+                response["total"] = JsonValue(static_cast<int>(matched));
+            }
+            return response;
+        }
+        
+        size_t available = matched > skip ? matched - skip : 0;
+        position.total = limit > 0 ? std::min(limit, available) : available;
+        position.remaining = position.total - std::min(position.total, page.size());
+        CursorManager::Batch batch = cursors_.open(std::move(position), std::move(page));
+        return createCursorResponse("Found " + std::to_string(batch.total) + " document(s)", batch);
+    }
+    
+    // Необязательное неотрицательное целое поле запроса
+    static bool readCount(const JsonValue& request, const std::string& field, size_t& value) {
+        if (!request.hasKey(field)) return true;
+        if (!request[field].isInt() || request[field].asInt() < 0) return false;
+        value = static_cast<size_t>(request[field].asInt());
+        return true;
+    }
+    
     JsonValue createErrorResponse(const std::string& message) {
         return createResponse("error", message);
     }
@@ -91,12 +204,311 @@ private:
         return createResponse("success", message, data);
     }
     
+    // Публикация вставки в журнал изменений; вызывается под блокировкой записи,
+    // поэтому порядок токенов совпадает с порядком применения изменений
+    void recordInsert(const std::string& dbName, const std::string& collectionName,
+                      const JsonValue& document, const std::string& id) {
+        JsonValue stored = document;
+        stored["_id"] = JsonValue(id);
+        changes_.record("insert", dbName, collectionName, stored);
+    }
+    
+    static bool parseResumeToken(const JsonValue& value, uint64_t& sequence) {
+        if (!value.isString()) return false;
+        try {
+            size_t parsed = 0;
+            sequence = std::stoull(value.asString(), &parsed);
+            return parsed == value.asString().size();
+        } catch (...) {
+            return false;
+        }
+    }
+    
+    // Токен подписки содержит идентификатор журнала: после перезапуска
+    // номера изменений начинаются заново и без него старый токен
+    // указывал бы на чужие события
+    std::string watchToken(uint64_t sequence) const {
+        return changes_.logId() + ":" + std::to_string(sequence);
+    }
+    
+    static bool splitWatchToken(const JsonValue& value, std::string& logId, uint64_t& sequence) {
+        if (!value.isString()) return false;
+        const std::string& token = value.asString();
+        size_t colon = token.rfind(':');
+        if (colon == std::string::npos) return false;
+        logId = token.substr(0, colon);
+        return parseResumeToken(JsonValue(token.substr(colon + 1)), sequence);
+    }
+    
+    // Клиент закрыл соединение (проверка без блокировки)
+    static bool clientClosed(int clientSocket) {
+        char probe;
+        ssize_t n = recv(clientSocket, &probe, 1, MSG_PEEK | MSG_DONTWAIT);
+        return n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK);
+    }
+    
+    // Подписка на изменения: соединение остается открытым, сервер отправляет
+    // новые вставки и удаления, подходящие под фильтр query
+    void runWatch(int clientSocket, const JsonValue& request) {
+        if (!request.hasKey("database") || !request["database"].isString()) {
+            sendMessage(clientSocket, createErrorResponse("Missing required field: database"));
+            return;
+        }
+        std::string dbName = request["database"].asString();
+        std::string collectionName = "default";
+        if (request.hasKey("collection") && request["collection"].isString()) {
+            collectionName = request["collection"].asString();
+        }
+        
+        bool hasFilter = request.hasKey("query");
+        JsonValue filter = hasFilter ? request["query"] : JsonValue();
+        if (hasFilter && !filter.isObject()) {
+            sendMessage(clientSocket, createErrorResponse("Invalid 'query' field: must be an object"));
+            return;
+        }
+        
+        uint64_t position = changes_.lastSequence();
+        if (request.hasKey("resume_after")) {
+            std::string logId;
+            if (!splitWatchToken(request["resume_after"], logId, position)) {
+                sendMessage(clientSocket, createErrorResponse("Invalid 'resume_after' token"));
+                return;
+            }
+            if (logId != changes_.logId()) {
+                sendMessage(clientSocket, createErrorResponse("Resume token is from another change log (server restarted)"));
+                return;
+            }
+            if (!changes_.canResumeAfter(position)) {
+                sendMessage(clientSocket, createErrorResponse("Resume token is no longer available"));
+                return;
+            }
+        }
+        
+        JsonValue ack = createSuccessResponse("Watching " + dbName + "." + collectionName);
+        ack["resume_token"] = JsonValue(watchToken(position));
+        sendMessage(clientSocket, ack);
+        
+        while (running_) {
+            if (!changes_.canResumeAfter(position)) {
+                sendMessage(clientSocket, createErrorResponse("Change stream fell behind the change log"));
+                return;
+            }
+            
+            auto events = changes_.waitAfter(position, std::chrono::milliseconds(1000));
+            if (events.empty()) {
+                if (clientClosed(clientSocket)) return;
+                continue;
+            }
+            
+            std::vector<JsonValue> changes;
+            for (const auto& event : events) {
+                if (event.database != dbName || event.collection != collectionName) continue;
+                if (hasFilter && !QueryEvaluator::matches(event.document, filter)) continue;
+                
+                JsonValue change;
+                change["operation"] = JsonValue(event.operation);
+                change["document"] = event.document;
+                change["resume_token"] = JsonValue(watchToken(event.sequence));
+                change["time"] = JsonValue(TimeUtils::formatIso8601(event.time));
+                changes.push_back(change);
+            }
+            position = events.back().sequence;
+            
+            if (!changes.empty()) {
+                JsonValue message = createSuccessResponse("change", changes);
+                message["resume_token"] = JsonValue(watchToken(position));
+                sendMessage(clientSocket, message);
+            }
+        }
+    }
+    
+    JsonValue createStatsResponse() {
+        JsonValue response = createSuccessResponse("Server statistics");
+        JsonValue stats;
+        stats["role"] = JsonValue(follower_ ? "replica" : "primary");
+        stats["log_id"] = JsonValue(changes_.logId());
+        stats["last_token"] = JsonValue(std::to_string(changes_.lastSequence()));
+        stats["open_cursors"] = JsonValue(static_cast<int>(cursors_.openCursors()));
+        stats["retention"] = retention_.status();
+        stats["storage"] = dbManager_.status();
+        stats["locks"] = dbManager_.lockStats();
+        
+        if (follower_) {
+            stats["replication"] = follower_->status();
+        }
+        
+        std::vector<JsonValue> replicas;
+        {
+            std::lock_guard<std::mutex> lock(replicasMutex_);
+            uint64_t head = changes_.lastSequence();
+            for (const auto& [sock, info] : replicas_) {
+                JsonValue replica;
+                replica["address"] = JsonValue(info.address);
+                replica["sent_token"] = JsonValue(std::to_string(info.sentToken));
+                replica["lag_changes"] = JsonValue(static_cast<double>(head > info.sentToken ? head - info.sentToken : 0));
+                replicas.push_back(replica);
+            }
+        }
+        stats["replicas"] = JsonValue(replicas);
+        
+        response["stats"] = stats;
+        return response;
+    }
+    
+    // Коллекции всех баз в рабочем каталоге: <database>/<collection>.json
+    static std::vector<std::pair<std::string, std::string>> listCollections() {
+        namespace fs = std::filesystem;
+        std::vector<std::pair<std::string, std::string>> result;
+        std::error_code ec;
+        for (const auto& dbEntry : fs::directory_iterator(".", ec)) {
+            if (!dbEntry.is_directory()) continue;
+            std::set<std::string> names;
+            for (const auto& file : fs::directory_iterator(dbEntry.path(), ec)) {
+                std::string name = file.path().filename().string();
+                // Коллекция с разбиением по времени - каталог сегментов
+                if (file.is_directory() && fs::exists(file.path() / TimePartition::SPEC_FILE)) {
+                    names.insert(name);
+                    continue;
+                }
+                if (!file.is_regular_file() || file.path().extension() != ".json") continue;
+                if (name.size() > 11 && name.compare(name.size() - 11, 11, "_index.json") == 0) continue;
+                names.insert(file.path().stem().string());
+            }
+            for (const auto& name : names) {
+                result.emplace_back(dbEntry.path().filename().string(), name);
+            }
+        }
+        return result;
+    }
+    
+    void sendSnapshot(int clientSocket) {
+        // Коллекции перечисляются по файлам: новые должны попасть на диск
+        dbManager_.flush();
+        for (const auto& [dbName, collectionName] : listCollections()) {
+            std::vector<JsonValue> docs;
+            dbManager_.executeRead(dbName, collectionName, [&](Database& db) {
+                docs = db.documents();
+            });
+            
+            size_t offset = 0;
+            do {
+                size_t end = std::min(docs.size(), offset + SNAPSHOT_CHUNK);
+                JsonValue message = createSuccessResponse("snapshot",
+                    std::vector<JsonValue>(docs.begin() + offset, docs.begin() + end));
+                message["database"] = JsonValue(dbName);
+                message["collection"] = JsonValue(collectionName);
+                message["reset"] = JsonValue(offset == 0);
+                message["head_token"] = JsonValue(std::to_string(changes_.lastSequence()));
+                sendMessage(clientSocket, message);
+                offset = end;
+            } while (offset < docs.size());
+        }
+    }
+    
+    // Отправка журнала записей ведомому серверу. Если ведомый не может
+    // продолжить с сохраненного токена (новый ведомый, перезапуск ведущего
+    // или журнал уже вытеснен), сначала отправляется полный снимок данных.
+    void runReplicate(int clientSocket, const JsonValue& request) {
+        uint64_t position = 0;
+        bool resumable = request.hasKey("log_id") && request["log_id"].isString() &&
+                         request["log_id"].asString() == changes_.logId() &&
+                         request.hasKey("resume_after") &&
+                         parseResumeToken(request["resume_after"], position) &&
+                         changes_.canResumeAfter(position);
+        
+        if (!resumable) {
+            // Позиция фиксируется до снимка: изменения, попавшие и в снимок,
+            // и в журнал, применяются повторно без последствий
+            position = changes_.lastSequence();
+            sendSnapshot(clientSocket);
+        }
+        
+        JsonValue start = createSuccessResponse(resumable ? "resumed" : "snapshot_done");
+        start["log_id"] = JsonValue(changes_.logId());
+        start["resume_token"] = JsonValue(std::to_string(position));
+        start["head_token"] = JsonValue(std::to_string(changes_.lastSequence()));
+        sendMessage(clientSocket, start);
+        
+        sockaddr_in peer{};
+        socklen_t peerLen = sizeof(peer);
+        getpeername(clientSocket, reinterpret_cast<sockaddr*>(&peer), &peerLen);
+        {
+            std::lock_guard<std::mutex> lock(replicasMutex_);
+            replicas_[clientSocket] = {std::string(inet_ntoa(peer.sin_addr)) + ":" + std::to_string(ntohs(peer.sin_port)), position};
+        }
+        
+        try {
+            while (running_) {
+                if (!changes_.canResumeAfter(position)) {
+                    // Ведомый слишком отстал: он переподключится и получит снимок
+                    sendMessage(clientSocket, createErrorResponse("Replica fell behind the change log"));
+                    break;
+                }
+                
+                auto events = changes_.waitAfter(position, std::chrono::milliseconds(1000));
+                JsonValue message;
+                if (events.empty()) {
+                    message = createSuccessResponse("heartbeat");
+                } else {
+                    std::vector<JsonValue> data;
+                    data.reserve(events.size());
+                    for (const auto& event : events) {
+                        JsonValue change;
+                        change["operation"] = JsonValue(event.operation);
+                        change["database"] = JsonValue(event.database);
+                        change["collection"] = JsonValue(event.collection);
+                        change["document"] = event.document;
+                        change["resume_token"] = JsonValue(std::to_string(event.sequence));
+                        change["time"] = JsonValue(TimeUtils::formatIso8601(event.time));
+                        data.push_back(change);
+                    }
+                    position = events.back().sequence;
+                    message = createSuccessResponse("changes", data);
+                }
+                message["head_token"] = JsonValue(std::to_string(changes_.lastSequence()));
+                sendMessage(clientSocket, message);
+                
+                std::lock_guard<std::mutex> lock(replicasMutex_);
+                replicas_[clientSocket].sentToken = position;
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(replicasMutex_);
+            replicas_.erase(clientSocket);
+            throw;
+        }
+        
+        std::lock_guard<std::mutex> lock(replicasMutex_);
+        replicas_.erase(clientSocket);
+    }
+    
+    // Граница гистограммы: ISO 8601 или секунды эпохи в допустимом интервале
+    static bool parseTimeBound(const JsonValue& value, int64_t& epochSeconds) {
+        return TimePartition::timeValue(value, epochSeconds);
+    }
+    
     JsonValue handleRequest(const JsonValue& request) {
         try {
             if (!request.isObject()) {
                 return createErrorResponse("Invalid request: must be an object");
             }
             
+            if (request.hasKey("operation") && request["operation"].isString() &&
+                request["operation"].asString() == "stats") {
+                return createStatsResponse();
+            }
+            
+            if (request.hasKey("operation") && request["operation"].isString() &&
+                request["operation"].asString() == "listCollections") {
+                std::vector<JsonValue> collections;
+                for (const auto& [dbName, collectionName] : listCollections()) {
+                    JsonValue entry;
+                    entry["database"] = JsonValue(dbName);
+                    entry["collection"] = JsonValue(collectionName);
+                    collections.push_back(entry);
+                }
+                return createSuccessResponse("Found " + std::to_string(collections.size()) + " collection(s)", collections);
+            }
+            
             if (!request.hasKey("database") || !request.hasKey("operation")) {
                 return createErrorResponse("Missing required fields: database, operation");
             }
@@ -121,20 +533,25 @@ private:
                 collectionName = request["collection"].asString();
             }
             
+            if (follower_ && (operation == "insert" || operation == "delete" ||
+                              operation == "partition" || operation == "retention")) {
+                return createErrorResponse("Read-only replica: send writes to primary " + follower_->primaryAddress());
+            }
+            
             if (operation == "insert") {
                 if (!request.hasKey("data")) {
                     return createErrorResponse("Missing 'data' field for insert operation");
                 }
                 
-                JsonValue data = request["data"];
+                const JsonValue& data = request["data"];
                 if (data.isArray()) {
                     // Вставка нескольких документов
-                    auto arr = data.asArray();
+                    const auto& arr = data.asArray();
                     int count = 0;
                     dbManager_.executeWrite(dbName, collectionName, [&](Database& db) {
                         for (const auto& doc : arr) {
                             if (doc.isObject()) {
-                                db.insert(doc);
+                                recordInsert(dbName, collectionName, doc, db.insert(doc));
                                 count++;
                             }
                         }
@@ -143,7 +560,7 @@ private:
                 } else if (data.isObject()) {
                     // Вставка одного документа
                     dbManager_.executeWrite(dbName, collectionName, [&](Database& db) {
-                        db.insert(data);
+                        recordInsert(dbName, collectionName, data, db.insert(data));
                     });
                     return createSuccessResponse("Document inserted successfully");
                 } else {
@@ -155,28 +572,165 @@ private:
                     return createErrorResponse("Missing 'query' field for find operation");
                 }
                 
-                JsonValue query = request["query"];
+                const JsonValue& query = request["query"];
                 std::vector<JsonValue> results;
                 
-                dbManager_.executeRead(dbName, collectionName, [&](Database& db) {
-                    results = db.find(query);
-                });
+                size_t skip = 0, limit = 0, batchSize = 0;
+                if (!readCount(request, "skip", skip) || !readCount(request, "limit", limit) ||
+                    !readCount(request, "batch_size", batchSize)) {
+                    return createErrorResponse("Invalid 'skip', 'limit' or 'batch_size': must be non-negative integers");
+                }
+                
+                if (batchSize > 0 || request.hasKey("after")) {
+                    return findPage(request, dbName, collectionName, skip, limit, batchSize);
+                }
+                
+                if (request.hasKey("sort") || limit > 0) {
+                    // Сортировка и ограничение выполняются конвейером агрегации (top-k)
+                    std::vector<JsonValue> pipeline;
+                    JsonValue match;
+                    match["$match"] = query;
+                    pipeline.push_back(match);
+                    if (request.hasKey("sort")) {
+                        JsonValue sort;
+                        sort["$sort"] = request["sort"];
+                        pipeline.push_back(sort);
+                    }
+                    if (limit > 0) {
+                        JsonValue limitStage;
+                        limitStage["$limit"] = JsonValue(static_cast<int>(skip + limit));
+                        pipeline.push_back(limitStage);
+                    }
+                    dbManager_.executeRead(dbName, collectionName, [&](Database& db) {
+                        results = db.aggregate(JsonValue(pipeline));
+                    });
+                } else {
+                    dbManager_.executeRead(dbName, collectionName, [&](Database& db) {
+                        results = db.find(query);
+                    });
+                }
                 
+                if (skip > 0) {
+                    results.erase(results.begin(), results.begin() + std::min(skip, results.size()));
+                }
                 return createSuccessResponse("Found " + std::to_string(results.size()) + " document(s)", results);
                 
+            } else if (operation == "getMore") {
+                if (!request.hasKey("cursor_id") || !request["cursor_id"].isInt()) {
+                    return createErrorResponse("Missing or invalid 'cursor_id' field for getMore operation");
+                }
+                
+                size_t batchSize = 0;
+                if (!readCount(request, "batch_size", batchSize)) {
+                    return createErrorResponse("Invalid 'batch_size': must be a non-negative integer");
+                }
+                
+                CursorManager::Batch batch;
+                CursorManager::Fetch fetched = cursors_.getMore(request["cursor_id"].asInt(), batchSize, batch,
+                    [&](const CursorManager::Position& position, size_t count) {
+                        std::vector<JsonValue> page;
+                        dbManager_.executeRead(position.database, position.collection, [&](Database& db) {
+                            page = db.findPage(position.query, position.order, &position.after, count);
+                        });
+                        return page;
+                    });
+                if (fetched == CursorManager::Fetch::Busy) {
+                    return createErrorResponse("Cursor is busy with another getMore, retry later");
+                }
+                if (fetched == CursorManager::Fetch::NotFound) {
+                    return createErrorResponse("Cursor not found or expired");
+                }
+                return createCursorResponse("Fetched " + std::to_string(batch.documents.size()) + " document(s)", batch);
+                
+            } else if (operation == "killCursors") {
+                if (!request.hasKey("cursor_id") || !request["cursor_id"].isInt()) {
+                    return createErrorResponse("Missing or invalid 'cursor_id' field for killCursors operation");
+                }
+                
+                bool killed = cursors_.kill(request["cursor_id"].asInt());
+                return createSuccessResponse(killed ? "Cursor closed" : "Cursor not found");
+                
             } else if (operation == "delete") {
                 if (!request.hasKey("query")) {
                     return createErrorResponse("Missing 'query' field for delete operation");
                 }
                 
-                JsonValue query = request["query"];
+                const JsonValue& query = request["query"];
                 int deleted = 0;
                 
                 dbManager_.executeWrite(dbName, collectionName, [&](Database& db) {
-                    deleted = db.remove(query);
+                    std::vector<JsonValue> removed;
+                    deleted = db.remove(query, &removed);
+                    for (const auto& doc : removed) {
+                        changes_.record("delete", dbName, collectionName, doc);
+                    }
                 });
                 
-                return createSuccessResponse("Deleted " + std::to_string(deleted) + " document(s)");
+                JsonValue response = createSuccessResponse("Deleted " + std::to_string(deleted) + " document(s)");
+                response["deleted"] = JsonValue(deleted);
+                return response;
+                
+            } else if (operation == "aggregate") {
+                if (!request.hasKey("pipeline")) {
+                    return createErrorResponse("Missing 'pipeline' field for aggregate operation");
+                }
+                
+                const JsonValue& pipeline = request["pipeline"];
+                if (!pipeline.isArray()) {
+                    return createErrorResponse("Invalid 'pipeline' field: must be an array");
+                }
+                
+                std::vector<JsonValue> results;
+                dbManager_.executeRead(dbName, collectionName, [&](Database& db) {
+                    results = db.aggregate(pipeline);
+                });
+                
+                return createSuccessResponse("Aggregated " + std::to_string(results.size()) + " result(s)", results);
+                
+            } else if (operation == "histogram") {
+                std::string field = "timestamp";
+                if (request.hasKey("field")) {
+                    if (!request["field"].isString()) {
+                        return createErrorResponse("Invalid 'field' field: must be a string");
+                    }
+                    field = request["field"].asString();
+                }
+                
+                int64_t bucketSeconds = 3600;
+                if (request.hasKey("bucket")) {
+                    const JsonValue& bucket = request["bucket"];
+                    bool valid = false;
+                    if (bucket.isInt()) {
+                        bucketSeconds = bucket.asInt();
+                        valid = bucketSeconds > 0;
+                    } else if (bucket.isString()) {
+                        valid = TimeUtils::parseDuration(bucket.asString(), bucketSeconds);
+                    }
+                    if (!valid) {
+                        return createErrorResponse("Invalid 'bucket' field: expected seconds or duration like \"1h\"");
+                    }
+                }
+                
+                int64_t from = std::numeric_limits<int64_t>::min();
+                int64_t to = std::numeric_limits<int64_t>::max();
+                if (request.hasKey("from") && !parseTimeBound(request["from"], from)) {
+                    return createErrorResponse("Invalid 'from' field: expected ISO 8601 time or epoch seconds");
+                }
+                if (request.hasKey("to") && !parseTimeBound(request["to"], to)) {
+                    return createErrorResponse("Invalid 'to' field: expected ISO 8601 time or epoch seconds");
+                }
+                
+                std::string groupBy;
+                if (request.hasKey("group_by") && request["group_by"].isString()) {
+                    groupBy = request["group_by"].asString();
+                }
+                
+                std::vector<JsonValue> results;
+                dbManager_.executeRead(dbName, collectionName, [&](Database& db) {
+                    results = db.histogram(field, bucketSeconds, from, to, groupBy);
+                });
+                
+                return createSuccessResponse("Histogram with " + std::to_string(results.size()) + " bucket(s)", results);
                 
             } else if (operation == "create_index") {
                 if (!request.hasKey("field")) {
@@ -189,11 +743,87 @@ private:
                 } else {
                     return createErrorResponse("Invalid 'field' field: must be a string");
                 }
+                
+                // "hash" (по умолчанию) и "ordered" - индексы значений поля,
+                // "text" - полнотекстовый индекс для $text, "trigram" - для $like
+                std::string type;
+                if (request.hasKey("type")) {
+                    FieldIndex::Type fieldType;
+                    if (!request["type"].isString() ||
+                        (request["type"].asString() != "text" && request["type"].asString() != "trigram" &&
+                         !FieldIndex::parseType(request["type"].asString(), fieldType))) {
+                        return createErrorResponse(
+                            "Invalid 'type' field: expected \"hash\", \"ordered\", \"text\" or \"trigram\"");
+                    }
+                    type = request["type"].asString();
+                }
                 dbManager_.executeWrite(dbName, collectionName, [&](Database& db) {
-                    db.createIndex(field);
+                    db.createIndex(field, type);
                 });
                 
-                return createSuccessResponse("Index created on field: " + field);
+                return createSuccessResponse((type.empty() ? "Index" : type + " index") + " created on field: " + field);
+                
+            } else if (operation == "partition") {
+                std::string field = "timestamp";
+                if (request.hasKey("field")) {
+                    if (!request["field"].isString() || request["field"].asString().empty()) {
+                        return createErrorResponse("Invalid 'field' field: must be a non-empty string");
+                    }
+                    field = request["field"].asString();
+                }
+                
+                int64_t width = 86400;
+                if (request.hasKey("granularity") &&
+                    (!request["granularity"].isString() ||
+                     !TimePartition::parseGranularity(request["granularity"].asString(), width))) {
+                    return createErrorResponse("Invalid 'granularity' field: expected \"hour\" or \"day\"");
+                }
+                
+                size_t segments = 0;
+                dbManager_.executeWrite(dbName, collectionName, [&](Database& db) {
+                    db.partitionBy(field, width);
+                    segments = db.segmentCount();
+                });
+                
+                return createSuccessResponse("Collection partitioned by " + field + " per " +
+                                             TimePartition::granularityName(width) + ", " +
+                                             std::to_string(segments) + " segment(s)");
+                
+            } else if (operation == "retention") {
+                int64_t maxAge = 0;
+                if (request.hasKey("max_age")) {
+                    const JsonValue& age = request["max_age"];
+                    bool valid = false;
+                    if (age.isInt()) {
+                        maxAge = static_cast<int64_t>(age.asDouble());
+                        valid = maxAge >= 0;
+                    } else if (age.isString()) {
+                        valid = TimeUtils::parseDuration(age.asString(), maxAge);
+                    }
+                    if (!valid) {
+                        return createErrorResponse("Invalid 'max_age' field: expected seconds or duration like \"30d\"");
+                    }
+                }
+                
+                int64_t maxDocuments = 0;
+                if (request.hasKey("max_documents")) {
+                    if (!request["max_documents"].isInt() || request["max_documents"].asDouble() < 0) {
+                        return createErrorResponse("Invalid 'max_documents' field: must be a non-negative integer");
+                    }
+                    maxDocuments = static_cast<int64_t>(request["max_documents"].asDouble());
+                }
+                
+                dbManager_.executeWrite(dbName, collectionName, [&](Database& db) {
+                    db.setRetention(maxAge, maxDocuments);
+                });
+                
+                // Политика применяется сразу, дальше - фоновой задачей
+                RetentionWorker::Result dropped = retention_.apply(dbName, collectionName);
+                JsonValue response = createSuccessResponse("Retention policy set, dropped " +
+                                                           std::to_string(dropped.segments) + " segment(s)");
+                response["dropped_segments"] = JsonValue(static_cast<int>(dropped.segments));
+                response["dropped_documents"] = JsonValue(static_cast<int>(dropped.documents));
+                return response;
                 
             } else {
                 return createErrorResponse("Unknown operation: " + operation);
@@ -211,10 +841,23 @@ private:
                 
                 JsonParser parser;
                 JsonValue request = parser.parse(requestStr);
+                
+                if (request.isObject() && request.hasKey("operation") && request["operation"].isString() &&
+                    request["operation"].asString() == "watch") {
+                    // Соединение отдается подписке до отключения клиента
+                    runWatch(clientSocket, request);
+                    break;
+                }
+                
+                if (request.isObject() && request.hasKey("operation") && request["operation"].isString() &&
+                    request["operation"].asString() == "replicate") {
+                    runReplicate(clientSocket, request);
+                    break;
+                }
+                
                 JsonValue response = handleRequest(request);
                 
-                std::string responseStr = response.toString();
-                sendMessage(clientSocket, responseStr);
+                sendMessage(clientSocket, response);
             }
         } catch (const std::exception& e) {
             // Клиент отключился или произошла ошибка
@@ -225,12 +868,20 @@ private:
     }
     
 public:
-    DatabaseServer(int port) : port_(port), serverSocket_(-1), running_(false) {}
+    // appendLog = false - хранение без журнала (см. DatabaseManager)
+    DatabaseServer(int port, bool appendLog = true)
+        : port_(port), serverSocket_(-1), running_(false), dbManager_(1000, appendLog),
+          retention_(dbManager_, changes_, &DatabaseServer::listCollections) {}
     
     ~DatabaseServer() {
         stop();
     }
     
+    // Запуск в режиме ведомого сервера; вызывается до start()
+    void replicateFrom(const std::string& primaryHost, int primaryPort) {
+        follower_ = std::make_unique<ReplicaFollower>(primaryHost, primaryPort, dbManager_, changes_);
+    }
+    
     bool start() {
         serverSocket_ = socket(AF_INET, SOCK_STREAM, 0);
         if (serverSocket_ < 0) {
@@ -264,6 +915,15 @@ public:
         
         running_ = true;
         std::cout << "Database server started on port " << port_ << "\n";
+        dbManager_.start();
+        
+        if (follower_) {
+            std::cout << "Replicating from primary " << follower_->primaryAddress() << "\n";
+            follower_->start();
+        } else {
+            // Ведомый получает удаления по политикам хранения из журнала ведущего
+            retention_.start();
+        }
         
         while (running_) {
             sockaddr_in clientAddress;
@@ -291,6 +951,13 @@ public:
     void stop() {
         if (running_) {
             running_ = false;
+            changes_.notifyAll();
+            retention_.stop();
+            if (follower_) {
+                follower_->stop();
+            }
+            // Несохраненные изменения коллекций записываются на диск
+            dbManager_.stop();
             if (serverSocket_ >= 0) {
                 close(serverSocket_);
             }
@@ -0,0 +1,281 @@
+#ifndef TEXT_INDEX_H
+#define TEXT_INDEX_H
+
+#include "json_parser.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+
+// Полнотекстовый поиск по строковым полям: запрос {"$text": {"$search":
+// "failed \"sudo su\""}} находит документы, где есть все слова, а слова
+// в кавычках идут подряд в одном поле. Регистр ASCII не учитывается.
+namespace TextSearch {
+
+// Слово - последовательность букв, цифр, '_' и байтов UTF-8 вне ASCII
+inline bool isWordByte(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c >= 0x80;
+}
+
+inline void tokenize(const std::string& text, std::vector<std::string>& tokens) {
+    std::string current;
+    for (unsigned char c : text) {
+        if (isWordByte(c)) {
+            current.push_back(c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : static_cast<char>(c));
+        } else if (!current.empty()) {
+            tokens.push_back(std::move(current));
+            current.clear();
+        }
+    }
+    if (!current.empty()) {
+        tokens.push_back(std::move(current));
+    }
+}
+
+// Запрос - список фраз; отдельное слово - фраза из одного слова
+struct Query {
+    std::vector<std::vector<std::string>> phrases;
+
+    bool empty() const { return phrases.empty(); }
+};
+
+inline Query parseQuery(const std::string& search) {
+    Query query;
+    size_t pos = 0;
+    while (pos < search.size()) {
+        size_t quote = search.find('"', pos);
+        std::vector<std::string> words;
+        tokenize(search.substr(pos, quote == std::string::npos ? std::string::npos : quote - pos), words);
+        for (auto& word : words) {
+            query.phrases.push_back({std::move(word)});
+        }
+        if (quote == std::string::npos) break;
+
+        size_t close = search.find('"', quote + 1);
+        std::vector<std::string> phrase;
+        tokenize(search.substr(quote + 1, close == std::string::npos ? std::string::npos : close - quote - 1), phrase);
+        if (!phrase.empty()) {
+            query.phrases.push_back(std::move(phrase));
+        }
+        pos = close == std::string::npos ? search.size() : close + 1;
+    }
+    return query;
+}
+
+// Строка поиска из условия $text; false, если условие некорректно
+inline bool searchString(const JsonValue& condition, std::string& search) {
+    if (!condition.isObject() || !condition.hasKey("$search") || !condition["$search"].isString()) {
+        return false;
+    }
+    search = condition["$search"].asString();
+    return true;
+}
+
+inline bool containsPhrase(const std::vector<std::string>& tokens, const std::vector<std::string>& phrase) {
+    if (phrase.size() > tokens.size()) return false;
+    for (size_t i = 0; i + phrase.size() <= tokens.size(); ++i) {
+        if (std::equal(phrase.begin(), phrase.end(), tokens.begin() + i)) return true;
+    }
+    return false;
+}
+
+// Проверка документа без индекса: каждая фраза есть хотя бы в одном из
+// полей fields (пустой список - все строковые поля верхнего уровня)
+inline bool matches(const JsonValue& doc, const Query& query, const std::vector<std::string>& fields = {}) {
+    if (query.empty() || !doc.isObject()) return false;
+
+    std::vector<std::vector<std::string>> fieldTokens;
+    auto addField = [&](const JsonValue& value) {
+        if (!value.isString()) return;
+        fieldTokens.emplace_back();
+        tokenize(value.asString(), fieldTokens.back());
+    };
+    if (fields.empty()) {
+        for (const auto& [name, value] : doc.asObject()) {
+            addField(value);
+        }
+    } else {
+        for (const auto& field : fields) {
+            if (doc.hasKey(field)) addField(doc[field]);
+        }
+    }
+
+    for (const auto& phrase : query.phrases) {
+        bool found = false;
+        for (const auto& tokens : fieldTokens) {
+            if (containsPhrase(tokens, phrase)) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) return false;
+    }
+    return true;
+}
+
+} // namespace TextSearch
+
+// Инвертированный индекс по заданным строковым полям. Для каждого слова
+// хранится список вхождений (номер документа, поле и позиция слова),
+// упорядоченный по номеру документа: пересечение списков дает документы
+// со всеми словами, позиции - проверку фраз без чтения документов.
+class TextIndex {
+private:
+    struct Posting {
+        uint32_t doc;
+        uint32_t position;  // номер поля в старших 8 битах, номер слова - в младших 24
+    };
+
+    static constexpr uint32_t MAX_POSITION = (1u << 24) - 1;
+
+    std::vector<std::string> fields_;
+    std::unordered_map<std::string, std::vector<Posting>> postings_;
+    std::vector<std::string> ids_;                    // номер документа -> _id
+    std::vector<bool> live_;
+    std::unordered_map<std::string, uint32_t> numbers_;  // _id -> номер живого документа
+    size_t dead_ = 0;
+
+    // Вхождения слова в документ doc (подряд, так как списки упорядочены)
+    static std::pair<std::vector<Posting>::const_iterator, std::vector<Posting>::const_iterator>
+    occurrences(const std::vector<Posting>& list, uint32_t doc) {
+        auto first = std::lower_bound(list.begin(), list.end(), doc,
+                                      [](const Posting& p, uint32_t d) { return p.doc < d; });
+        auto last = first;
+        while (last != list.end() && last->doc == doc) ++last;
+        return {first, last};
+    }
+
+    bool hasPhrase(uint32_t doc, const std::vector<const std::vector<Posting>*>& lists) const {
+        auto [begin, end] = occurrences(*lists[0], doc);
+        for (auto it = begin; it != end; ++it) {
+            bool all = true;
+            for (size_t i = 1; i < lists.size() && all; ++i) {
+                auto [first, last] = occurrences(*lists[i], doc);
+                uint32_t expected = it->position + static_cast<uint32_t>(i);
+                all = std::any_of(first, last, [&](const Posting& p) { return p.position == expected; });
+            }
+            if (all) return true;
+        }
+        return false;
+    }
+
+    // Удаленные документы выбрасываются из списков, номера уплотняются
+    void compact() {
+        std::vector<uint32_t> renumber(ids_.size());
+        std::vector<std::string> ids;
+        for (uint32_t doc = 0; doc < ids_.size(); ++doc) {
+            if (!live_[doc]) continue;
+            renumber[doc] = static_cast<uint32_t>(ids.size());
+            numbers_[ids_[doc]] = renumber[doc];
+            ids.push_back(std::move(ids_[doc]));
+        }
+
+        for (auto it = postings_.begin(); it != postings_.end();) {
+            std::vector<Posting> kept;
+            for (const auto& posting : it->second) {
+                if (live_[posting.doc]) kept.push_back({renumber[posting.doc], posting.position});
+            }
+            if (kept.empty()) {
+                it = postings_.erase(it);
+            } else {
+                it->second = std::move(kept);
+                ++it;
+            }
+        }
+
+        ids_ = std::move(ids);
+        live_.assign(ids_.size(), true);
+        dead_ = 0;
+    }
+
+public:
+    explicit TextIndex(std::vector<std::string> fields) : fields_(std::move(fields)) {}
+
+    const std::vector<std::string>& fields() const {
+        return fields_;
+    }
+
+    size_t size() const {
+        return numbers_.size();
+    }
+
+    void add(const std::string& id, const JsonValue& doc) {
+        remove(id);
+
+        uint32_t number = static_cast<uint32_t>(ids_.size());
+        ids_.push_back(id);
+        live_.push_back(true);
+        numbers_[id] = number;
+
+        std::vector<std::string> tokens;
+        for (size_t field = 0; field < fields_.size() && field < 256; ++field) {
+            if (!doc.hasKey(fields_[field]) || !doc[fields_[field]].isString()) continue;
+            tokens.clear();
+            TextSearch::tokenize(doc[fields_[field]].asString(), tokens);
+            for (size_t i = 0; i < tokens.size() && i <= MAX_POSITION; ++i) {
+                uint32_t position = static_cast<uint32_t>(field << 24) | static_cast<uint32_t>(i);
+                postings_[tokens[i]].push_back({number, position});
+            }
+        }
+    }
+
+    void remove(const std::string& id) {
+        auto it = numbers_.find(id);
+        if (it == numbers_.end()) return;
+        live_[it->second] = false;
+        numbers_.erase(it);
+        dead_++;
+        if (dead_ > 1024 && dead_ > numbers_.size()) {
+            compact();
+        }
+    }
+
+    // _id документов, где есть все фразы запроса в индексированных полях
+    std::vector<std::string> search(const TextSearch::Query& query) const {
+        std::vector<std::string> result;
+        if (query.empty()) return result;
+
+        // Списки вхождений фраз; слово без вхождений - пустой результат
+        std::vector<std::vector<const std::vector<Posting>*>> phraseLists;
+        const std::vector<Posting>* shortest = nullptr;
+        for (const auto& phrase : query.phrases) {
+            std::vector<const std::vector<Posting>*> lists;
+            for (const auto& word : phrase) {
+                auto found = postings_.find(word);
+                if (found == postings_.end()) return result;
+                lists.push_back(&found->second);
+                if (!shortest || found->second.size() < shortest->size()) {
+                    shortest = &found->second;
+                }
+            }
+            phraseLists.push_back(std::move(lists));
+        }
+
+        // Кандидаты - документы самого редкого слова, остальные слова и
+        // фразы проверяются двоичным поиском по их спискам
+        uint32_t previous = UINT32_MAX;
+        for (const auto& posting : *shortest) {
+            uint32_t doc = posting.doc;
+            if (doc == previous || !live_[doc]) continue;
+            previous = doc;
+
+            bool all = true;
+            for (const auto& lists : phraseLists) {
+                if (lists.size() == 1) {
+                    auto [first, last] = occurrences(*lists[0], doc);
+                    all = first != last;
+                } else {
+                    all = hasPhrase(doc, lists);
+                }
+                if (!all) break;
+            }
+            if (all) {
+                result.push_back(ids_[doc]);
+            }
+        }
+        return result;
+    }
+};
+
+#endif // TEXT_INDEX_H
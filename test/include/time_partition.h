@@ -0,0 +1,258 @@
+#ifndef TIME_PARTITION_H
+#define TIME_PARTITION_H
+
+#include "json_parser.h"
+#include "time_utils.h"
+#include <string>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+// Разбиение коллекции по времени: документы раскладываются по сегментам
+// (файлам) на час или сутки по значению поля времени, запрос с границами
+// по этому полю открывает только пересекающиеся с ними сегменты.
+namespace TimePartition {
+
+// Ключ сегмента документов без распознаваемого времени (и единственного
+// сегмента коллекции без разбиения)
+constexpr int64_t UNTIMED = std::numeric_limits<int64_t>::min();
+
+constexpr const char* SPEC_FILE = "_partition.json";
+
+struct Spec {
+    std::string field;
+    int64_t width = 0;  // 3600 или 86400; 0 - коллекция без разбиения
+    
+    // Политика хранения; 0 - ограничения нет
+    int64_t maxAge = 0;         // секунды от текущего момента
+    int64_t maxDocuments = 0;
+    
+    bool hasRetention() const { return maxAge > 0 || maxDocuments > 0; }
+};
+
+// Замкнутый интервал времени [from, to] в секундах эпохи
+struct Range {
+    int64_t from = std::numeric_limits<int64_t>::min();
+    int64_t to = std::numeric_limits<int64_t>::max();
+
+    bool empty() const { return from > to; }
+
+    bool overlaps(int64_t start, int64_t width) const {
+        return !empty() && start <= to && start + (width - 1) >= from;
+    }
+
+    static Range none() {
+        Range range;
+        range.from = std::numeric_limits<int64_t>::max();
+        range.to = std::numeric_limits<int64_t>::min();
+        return range;
+    }
+
+    Range intersect(const Range& other) const {
+        Range range;
+        range.from = std::max(from, other.from);
+        range.to = std::min(to, other.to);
+        return range;
+    }
+
+    Range unite(const Range& other) const {
+        if (empty()) return other;
+        if (other.empty()) return *this;
+        Range range;
+        range.from = std::min(from, other.from);
+        range.to = std::max(to, other.to);
+        return range;
+    }
+};
+
+inline bool parseGranularity(const std::string& name, int64_t& width) {
+    if (name == "hour") width = 3600;
+    else if (name == "day") width = 86400;
+    else return false;
+    return true;
+}
+
+inline std::string granularityName(int64_t width) {
+    return width == 3600 ? "hour" : "day";
+}
+
+// Допустимые секунды эпохи: годы 0001-9999, которые записываются в ISO 8601
+constexpr int64_t MIN_TIME = -62135596800;
+constexpr int64_t MAX_TIME = 253402300799;
+
+// Время из значения поля: строка ISO 8601 или секунды эпохи. Число вне
+// MIN_TIME..MAX_TIME (и не число вовсе) временем не считается: его
+// приведение к int64_t было бы неопределенным поведением.
+inline bool timeValue(const JsonValue& value, int64_t& epochSeconds) {
+    if (value.isString()) {
+        return TimeUtils::parseIso8601(value.asString(), epochSeconds);
+    }
+    if (value.isInt()) {
+        double seconds = value.asDouble();
+        if (!(seconds >= static_cast<double>(MIN_TIME) && seconds <= static_cast<double>(MAX_TIME))) {
+            return false;
+        }
+        epochSeconds = static_cast<int64_t>(seconds);
+        return true;
+    }
+    return false;
+}
+
+// Имя файла сегмента: "2025-12-29" для суток, "2025-12-29T14" для часа
+inline std::string segmentName(int64_t start, int64_t width) {
+    if (start == UNTIMED) return "untimed";
+    return TimeUtils::formatIso8601(start).substr(0, width == 3600 ? 13 : 10);
+}
+
+inline bool parseSegmentName(const std::string& name, int64_t width, int64_t& start) {
+    if (name == "untimed") {
+        start = UNTIMED;
+        return true;
+    }
+    if (name.size() != (width == 3600 ? 13u : 10u)) return false;
+    std::string iso = width == 3600 ? name + ":00:00Z" : name;
+    return TimeUtils::parseIso8601(iso, start);
+}
+
+// Границы времени из условия на поле: {"$gte": a, "$lt": b}, $eq, $in
+// или простое равенство. Неизвестные операторы границ не сужают.
+inline Range conditionRange(const JsonValue& condition) {
+    Range range;
+    int64_t ts;
+
+    if (!condition.isObject()) {
+        if (timeValue(condition, ts)) {
+            range.from = range.to = ts;
+        }
+        return range;
+    }
+
+    for (const auto& [op, value] : condition.asObject()) {
+        if (op == "$in" && value.isArray()) {
+            Range any = Range::none();
+            bool allTimes = true;
+            for (const auto& item : value.asArray()) {
+                if (!timeValue(item, ts)) {
+                    allTimes = false;
+                    break;
+                }
+                Range point;
+                point.from = point.to = ts;
+                any = any.unite(point);
+            }
+            if (allTimes) range = range.intersect(any);
+            continue;
+        }
+        if (!timeValue(value, ts)) continue;
+
+        // Строгие границы не сужаются на секунду: доли секунды при разборе
+        // времени отбрасываются
+        Range bound;
+        if (op == "$gt" || op == "$gte") {
+            bound.from = ts;
+        } else if (op == "$lt" || op == "$lte") {
+            bound.to = ts;
+        } else if (op == "$eq") {
+            bound.from = bound.to = ts;
+        }
+        range = range.intersect(bound);
+    }
+    return range;
+}
+
+// Границы времени запроса по полю field. Разбор повторяет порядок
+// QueryEvaluator: $or объединяет границы ветвей, $and - пересекает.
+inline Range queryRange(const JsonValue& query, const std::string& field) {
+    Range range;
+    if (!query.isObject()) return range;
+
+    if (query.hasKey("$or") && query["$or"].isArray()) {
+        Range any = Range::none();
+        for (const auto& clause : query["$or"].asArray()) {
+            any = any.unite(queryRange(clause, field));
+        }
+        return any;
+    }
+
+    if (query.hasKey("$and") && query["$and"].isArray()) {
+        for (const auto& clause : query["$and"].asArray()) {
+            range = range.intersect(queryRange(clause, field));
+        }
+        return range;
+    }
+
+    if (query.hasKey(field)) {
+        range = conditionRange(query[field]);
+    }
+    return range;
+}
+
+// Число документов в файле сегмента без разбора JSON: сегмент пишется
+// по документу в строке между строками "{" и "}"
+inline size_t countSegmentDocuments(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return 0;
+
+    size_t lines = 0;
+    char buffer[64 * 1024];
+    while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) {
+        lines += static_cast<size_t>(std::count(buffer, buffer + file.gcount(), '\n'));
+    }
+    return lines >= 2 ? lines - 2 : 0;
+}
+
+// Настройка разбиения хранится в каталоге сегментов коллекции
+inline bool readSpec(const std::filesystem::path& dir, Spec& spec) {
+    std::ifstream file(dir / SPEC_FILE);
+    if (!file.is_open()) return false;
+
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    try {
+        JsonParser parser;
+        JsonValue config = parser.parse(buffer.str());
+        if (!config.hasKey("field") || !config["field"].isString() ||
+            !config.hasKey("granularity") || !config["granularity"].isString()) {
+            return false;
+        }
+        spec.field = config["field"].asString();
+        if (config.hasKey("retention") && config["retention"].isObject()) {
+            const JsonValue& retention = config["retention"];
+            if (retention.hasKey("max_age") && retention["max_age"].isInt()) {
+                spec.maxAge = static_cast<int64_t>(retention["max_age"].asDouble());
+            }
+            if (retention.hasKey("max_documents") && retention["max_documents"].isInt()) {
+                spec.maxDocuments = static_cast<int64_t>(retention["max_documents"].asDouble());
+            }
+        }
+        return parseGranularity(config["granularity"].asString(), spec.width);
+    } catch (...) {
+        return false;
+    }
+}
+
+inline void writeSpec(const std::filesystem::path& dir, const Spec& spec) {
+    std::filesystem::create_directories(dir);
+    JsonValue config;
+    config["field"] = JsonValue(spec.field);
+    config["granularity"] = JsonValue(granularityName(spec.width));
+    if (spec.hasRetention()) {
+        JsonValue retention;
+        retention["max_age"] = JsonValue(static_cast<double>(spec.maxAge));
+        retention["max_documents"] = JsonValue(static_cast<double>(spec.maxDocuments));
+        config["retention"] = retention;
+    }
+
+    std::ofstream file(dir / SPEC_FILE);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot write partition config in " + dir.string());
+    }
+    file << config.toString() << "\n";
+}
+
+} // namespace TimePartition
+
+#endif // TIME_PARTITION_H
@@ -0,0 +1,141 @@
+#ifndef TIME_UTILS_H
+#define TIME_UTILS_H
+
+#include <string>
+#include <cstdint>
+#include <cstdio>
+#include <cctype>
+
+namespace TimeUtils {
+
+// Количество дней от 1970-01-01 до даты по григорианскому календарю
+inline int64_t daysFromCivil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+inline void civilFromDays(int64_t z, int64_t& y, unsigned& m, unsigned& d) {
+    z += 719468;
+    const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = static_cast<int64_t>(yoe) + era * 400 + (m <= 2);
+}
+
+// Разбор ISO 8601: "YYYY-MM-DD[THH:MM[:SS[.fff]]][Z|+HH:MM|-HH:MM]".
+// Возвращает секунды с начала эпохи (UTC); false, если формат не распознан.
+inline bool parseIso8601(const std::string& text, int64_t& epochSeconds) {
+    auto readNumber = [&](size_t pos, size_t len, int& out) {
+        if (pos + len > text.size()) return false;
+        out = 0;
+        for (size_t i = pos; i < pos + len; ++i) {
+            if (!std::isdigit(static_cast<unsigned char>(text[i]))) return false;
+            out = out * 10 + (text[i] - '0');
+        }
+        return true;
+    };
+
+    int year, month, day, hour = 0, minute = 0, second = 0;
+    if (!readNumber(0, 4, year) || text.size() < 10 || text[4] != '-' ||
+        !readNumber(5, 2, month) || text[7] != '-' || !readNumber(8, 2, day)) {
+        return false;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > 31) return false;
+
+    size_t pos = 10;
+    if (pos < text.size() && (text[pos] == 'T' || text[pos] == ' ')) {
+        if (!readNumber(pos + 1, 2, hour) || pos + 3 >= text.size() || text[pos + 3] != ':' ||
+            !readNumber(pos + 4, 2, minute)) {
+            return false;
+        }
+        pos += 6;
+        if (pos < text.size() && text[pos] == ':') {
+            if (!readNumber(pos + 1, 2, second)) return false;
+            pos += 3;
+        }
+        if (pos < text.size() && text[pos] == '.') {
+            pos++;
+            while (pos < text.size() && std::isdigit(static_cast<unsigned char>(text[pos]))) pos++;
+        }
+    }
+
+    int64_t offset = 0;
+    if (pos < text.size()) {
+        char c = text[pos];
+        if (c == 'Z' || c == 'z') {
+            pos++;
+        } else if (c == '+' || c == '-') {
+            int offHour, offMinute = 0;
+            if (!readNumber(pos + 1, 2, offHour)) return false;
+            size_t minutePos = pos + 3;
+            if (minutePos < text.size() && text[minutePos] == ':') minutePos++;
+            if (minutePos < text.size() && !readNumber(minutePos, 2, offMinute)) return false;
+            offset = (offHour * 3600 + offMinute * 60) * (c == '+' ? 1 : -1);
+            pos = minutePos < text.size() ? minutePos + 2 : minutePos;
+        }
+    }
+    if (pos != text.size()) return false;
+
+    epochSeconds = daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second - offset;
+    return true;
+}
+
+// Форматирование секунд эпохи в "YYYY-MM-DDTHH:MM:SSZ"
+inline std::string formatIso8601(int64_t epochSeconds) {
+    int64_t days = epochSeconds / 86400;
+    int64_t rem = epochSeconds % 86400;
+    if (rem < 0) {
+        rem += 86400;
+        days--;
+    }
+
+    int64_t year;
+    unsigned month, day;
+    civilFromDays(days, year, month, day);
+
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%04lld-%02u-%02uT%02d:%02d:%02dZ",
+                  static_cast<long long>(year), month, day,
+                  static_cast<int>(rem / 3600), static_cast<int>(rem % 3600 / 60), static_cast<int>(rem % 60));
+    return buf;
+}
+
+// Длительность: число секунд или строка вида "30s", "15m", "1h", "1d"
+inline bool parseDuration(const std::string& text, int64_t& seconds) {
+    if (text.empty()) return false;
+
+    size_t unitPos = 0;
+    int64_t value = 0;
+    while (unitPos < text.size() && std::isdigit(static_cast<unsigned char>(text[unitPos]))) {
+        value = value * 10 + (text[unitPos] - '0');
+        unitPos++;
+    }
+    if (unitPos == 0) return false;
+
+    std::string unit = text.substr(unitPos);
+    if (unit.empty() || unit == "s") seconds = value;
+    else if (unit == "m") seconds = value * 60;
+    else if (unit == "h") seconds = value * 3600;
+    else if (unit == "d") seconds = value * 86400;
+    else return false;
+
+    return seconds > 0;
+}
+
+// Начало интервала шириной width, в который попадает момент epochSeconds
+inline int64_t bucketStart(int64_t epochSeconds, int64_t width) {
+    int64_t start = epochSeconds - epochSeconds % width;
+    return epochSeconds < 0 && epochSeconds % width != 0 ? start - width : start;
+}
+
+} // namespace TimeUtils
+
+#endif // TIME_UTILS_H
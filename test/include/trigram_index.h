@@ -0,0 +1,186 @@
+#ifndef TRIGRAM_INDEX_H
+#define TRIGRAM_INDEX_H
+
+#include "json_parser.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+
+// Индекс триграмм для условий $like: для каждой тройки подряд идущих
+// байтов значения поля (без учета регистра ASCII) хранится список
+// документов. Значение дополняется маркерами начала и конца, поэтому
+// шаблон 'sudo%' использует и привязку к началу строки. Шаблон сужается
+// до документов, содержащих все его триграммы; окончательно условие
+// проверяет QueryEvaluator.
+class TrigramIndex {
+private:
+    static constexpr char BEGIN = '\x01';
+    static constexpr char END = '\x02';
+
+    std::vector<std::string> fields_;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> postings_;  // поле и триграмма -> номера документов
+    std::vector<std::string> ids_;                    // номер документа -> _id
+    std::vector<bool> live_;
+    std::unordered_map<std::string, uint32_t> numbers_;  // _id -> номер живого документа
+    size_t dead_ = 0;
+
+    static char lower(char c) {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    // Ключ: номер поля в старшем байте, три байта триграммы - в младших
+    static uint32_t key(size_t field, const std::string& text, size_t pos) {
+        return static_cast<uint32_t>(field) << 24 |
+               static_cast<uint32_t>(static_cast<unsigned char>(text[pos])) << 16 |
+               static_cast<uint32_t>(static_cast<unsigned char>(text[pos + 1])) << 8 |
+               static_cast<uint32_t>(static_cast<unsigned char>(text[pos + 2]));
+    }
+
+    // Триграммы шаблона: из кусков без '%' и '_', с маркером начала или
+    // конца, если кусок стоит на краю шаблона
+    static std::vector<std::string> patternRuns(const std::string& pattern) {
+        std::vector<std::string> runs;
+        std::string run;
+        bool atStart = true;
+        for (char c : pattern) {
+            if (c == '%' || c == '_') {
+                if (!run.empty()) runs.push_back(std::move(run));
+                run.clear();
+                atStart = false;
+                continue;
+            }
+            if (run.empty() && atStart) run.push_back(BEGIN);
+            run.push_back(lower(c));
+            atStart = false;
+        }
+        if (!run.empty()) {
+            run.push_back(END);
+            runs.push_back(std::move(run));
+        }
+        return runs;
+    }
+
+    int fieldNumber(const std::string& field) const {
+        auto it = std::find(fields_.begin(), fields_.end(), field);
+        return it == fields_.end() ? -1 : static_cast<int>(it - fields_.begin());
+    }
+
+    void compact() {
+        std::vector<uint32_t> renumber(ids_.size());
+        std::vector<std::string> ids;
+        for (uint32_t doc = 0; doc < ids_.size(); ++doc) {
+            if (!live_[doc]) continue;
+            renumber[doc] = static_cast<uint32_t>(ids.size());
+            numbers_[ids_[doc]] = renumber[doc];
+            ids.push_back(std::move(ids_[doc]));
+        }
+
+        for (auto it = postings_.begin(); it != postings_.end();) {
+            std::vector<uint32_t> kept;
+            for (uint32_t doc : it->second) {
+                if (live_[doc]) kept.push_back(renumber[doc]);
+            }
+            if (kept.empty()) {
+                it = postings_.erase(it);
+            } else {
+                it->second = std::move(kept);
+                ++it;
+            }
+        }
+
+        ids_ = std::move(ids);
+        live_.assign(ids_.size(), true);
+        dead_ = 0;
+    }
+
+public:
+    explicit TrigramIndex(std::vector<std::string> fields) : fields_(std::move(fields)) {
+        if (fields_.size() > 256) fields_.resize(256);
+    }
+
+    bool indexes(const std::string& field) const {
+        return fieldNumber(field) >= 0;
+    }
+
+    // Шаблон содержит хотя бы одну триграмму и может сузить поиск
+    static bool selective(const std::string& pattern) {
+        for (const auto& run : patternRuns(pattern)) {
+            if (run.size() >= 3) return true;
+        }
+        return false;
+    }
+
+    void add(const std::string& id, const JsonValue& doc) {
+        remove(id);
+
+        uint32_t number = static_cast<uint32_t>(ids_.size());
+        ids_.push_back(id);
+        live_.push_back(true);
+        numbers_[id] = number;
+
+        for (size_t field = 0; field < fields_.size(); ++field) {
+            if (!doc.hasKey(fields_[field]) || !doc[fields_[field]].isString()) continue;
+            const std::string& value = doc[fields_[field]].asString();
+
+            std::string text;
+            text.reserve(value.size() + 2);
+            text.push_back(BEGIN);
+            for (char c : value) text.push_back(lower(c));
+            text.push_back(END);
+
+            for (size_t i = 0; i + 3 <= text.size(); ++i) {
+                std::vector<uint32_t>& list = postings_[key(field, text, i)];
+                if (list.empty() || list.back() != number) {
+                    list.push_back(number);
+                }
+            }
+        }
+    }
+
+    void remove(const std::string& id) {
+        auto it = numbers_.find(id);
+        if (it == numbers_.end()) return;
+        live_[it->second] = false;
+        numbers_.erase(it);
+        dead_++;
+        if (dead_ > 1024 && dead_ > numbers_.size()) {
+            compact();
+        }
+    }
+
+    // _id документов, в значении поля которых есть все триграммы шаблона.
+    // false - поле не индексировано или в шаблоне нет триграмм.
+    bool candidates(const std::string& field, const std::string& pattern, std::vector<std::string>& ids) const {
+        int number = fieldNumber(field);
+        if (number < 0 || !selective(pattern)) return false;
+
+        std::vector<const std::vector<uint32_t>*> lists;
+        for (const auto& run : patternRuns(pattern)) {
+            for (size_t i = 0; i + 3 <= run.size(); ++i) {
+                auto found = postings_.find(key(static_cast<size_t>(number), run, i));
+                if (found == postings_.end()) {
+                    ids.clear();
+                    return true;
+                }
+                lists.push_back(&found->second);
+            }
+        }
+
+        // Пересечение от самого короткого списка двоичным поиском в остальных
+        std::sort(lists.begin(), lists.end(), [](const auto* a, const auto* b) { return a->size() < b->size(); });
+        ids.clear();
+        for (uint32_t doc : *lists[0]) {
+            if (!live_[doc]) continue;
+            bool all = true;
+            for (size_t i = 1; i < lists.size() && all; ++i) {
+                all = std::binary_search(lists[i]->begin(), lists[i]->end(), doc);
+            }
+            if (all) ids.push_back(ids_[doc]);
+        }
+        return true;
+    }
+};
+
+#endif // TRIGRAM_INDEX_H
@@ -119,7 +119,7 @@ private:
         std::cout << "[" << status << "] " << message << "\n";
         
         if (response.hasKey("data") && response["data"].isArray()) {
-            auto data = response["data"].asArray();
+            const auto& data = response["data"].asArray();
             if (!data.empty()) {
                 std::cout << "\nDocuments:\n";
                 for (size_t i = 0; i < data.size(); ++i) {
@@ -135,7 +135,7 @@ private:
         std::string indentStr(indent * 2, ' ');
         
         if (json.isObject()) {
-            auto obj = json.asObject();
+            const auto& obj = json.asObject();
             std::cout << "{\n";
             bool first = true;
             for (const auto& [key, value] : obj) {
@@ -151,7 +151,7 @@ private:
             }
             std::cout << "\n" << indentStr << "}";
         } else if (json.isArray()) {
-            auto arr = json.asArray();
+            const auto& arr = json.asArray();
             std::cout << "[\n";
             for (size_t i = 0; i < arr.size(); ++i) {
                 if (i > 0) std::cout << ",\n";
@@ -228,7 +228,7 @@ public:
     void runInteractive() {
         std::cout << "Connected to database server at " << host_ << ":" << port_ << "\n";
         std::cout << "Database: " << database_ << "\n";
-        std::cout << "Enter commands (INSERT, FIND, DELETE, CREATE_INDEX) or 'exit' to quit\n";
+        std::cout << "Enter commands (INSERT, FIND, DELETE, AGGREGATE, HISTOGRAM, CREATE_INDEX, PARTITION, RETENTION) or 'exit' to quit\n";
         std::cout << "Example: INSERT users {\"name\": \"Alice\", \"age\": 25}\n";
         std::cout << "> ";
         
@@ -298,9 +298,46 @@ public:
                     JsonValue response = executeRequest(request);
                     printResponse(response);
                     
+                } else if (command == "AGGREGATE") {
+                    if (tokens.size() < 3) {
+                        std::cout << "Usage: AGGREGATE <collection> <json_pipeline>\n";
+                        std::cout << "> ";
+                        continue;
+                    }
+                    
+                    std::string collection = tokens[1];
+                    std::string jsonStr = tokens[2];
+                    
+                    JsonValue request = buildRequest("aggregate", collection);
+                    request["pipeline"] = parseJsonFromString(jsonStr);
+                    JsonValue response = executeRequest(request);
+                    printResponse(response);
+                    
+                } else if (command == "HISTOGRAM") {
+                    if (tokens.size() < 3) {
+                        std::cout << "Usage: HISTOGRAM <collection> <json_options>\n";
+                        std::cout << "> ";
+                        continue;
+                    }
+                    
+                    std::string collection = tokens[1];
+                    JsonValue options = parseJsonFromString(tokens[2]);
+                    if (!options.isObject()) {
+                        std::cout << "Options must be a JSON object\n";
+                        std::cout << "> ";
+                        continue;
+                    }
+                    
+                    JsonValue request = buildRequest("histogram", collection);
+                    for (const auto& [key, value] : options.asObject()) {
+                        request[key] = value;
+                    }
+                    JsonValue response = executeRequest(request);
+                    printResponse(response);
+                    
                 } else if (command == "CREATE_INDEX") {
                     if (tokens.size() < 3) {
-                        std::cout << "Usage: CREATE_INDEX <collection> <field>\n";
+                        std::cout << "Usage: CREATE_INDEX <collection> <field> [hash|ordered|text|trigram]\n";
                         std::cout << "> ";
                         continue;
                     }
@@ -313,13 +350,50 @@ public:
                     request["operation"] = JsonValue("create_index");
                     request["collection"] = JsonValue(collection);
                     request["field"] = JsonValue(field);
+                    if (tokens.size() > 3) {
+                        request["type"] = JsonValue(tokens[3]);
+                    }
+                    
+                    JsonValue response = executeRequest(request);
+                    printResponse(response);
+                    
+                } else if (command == "PARTITION") {
+                    if (tokens.size() < 3) {
+                        std::cout << "Usage: PARTITION <collection> <field> [hour|day]\n";
+                        std::cout << "> ";
+                        continue;
+                    }
                     
+                    JsonValue request = buildRequest("partition", tokens[1]);
+                    request["field"] = JsonValue(tokens[2]);
+                    request["granularity"] = JsonValue(tokens.size() > 3 ? tokens[3] : std::string("day"));
+                    JsonValue response = executeRequest(request);
+                    printResponse(response);
+                    
+                } else if (command == "RETENTION") {
+                    if (tokens.size() < 3) {
+                        std::cout << "Usage: RETENTION <collection> <json_policy>\n";
+                        std::cout << "> ";
+                        continue;
+                    }
+                    
+                    JsonValue policy = parseJsonFromString(tokens[2]);
+                    if (!policy.isObject()) {
+                        std::cout << "Policy must be a JSON object\n";
+                        std::cout << "> ";
+                        continue;
+                    }
+                    
+                    JsonValue request = buildRequest("retention", tokens[1]);
+                    for (const auto& [key, value] : policy.asObject()) {
+                        request[key] = value;
+                    }
                     JsonValue response = executeRequest(request);
                     printResponse(response);
                     
                 } else {
                     std::cout << "Unknown command: " << command << "\n";
-                    std::cout << "Available commands: INSERT, FIND, DELETE, CREATE_INDEX\n";
+                    std::cout << "Available commands: INSERT, FIND, DELETE, AGGREGATE, HISTOGRAM, CREATE_INDEX, PARTITION, RETENTION\n";
                 }
                 
             } catch (const std::exception& e) {
@@ -374,6 +448,8 @@ void printUsage(const char* programName) {
     std::cout << "  INSERT <collection> <json>    Insert document\n";
     std::cout << "  FIND <collection> <json>      Find documents\n";
     std::cout << "  DELETE <collection> <json>    Delete documents\n";
+    std::cout << "  AGGREGATE <collection> <json> Run aggregation pipeline\n";
+    std::cout << "  HISTOGRAM <collection> <json> Count documents per time bucket\n";
 }
 
 int main(int argc, char* argv[]) {
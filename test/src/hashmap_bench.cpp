@@ -0,0 +1,205 @@
+#include "hashmap.h"
+#include "flat_hashmap.h"
+#include "json_parser.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <unordered_map>
+#include <cstdint>
+#include <algorithm>
+
+// Нагрузка на таблицу документов коллекции: заполнение, поток удалений и
+// вставок (старые события уходят, новые приходят), поиск, очистка и
+// разрушение. Для сравнения та же нагрузка прогоняется на
+// FlatHashMap и std::unordered_map, который выделяет каждый узел
+// отдельно. Вторая
+// таблица - целые ключи и значения, где видна стоимость самих узлов,
+// а не копирования документов.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double msSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+std::string makeId(size_t i) {
+    return "evt_" + std::to_string(i * 2654435761u % 1000000007u) + "_" + std::to_string(i);
+}
+
+JsonValue makeEvent(size_t i) {
+    JsonValue event;
+    event["_id"] = JsonValue(makeId(i));
+    event["host"] = JsonValue("host-" + std::to_string(i % 64));
+    event["severity"] = JsonValue(i % 10 == 0 ? "high" : "low");
+    event["pid"] = JsonValue(static_cast<int>(i % 32768));
+    return event;
+}
+
+template<typename K, typename V>
+struct HashMapOps {
+    using Map = HashMap<K, V>;
+    static void put(Map& map, const K& key, const V& value) { map.put(key, value); }
+    static bool contains(const Map& map, const K& key) { return map.contains(key); }
+    static void remove(Map& map, const K& key) { map.remove(key); }
+};
+
+template<typename K, typename V>
+struct FlatHashMapOps {
+    using Map = FlatHashMap<K, V>;
+    static void put(Map& map, const K& key, const V& value) { map.put(key, value); }
+    static bool contains(const Map& map, const K& key) { return map.contains(key); }
+    static void remove(Map& map, const K& key) { map.remove(key); }
+};
+
+template<typename K, typename V>
+struct UnorderedMapOps {
+    using Map = std::unordered_map<K, V>;
+    static void put(Map& map, const K& key, const V& value) { map[key] = value; }
+    static bool contains(const Map& map, const K& key) { return map.find(key) != map.end(); }
+    static void remove(Map& map, const K& key) { map.erase(key); }
+};
+
+template<typename Ops, typename K, typename V>
+void run(const std::string& name, size_t count, const std::vector<K>& ids, const std::vector<V>& events) {
+    auto* map = new typename Ops::Map();
+    std::mt19937_64 rng(42);
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        Ops::put(*map, ids[i], events[i]);
+    }
+    double fill = msSince(start);
+
+    // Окно из count живых событий сдвигается на count позиций
+    start = Clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        Ops::remove(*map, ids[i]);
+        Ops::put(*map, ids[count + i], events[count + i]);
+    }
+    double churn = msSince(start);
+
+    start = Clock::now();
+    size_t found = 0;
+    for (size_t i = 0; i < count; ++i) {
+        found += Ops::contains(*map, ids[count + rng() % count]) ? 1 : 0;
+    }
+    double lookup = msSince(start);
+
+    start = Clock::now();
+    map->clear();
+    double clear = msSince(start);
+
+    for (size_t i = 0; i < count; ++i) {
+        Ops::put(*map, ids[i], events[i]);
+    }
+    start = Clock::now();
+    delete map;
+    double destroy = msSince(start);
+
+    std::cout << std::left << std::setw(20) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << fill << std::setw(10) << churn << std::setw(10) << lookup
+              << std::setw(10) << clear << std::setw(10) << destroy
+              << (found == count ? "" : "  (lookup miss!)") << "\n";
+}
+
+// Задержка отдельных вставок при росте таблицы от пустой до 2*count
+// документов: перестройка целиком видна как выброс в p99.9 и max
+template<typename Ops, typename K, typename V>
+void latency(const std::string& name, const std::vector<K>& ids, const std::vector<V>& events) {
+    typename Ops::Map map;
+    std::vector<double> times;
+    times.reserve(ids.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        auto start = Clock::now();
+        Ops::put(map, ids[i], events[i]);
+        times.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+    }
+
+    std::sort(times.begin(), times.end());
+    auto percentile = [&times](double p) {
+        return times[std::min(times.size() - 1, static_cast<size_t>(p * times.size()))];
+    };
+    std::cout << std::left << std::setw(20) << name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(10) << percentile(0.5) << std::setw(10) << percentile(0.99)
+              << std::setw(10) << percentile(0.999) << std::setw(12) << times.back() << "\n";
+}
+
+// Перемещенная таблица должна оставаться пустой и пригодной к работе,
+// в том числе если ее перемещали посреди постепенного переноса
+bool checkMovedFrom() {
+    for (size_t count = 1; count <= 3000; count += 97) {
+        FlatHashMap<std::string, int> source;
+        for (size_t i = 0; i < count; ++i) {
+            source.put(makeId(i), static_cast<int>(i));
+        }
+        FlatHashMap<std::string, int> moved(std::move(source));
+        FlatHashMap<std::string, int> assigned;
+        assigned = std::move(moved);
+
+        for (FlatHashMap<std::string, int>* map : {&source, &moved}) {
+            map->put("key", 1);
+            size_t visited = 0;
+            map->forEach([&visited](const std::string&, int) {
+                visited++;
+                return true;
+            });
+            if (visited != 1 || map->size() != 1 || !map->contains("key")) return false;
+        }
+        if (assigned.size() != count || assigned.items().size() != count) return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    size_t count = 500000;
+    if (argc > 1) {
+        count = std::stoul(argv[1]);
+    }
+
+    if (!checkMovedFrom()) {
+        std::cerr << "FlatHashMap: moved-from map is broken\n";
+        return 1;
+    }
+
+    std::vector<std::string> ids;
+    std::vector<JsonValue> events;
+    std::vector<uint64_t> numbers;
+    ids.reserve(2 * count);
+    events.reserve(2 * count);
+    numbers.reserve(2 * count);
+    for (size_t i = 0; i < 2 * count; ++i) {
+        ids.push_back(makeId(i));
+        events.push_back(makeEvent(i));
+        numbers.push_back(i * 2654435761u);
+    }
+
+    std::cout << count << " entries, times in ms\n";
+    std::cout << std::left << std::setw(20) << "map" << std::right << std::setw(10) << "fill"
+              << std::setw(10) << "churn" << std::setw(10) << "lookup" << std::setw(10) << "clear"
+              << std::setw(10) << "destroy" << "\n";
+
+    std::cout << "string -> JsonValue\n";
+    run<HashMapOps<std::string, JsonValue>>("HashMap", count, ids, events);
+    run<FlatHashMapOps<std::string, JsonValue>>("FlatHashMap", count, ids, events);
+    run<UnorderedMapOps<std::string, JsonValue>>("std::unordered_map", count, ids, events);
+
+    std::cout << "uint64 -> uint64\n";
+    run<HashMapOps<uint64_t, uint64_t>>("HashMap", count, numbers, numbers);
+    run<FlatHashMapOps<uint64_t, uint64_t>>("FlatHashMap", count, numbers, numbers);
+    run<UnorderedMapOps<uint64_t, uint64_t>>("std::unordered_map", count, numbers, numbers);
+
+    std::cout << "\ninsert latency, string -> JsonValue, " << 2 * count << " inserts, us\n";
+    std::cout << std::left << std::setw(20) << "map" << std::right << std::setw(10) << "p50"
+              << std::setw(10) << "p99" << std::setw(10) << "p99.9" << std::setw(12) << "max" << "\n";
+    latency<HashMapOps<std::string, JsonValue>>("HashMap", ids, events);
+    latency<FlatHashMapOps<std::string, JsonValue>>("FlatHashMap", ids, events);
+    latency<UnorderedMapOps<std::string, JsonValue>>("std::unordered_map", ids, events);
+    return 0;
+}
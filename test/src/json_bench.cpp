@@ -0,0 +1,224 @@
+#include "json_parser.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cctype>
+
+// Разбор файла коллекции (по умолчанию security_db/security_events.json)
+// текущим JsonParser и прежним разборщиком, который копировал вход,
+// собирал строки посимвольно и сравнивал литералы через substr. Прежний
+// разборщик оставлен здесь только для сравнения. Запуск:
+// ./build/json_bench [файл] [повторы].
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double msSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+class LegacyJsonParser {
+private:
+    std::string input_;
+    size_t pos_;
+
+    void skipWhitespace() {
+        while (pos_ < input_.length() && std::isspace(input_[pos_])) {
+            pos_++;
+        }
+    }
+
+    std::string parseString() {
+        if (input_[pos_] != '"') {
+            throw std::runtime_error("Expected string");
+        }
+        pos_++;
+        std::string result;
+        while (pos_ < input_.length() && input_[pos_] != '"') {
+            if (input_[pos_] == '\\') {
+                pos_++;
+                if (pos_ >= input_.length()) break;
+                switch (input_[pos_]) {
+                    case 'n': result += '\n'; break;
+                    case 't': result += '\t'; break;
+                    case 'r': result += '\r'; break;
+                    default: result += input_[pos_]; break;
+                }
+            } else {
+                result += input_[pos_];
+            }
+            pos_++;
+        }
+        if (pos_ >= input_.length()) {
+            throw std::runtime_error("Unterminated string");
+        }
+        pos_++;
+        return result;
+    }
+
+    JsonValue parseNumber() {
+        size_t start = pos_;
+        bool isFloat = false;
+        if (input_[pos_] == '-') pos_++;
+        while (pos_ < input_.length() && std::isdigit(input_[pos_])) pos_++;
+        if (pos_ < input_.length() && input_[pos_] == '.') {
+            isFloat = true;
+            pos_++;
+            while (pos_ < input_.length() && std::isdigit(input_[pos_])) pos_++;
+        }
+        std::string numStr = input_.substr(start, pos_ - start);
+        if (isFloat) {
+            return JsonValue(std::stod(numStr));
+        }
+        return JsonValue(std::stoi(numStr));
+    }
+
+    JsonValue parseValue() {
+        skipWhitespace();
+        if (pos_ >= input_.length()) {
+            throw std::runtime_error("Unexpected end of input");
+        }
+        char c = input_[pos_];
+        if (c == '{') return parseObject();
+        if (c == '[') return parseArray();
+        if (c == '"') return JsonValue(parseString());
+        if (c == '-' || std::isdigit(c)) return parseNumber();
+        if (input_.substr(pos_, 4) == "true") { pos_ += 4; return JsonValue(true); }
+        if (input_.substr(pos_, 5) == "false") { pos_ += 5; return JsonValue(false); }
+        if (input_.substr(pos_, 4) == "null") { pos_ += 4; return JsonValue(nullptr); }
+        throw std::runtime_error("Unexpected character: " + std::string(1, c));
+    }
+
+    JsonValue parseObject() {
+        pos_++;
+        skipWhitespace();
+        JsonValue::Object obj;
+        if (input_[pos_] == '}') {
+            pos_++;
+            return JsonValue(obj);
+        }
+        while (true) {
+            skipWhitespace();
+            std::string key = parseString();
+            skipWhitespace();
+            if (input_[pos_] != ':') {
+                throw std::runtime_error("Expected colon");
+            }
+            pos_++;
+            JsonValue value = parseValue();
+            obj[key] = value;
+            skipWhitespace();
+            if (input_[pos_] == '}') {
+                pos_++;
+                break;
+            } else if (input_[pos_] == ',') {
+                pos_++;
+            } else {
+                throw std::runtime_error("Expected comma or closing brace");
+            }
+        }
+        return JsonValue(obj);
+    }
+
+    JsonValue parseArray() {
+        pos_++;
+        skipWhitespace();
+        std::vector<JsonValue> arr;
+        if (input_[pos_] == ']') {
+            pos_++;
+            return JsonValue(arr);
+        }
+        while (true) {
+            arr.push_back(parseValue());
+            skipWhitespace();
+            if (input_[pos_] == ']') {
+                pos_++;
+                break;
+            } else if (input_[pos_] == ',') {
+                pos_++;
+            } else {
+                throw std::runtime_error("Expected comma or closing bracket");
+            }
+        }
+        return JsonValue(arr);
+    }
+
+public:
+    JsonValue parse(const std::string& json) {
+        input_ = json;
+        pos_ = 0;
+        skipWhitespace();
+        JsonValue result = parseValue();
+        skipWhitespace();
+        if (pos_ < input_.length()) {
+            throw std::runtime_error("Unexpected characters after JSON");
+        }
+        return result;
+    }
+};
+
+template<typename Parser>
+double run(const std::string& text, int rounds, std::string& dump) {
+    Parser parser;
+    JsonValue result = parser.parse(text);
+    dump = result.toString();
+
+    auto start = Clock::now();
+    for (int i = 0; i < rounds; ++i) {
+        result = parser.parse(text);
+    }
+    return msSince(start) / rounds;
+}
+
+void report(const char* name, double ms, size_t bytes) {
+    double mbPerSec = static_cast<double>(bytes) / (1024.0 * 1024.0) / (ms / 1000.0);
+    std::cout << std::left << std::setw(20) << name << std::right << std::fixed << std::setprecision(3)
+              << std::setw(10) << ms << std::setprecision(1) << std::setw(10) << mbPerSec << "\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    std::string path = argc > 1 ? argv[1] : "security_db/security_events.json";
+    int rounds = 200;
+    try {
+        if (argc > 2) {
+            rounds = std::stoi(argv[2]);
+        }
+    } catch (const std::exception&) {
+        std::cerr << "Usage: " << argv[0] << " [file] [rounds]\n";
+        return 1;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Cannot open " << path << "\n";
+        return 1;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string text = buffer.str();
+
+    std::string legacyDump;
+    std::string currentDump;
+    double legacyMs = run<LegacyJsonParser>(text, rounds, legacyDump);
+    double currentMs = run<JsonParser>(text, rounds, currentDump);
+
+    std::cout << path << ": " << text.size() << " bytes, " << rounds << " rounds\n";
+    std::cout << std::left << std::setw(20) << "parser" << std::right << std::setw(10) << "ms"
+              << std::setw(10) << "MB/s" << "\n";
+    report("legacy", legacyMs, text.size());
+    report("JsonParser", currentMs, text.size());
+    std::cout << "speedup " << std::setprecision(2) << legacyMs / currentMs << "x\n";
+
+    if (legacyDump != currentDump) {
+        std::cerr << "Results differ\n";
+        return 1;
+    }
+    return 0;
+}
@@ -9,14 +9,14 @@ void printUsage() {
     std::cout << "  ./no_sql_dbms <database> insert '<json>'\n";
     std::cout << "  ./no_sql_dbms <database> find '<json>'\n";
     std::cout << "  ./no_sql_dbms <database> delete '<json>'\n";
-    std::cout << "  ./no_sql_dbms <database> create_index <field>\n";
+    std::cout << "  ./no_sql_dbms <database> create_index <field> [hash|ordered|text|trigram]\n";
 }
 
 void printJson(const JsonValue& json, int indent = 0) {
     std::string indentStr(indent * 2, ' ');
     
     if (json.isObject()) {
-        auto obj = json.asObject();
+        const auto& obj = json.asObject();
         std::cout << "{\n";
         bool first = true;
         for (const auto& [key, value] : obj) {
@@ -32,7 +32,7 @@ void printJson(const JsonValue& json, int indent = 0) {
         }
         std::cout << "\n" << indentStr << "}";
     } else if (json.isArray()) {
-        auto arr = json.asArray();
+        const auto& arr = json.asArray();
         std::cout << "[\n";
         for (size_t i = 0; i < arr.size(); ++i) {
             if (i > 0) std::cout << ",\n";
@@ -130,7 +130,7 @@ int main(int argc, char* argv[]) {
             }
             
             std::string field = argv[3];
-            db.createIndex(field);
+            db.createIndex(field, argc > 4 ? argv[4] : "");
             std::cout << "Index created on field: " << field << "\n";
             
         } else {
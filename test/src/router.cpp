@@ -0,0 +1,74 @@
+#include "router.h"
+#include <iostream>
+#include <csignal>
+#include <cstdlib>
+
+ShardRouter* g_router = nullptr;
+
+void signalHandler(int /*signal*/) {
+    if (g_router) {
+        std::cout << "\nShutting down router...\n";
+        g_router->stop();
+    }
+    exit(0);
+}
+
+void printUsage(const char* programName) {
+    std::cout << "Usage: " << programName << " [port] --shard <host:port> [--shard <host:port> ...] [--config <file>]\n";
+    std::cout << "Shards listed on the command line are added to the shards saved in the config file;\n";
+    std::cout << "documents are moved to a new shard in background.\n";
+}
+
+int main(int argc, char* argv[]) {
+    int port = 8090;
+    std::string configPath = "router_config.json";
+    std::vector<std::string> shards;
+    
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--shard" && i + 1 < argc) {
+            shards.push_back(argv[++i]);
+        } else if (arg == "--config" && i + 1 < argc) {
+            configPath = argv[++i];
+        } else if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else {
+            port = std::stoi(arg);
+        }
+    }
+    
+    ShardRouter router(port, configPath);
+    try {
+        router.loadConfig();
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to load router config " << configPath << ": " << e.what() << "\n";
+        return 1;
+    }
+    
+    ShardConnections connections;
+    for (const auto& shard : shards) {
+        if (router.hasShard(shard)) continue;
+        std::string error;
+        if (!router.addShard(connections, shard, error)) {
+            std::cerr << "Cannot add shard " << shard << ": " << error << "\n";
+            return 1;
+        }
+    }
+    
+    if (router.shardCount() == 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    g_router = &router;
+    
+    signal(SIGINT, signalHandler);
+    signal(SIGTERM, signalHandler);
+    
+    if (!router.start()) {
+        std::cerr << "Failed to start router\n";
+        return 1;
+    }
+    
+    return 0;
+}
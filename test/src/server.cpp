@@ -15,12 +15,39 @@ void signalHandler(int /*signal*/) {
 
 int main(int argc, char* argv[]) {
     int port = 8080;
+    std::string primary;
+    bool appendLog = true;
     
-    if (argc > 1) {
-        port = std::stoi(argv[1]);
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--replica-of" && i + 1 < argc) {
+            primary = argv[++i];
+        } else if (arg == "--storage" && i + 1 < argc) {
+            std::string storage = argv[++i];
+            if (storage != "log" && storage != "snapshot") {
+                std::cerr << "Invalid --storage, expected log or snapshot\n";
+                return 1;
+            }
+            appendLog = storage == "log";
+        } else if (arg == "-h" || arg == "--help") {
+            std::cout << "Usage: " << argv[0] << " [port] [--replica-of <host:port>] [--storage log|snapshot]\n";
+            return 0;
+        } else {
+            port = std::stoi(arg);
+        }
     }
     
-    DatabaseServer server(port);
+    DatabaseServer server(port, appendLog);
+    
+    if (!primary.empty()) {
+        std::string primaryHost;
+        int primaryPort = 0;
+        if (!Connection::splitAddress(primary, primaryHost, primaryPort)) {
+            std::cerr << "Invalid --replica-of address, expected host:port\n";
+            return 1;
+        }
+        server.replicateFrom(primaryHost, primaryPort);
+    }
     g_server = &server;
     
     signal(SIGINT, signalHandler);
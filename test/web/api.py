@@ -8,6 +8,10 @@ from event_utils import (
     get_events_from_source,
     filter_events_by_time,
     parse_timestamp,
+    db_is_event_source,
+    count_events_by_field,
+    events_timeline_from_db,
+    events_page_from_db,
     sync_events_from_json_to_db
 )
 
@@ -28,6 +32,25 @@ def register_api_routes(app):
             hours = int(request.args.get('hours', 24))
             realtime = request.args.get('realtime', 'false').lower() == 'true'
             
+            if db_is_event_source(force_json=realtime):
+                filters = {}
+                for field, value in (('event_type', event_type), ('severity', severity),
+                                     ('hostname', hostname), ('user', user)):
+                    if value:
+                        filters[field] = value
+                # Поиск по словам выполняет сервер по полнотекстовому индексу
+                if search:
+                    filters['$text'] = {'$search': search}
+                batch = events_page_from_db(filters, hours, page, per_page, client=request.remote_addr or '')
+                total = batch['total']
+                return jsonify({
+                    'events': batch['events'],
+                    'total': total,
+                    'page': page,
+                    'per_page': per_page,
+                    'pages': (total + per_page - 1) // per_page
+                })
+            
             all_events = get_events_from_source(force_json=realtime)
             
             if event_type:
@@ -199,6 +222,10 @@ def register_api_routes(app):
         try:
             hours = int(request.args.get('hours', 24))
             realtime = request.args.get('realtime', 'true').lower() == 'true'
+            if db_is_event_source(force_json=realtime):
+                groups = count_events_by_field('event_type', hours)
+                return jsonify([{'type': g['_id'] or 'unknown', 'count': g['count']} for g in groups])
+            
             all_events = get_events_from_source(force_json=realtime)
             if hours > 0:
                 recent_events = filter_events_by_time(all_events, hours)
@@ -224,6 +251,10 @@ def register_api_routes(app):
         try:
             hours = int(request.args.get('hours', 24))
             realtime = request.args.get('realtime', 'true').lower() == 'true'
+            if db_is_event_source(force_json=realtime):
+                groups = count_events_by_field('severity', hours)
+                return jsonify([{'severity': g['_id'] or 'low', 'count': g['count']} for g in groups])
+            
             all_events = get_events_from_source(force_json=realtime)
             if hours > 0:
                 recent_events = filter_events_by_time(all_events, hours)
@@ -249,6 +280,12 @@ def register_api_routes(app):
             hours = int(request.args.get('hours', 24))
             limit = int(request.args.get('limit', 10))
             realtime = request.args.get('realtime', 'true').lower() == 'true'
+            if db_is_event_source(force_json=realtime):
+                groups = count_events_by_field('user', hours, limit)
+                result = [{'user': g['_id'], 'count': g['count']}
+                          for g in groups if g['_id'] and g['_id'] != 'unknown']
+                return jsonify(result[:limit])
+            
             all_events = get_events_from_source(force_json=realtime)
             if hours > 0:
                 recent_events = filter_events_by_time(all_events, hours)
@@ -276,6 +313,12 @@ def register_api_routes(app):
             hours = int(request.args.get('hours', 24))
             limit = int(request.args.get('limit', 10))
             realtime = request.args.get('realtime', 'true').lower() == 'true'
+            if db_is_event_source(force_json=realtime):
+                groups = count_events_by_field('process', hours, limit)
+                result = [{'process': g['_id'], 'count': g['count']}
+                          for g in groups if g['_id'] and g['_id'] != 'unknown']
+                return jsonify(result[:limit])
+            
             all_events = get_events_from_source(force_json=realtime)
             if hours > 0:
                 recent_events = filter_events_by_time(all_events, hours)
@@ -302,6 +345,9 @@ def register_api_routes(app):
         try:
             hours = int(request.args.get('hours', 24))
             realtime = request.args.get('realtime', 'true').lower() == 'true'
+            if db_is_event_source(force_json=realtime):
+                return jsonify(events_timeline_from_db(hours))
+            
             all_events = get_events_from_source(force_json=realtime)
             if hours > 0:
                 recent_events = filter_events_by_time(all_events, hours)
@@ -3,7 +3,7 @@ from config import (
     SECRET_KEY, DB_HOST, DB_PORT, AUTH_USERNAME, 
     JSON_EVENTS_FILE, WEB_PORT
 )
-from event_utils import sync_events_from_json_to_db
+from event_utils import sync_events_from_json_to_db, ensure_text_index
 from routes import register_routes
 from api import register_api_routes
 
@@ -30,5 +30,10 @@ if __name__ == '__main__':
         print(f"Warning: Could not sync events to DB: {e}")
         print("Will read events from JSON file directly")
     
+    try:
+        ensure_text_index()
+    except Exception as e:
+        print(f"Warning: Could not create text index: {e}")
+    
     print(f"Starting SIEM web server on http://localhost:{WEB_PORT}")
     app.run(debug=True, host='0.0.0.0', port=WEB_PORT)
@@ -98,6 +98,70 @@ class DatabaseClient:
         else:
             raise Exception(f"Database error: {response.get('message', 'Unknown error')}")
     
+    def find_events_batch(self, query: Optional[Dict] = None,
+                          sort: Optional[Dict] = None, skip: int = 0,
+                          batch_size: int = 100,
+                          database: str = "security_db",
+                          collection: str = "security_events") -> Dict[str, Any]:
+        """Первая порция результата find с открытием серверного курсора.
+        Возвращает {"events": [...], "cursor_id": int, "total": int}"""
+        request = {
+            "database": database,
+            "operation": "find",
+            "collection": collection,
+            "query": query or {},
+            "skip": skip,
+            "batch_size": batch_size
+        }
+        if sort:
+            request["sort"] = sort
+        
+        return self._cursor_response(self._execute_request(request))
+    
+    def get_more(self, cursor_id: int, batch_size: int = 0,
+                 database: str = "security_db") -> Dict[str, Any]:
+        """Следующая порция документов открытого курсора"""
+        request = {
+            "database": database,
+            "operation": "getMore",
+            "cursor_id": cursor_id
+        }
+        if batch_size > 0:
+            request["batch_size"] = batch_size
+        
+        return self._cursor_response(self._execute_request(request))
+    
+    def kill_cursor(self, cursor_id: int, database: str = "security_db"):
+        """Закрытие курсора, если остаток результата не нужен"""
+        if cursor_id:
+            self._execute_request({
+                "database": database,
+                "operation": "killCursors",
+                "cursor_id": cursor_id
+            })
+    
+    def iterate_events(self, query: Optional[Dict] = None,
+                       sort: Optional[Dict] = None, batch_size: int = 500,
+                       database: str = "security_db",
+                       collection: str = "security_events"):
+        """Генератор по всем найденным событиям порциями через курсор"""
+        batch = self.find_events_batch(query, sort, 0, batch_size, database, collection)
+        while True:
+            for event in batch["events"]:
+                yield event
+            if not batch["cursor_id"]:
+                break
+            batch = self.get_more(batch["cursor_id"], batch_size, database)
+    
+    def _cursor_response(self, response: Dict[str, Any]) -> Dict[str, Any]:
+        if response.get("status") != "success":
+            raise Exception(f"Database error: {response.get('message', 'Unknown error')}")
+        return {
+            "events": response.get("data", []),
+            "cursor_id": response.get("cursor_id", 0),
+            "total": response.get("total", response.get("count", 0))
+        }
+    
     def insert_event(self, event: Dict, 
                     database: str = "security_db",
                     collection: str = "security_events") -> bool:
@@ -134,6 +198,115 @@ class DatabaseClient:
         else:
             raise Exception(f"Database error: {response.get('message', 'Unknown error')}")
     
+    def aggregate(self, pipeline: List[Dict],
+                  database: str = "security_db",
+                  collection: str = "security_events") -> List[Dict]:
+        """Агрегация на стороне сервера ($match, $group, $sort, $limit)"""
+        request = {
+            "database": database,
+            "operation": "aggregate",
+            "collection": collection,
+            "pipeline": pipeline
+        }
+        
+        response = self._execute_request(request)
+        
+        if response.get("status") == "success":
+            return response.get("data", [])
+        else:
+            raise Exception(f"Database error: {response.get('message', 'Unknown error')}")
+    
+    def create_text_index(self, field: str,
+                          database: str = "security_db",
+                          collection: str = "security_events") -> bool:
+        """Полнотекстовый индекс по полю для поиска через $text"""
+        request = {
+            "database": database,
+            "operation": "create_index",
+            "collection": collection,
+            "field": field,
+            "type": "text"
+        }
+        
+        response = self._execute_request(request)
+        
+        if response.get("status") == "success":
+            return True
+        else:
+            raise Exception(f"Database error: {response.get('message', 'Unknown error')}")
+    
+    def histogram(self, field: str = "timestamp", bucket: str = "1h",
+                  time_from: Optional[str] = None, time_to: Optional[str] = None,
+                  group_by: Optional[str] = None,
+                  database: str = "security_db",
+                  collection: str = "security_events") -> List[Dict]:
+        """Количество событий по временным интервалам (считается на сервере)"""
+        request = {
+            "database": database,
+            "operation": "histogram",
+            "collection": collection,
+            "field": field,
+            "bucket": bucket
+        }
+        if time_from:
+            request["from"] = time_from
+        if time_to:
+            request["to"] = time_to
+        if group_by:
+            request["group_by"] = group_by
+        
+        response = self._execute_request(request)
+        
+        if response.get("status") == "success":
+            return response.get("data", [])
+        else:
+            raise Exception(f"Database error: {response.get('message', 'Unknown error')}")
+    
+    def watch(self, query: Optional[Dict] = None, resume_after: Optional[str] = None,
+              database: str = "security_db",
+              collection: str = "security_events"):
+        """Генератор изменений коллекции. Использует отдельное соединение,
+        которое сервер держит открытым. Каждое изменение содержит
+        operation, document и resume_token; токен последнего обработанного
+        изменения передается в resume_after при переподключении."""
+        stream = DatabaseClient(self.host, self.port)
+        if not stream.connect():
+            raise ConnectionError(f"Cannot connect to database server at {self.host}:{self.port}")
+        
+        try:
+            request = {
+                "database": database,
+                "operation": "watch",
+                "collection": collection
+            }
+            if query:
+                request["query"] = query
+            if resume_after:
+                request["resume_after"] = resume_after
+            
+            stream._send_message(json.dumps(request))
+            ack = json.loads(stream._read_message())
+            if ack.get("status") != "success":
+                raise Exception(f"Database error: {ack.get('message', 'Unknown error')}")
+            
+            while True:
+                message = json.loads(stream._read_message())
+                if message.get("status") != "success":
+                    raise Exception(f"Database error: {message.get('message', 'Unknown error')}")
+                for change in message.get("data", []):
+                    yield change
+        finally:
+            stream.disconnect()
+    
+    def stats(self) -> Dict[str, Any]:
+        """Статистика сервера: роль, токен журнала, отставание реплики"""
+        response = self._execute_request({"operation": "stats"})
+        
+        if response.get("status") == "success":
+            return response.get("stats", {})
+        else:
+            raise Exception(f"Database error: {response.get('message', 'Unknown error')}")
+    
     def __enter__(self):
         self.connect()
         return self
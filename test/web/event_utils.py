@@ -1,5 +1,7 @@
 import os
 import json
+import threading
+from collections import OrderedDict
 from datetime import datetime, timedelta
 from typing import Dict, List
 from config import JSON_EVENTS_FILE
@@ -41,6 +43,132 @@ def filter_events_by_time(events: List[Dict], hours: int = 24) -> List[Dict]:
     return filtered
 
 
+def db_is_event_source(force_json: bool = False) -> bool:
+    """События берутся из БД, когда JSON-файл не используется или пуст"""
+    if force_json:
+        return False
+    return not (os.path.exists(JSON_EVENTS_FILE) and os.path.getsize(JSON_EVENTS_FILE) > 0)
+
+
+def time_window_match(hours: int) -> Dict:
+    """Условие $match для событий за последние hours часов"""
+    if hours <= 0:
+        return {}
+    cutoff = datetime.utcnow() - timedelta(hours=hours)
+    return {'timestamp': {'$gt': cutoff.strftime('%Y-%m-%dT%H:%M:%S')}}
+
+
+def count_events_by_field(field: str, hours: int = 24, limit: int = 0) -> List[Dict]:
+    """Подсчет событий по значению поля агрегацией на сервере БД"""
+    pipeline = [
+        {'$match': time_window_match(hours)},
+        {'$group': {'_id': f'${field}', 'count': {'$sum': 1}}},
+        {'$sort': {'count': -1}}
+    ]
+    if limit > 0:
+        # Запас на пустые и 'unknown' значения, которые отбрасываются вызывающим кодом
+        pipeline.append({'$limit': limit + 3})
+    
+    with get_db_client() as db:
+        return db.aggregate(pipeline)
+
+
+def events_timeline_from_db(hours: int = 24) -> List[Dict]:
+    """Почасовое количество событий, посчитанное на сервере БД"""
+    time_from = None
+    if hours > 0:
+        time_from = (datetime.utcnow() - timedelta(hours=hours)).strftime('%Y-%m-%dT%H:%M:%SZ')
+    
+    with get_db_client() as db:
+        buckets = db.histogram(field='timestamp', bucket='1h', time_from=time_from)
+    
+    # "2025-12-29T14:00:00Z" -> "2025-12-29 14:00"
+    return [{'hour': b['bucket'][:10] + ' ' + b['bucket'][11:16], 'count': b['count']} for b in buckets]
+
+
+# Открытые курсоры страниц событий: (клиент, фильтры, часы, размер
+# страницы) -> курсор и номер страницы, которую отдаст его getMore
+_page_cursors = OrderedDict()
+_page_cursors_lock = threading.Lock()
+MAX_PAGE_CURSORS = 256
+
+
+def _take_page_cursor(key, page: int):
+    """Курсор, следующая порция которого - страница page, или None;
+    курсор другой страницы закрывается"""
+    with _page_cursors_lock:
+        state = _page_cursors.pop(key, None)
+    if state is None:
+        return None
+    if state['next_page'] == page and state['cursor_id']:
+        return state
+    with get_db_client() as db:
+        db.kill_cursor(state['cursor_id'])
+    return None
+
+
+def _keep_page_cursor(key, state: Dict):
+    if not state['cursor_id']:
+        return
+    with _page_cursors_lock:
+        _page_cursors[key] = state
+        evicted = []
+        while len(_page_cursors) > MAX_PAGE_CURSORS:
+            evicted.append(_page_cursors.popitem(last=False)[1]['cursor_id'])
+    if evicted:
+        with get_db_client() as db:
+            for cursor_id in evicted:
+                db.kill_cursor(cursor_id)
+
+
+def events_page_from_db(filters: Dict, hours: int, page: int, per_page: int, client: str = '') -> Dict:
+    """Страница событий, отсортированных по времени. Листание вперед
+    продолжает курсор клиента: getMore читает следующую порцию с позиции
+    курсора и не пересчитывает total. Переход на другую страницу открывает
+    курсор заново с skip; total берется из ответа find, отдельного
+    подсчета нет."""
+    page = max(page, 1)
+    key = (client, json.dumps(filters, sort_keys=True), hours, per_page)
+    
+    state = _take_page_cursor(key, page)
+    if state is not None:
+        try:
+            with get_db_client() as db:
+                batch = db.get_more(state['cursor_id'], per_page)
+            state.update(cursor_id=batch['cursor_id'], next_page=page + 1)
+            _keep_page_cursor(key, state)
+            return {'events': batch['events'], 'total': state['total']}
+        except Exception:
+            # Курсор закрыт сервером (истек) - страница читается заново
+            pass
+    
+    query = dict(filters)
+    query.update(time_window_match(hours))
+    skip = (page - 1) * per_page
+    with get_db_client() as db:
+        batch = db.find_events_batch(query, sort={'timestamp': -1}, skip=skip, batch_size=per_page)
+        total = skip + batch['total']  # total курсора считается после skip
+        if skip > 0 and not batch['events']:
+            # Страница за концом результата: число событий без skip
+            first = db.find_events_batch(query, sort={'timestamp': -1}, batch_size=1)
+            db.kill_cursor(first['cursor_id'])
+            total = first['total']
+    state = {'cursor_id': batch['cursor_id'], 'next_page': page + 1, 'total': total}
+    _keep_page_cursor(key, state)
+    return {'events': batch['events'], 'total': state['total']}
+
+
+# Поля событий, по которым работает поиск в журнале
+TEXT_SEARCH_FIELDS = ('raw_log', 'command')
+
+
+def ensure_text_index():
+    """Полнотекстовый индекс по полям поиска (повторное создание не меняет его)"""
+    with get_db_client() as db:
+        for field in TEXT_SEARCH_FIELDS:
+            db.create_text_index(field)
+
+
 def load_events_from_json_file(file_path: str = None) -> List[Dict]:
     if file_path is None:
         file_path = JSON_EVENTS_FILE